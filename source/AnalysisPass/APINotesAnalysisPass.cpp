@@ -34,6 +34,14 @@ std::string APINotesAnalysisPass::testFileName() const {
     return "testAPINotes.txt";
 }
 
+std::vector<const ASTAnalysisPassBase*> APINotesAnalysisPass::getDependencies() const {
+    return {
+        getASTAnalysisRunner().getImportAnalysisPass(),
+        getASTAnalysisRunner().getSwiftSubclassCxxAnalysisPass(),
+        getASTAnalysisRunner().getFindVtValueRefFunctionsAnalysisPass(),
+    };
+}
+
 std::vector<const clang::NamedDecl*> APINotesAnalysisPass::getHardCodedOwnedTypes() const {
     std::vector<std::string> names = {
         "class " PXR_NS"::UsdNotice::StageNotice",
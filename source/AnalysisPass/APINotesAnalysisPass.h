@@ -31,6 +31,7 @@ public:
     APINotesAnalysisPass(ASTAnalysisRunner* astAnalysisRunner);
     std::string serializationFileName() const override;
     std::string testFileName() const override;
+    std::vector<const ASTAnalysisPassBase*> getDependencies() const override;
     bool VisitNamedDecl(clang::NamedDecl* namedDecl) override;
     
 private:
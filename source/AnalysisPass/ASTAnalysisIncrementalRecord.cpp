@@ -0,0 +1,138 @@
+//===----------------------------------------------------------------------===//
+// This source file is part of github.com/apple/SwiftUsd-ast-answerer
+//
+// Copyright © 2025 Apple Inc. and the SwiftUsd-ast-answerer project authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//===----------------------------------------------------------------------===//
+
+#include "AnalysisPass/ASTAnalysisIncrementalRecord.h"
+#include "Util/TestDataLoader.h"
+#include <fstream>
+#include <iostream>
+
+/* static */
+std::optional<ASTAnalysisIncrementalRecord> ASTAnalysisIncrementalRecord::load(const std::filesystem::path& path) {
+    if (!std::filesystem::exists(path)) {
+        return std::nullopt;
+    }
+    
+    ASTAnalysisIncrementalRecord result;
+    // Important! Don't do PXR_NS replacement, because
+    // some types include `PXR_NS` as part of a token
+    for (const std::vector<std::string>& line : TestDataLoader::load(path, TestDataLoader::PxrNsReplacement::dontReplace)) {
+        if (line[0] == "fingerprint" && line.size() == 2) {
+            result.astFingerprint = std::stoull(line[1]);
+        } else if (line[0] == "file" && line.size() == 3) {
+            result.fileDigests.insert_or_assign(line[1], std::stoull(line[2]));
+        } else if (line[0] == "result" && line.size() >= 3) {
+            result.results.insert_or_assign(line[1], Result{line[2], std::vector<std::string>(line.begin() + 3, line.end())});
+        } else {
+            std::cerr << "Warning: Ignoring malformed incremental record " << path << std::endl;
+            return std::nullopt;
+        }
+    }
+    return result;
+}
+
+void ASTAnalysisIncrementalRecord::write(const std::filesystem::path& path) const {
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream stream(path);
+    
+    stream << "fingerprint; " << astFingerprint << ";" << std::endl;
+    for (const auto& it : fileDigests) {
+        stream << "file; " << it.first << "; " << it.second << ";" << std::endl;
+    }
+    for (const auto& it : results) {
+        stream << "result; " << it.first << "; " << it.second.data << ";";
+        for (const std::string& file : it.second.files) {
+            stream << " " << file << ";";
+        }
+        stream << std::endl;
+    }
+    
+    stream.close();
+}
+
+std::set<std::string> ASTAnalysisIncrementalRecord::findResultsToRecompute(const std::set<std::string>& changedFiles,
+                                                                          const std::set<std::string>& changedUpstreamResults,
+                                                                          const std::function<std::string(const std::string&)>& fileForNewResult,
+                                                                          std::set<std::string>& filesToVisit) const {
+    std::map<std::string, std::vector<const std::string*>> resultsByFile;
+    for (const auto& it : results) {
+        for (const std::string& file : it.second.files) {
+            resultsByFile[file].push_back(&it.first);
+        }
+    }
+    
+    std::set<std::string> result;
+    std::vector<std::string> fileWorklist;
+    auto visitFile = [&](const std::string& file) {
+        if (!file.empty() && filesToVisit.insert(file).second) {
+            fileWorklist.push_back(file);
+        }
+    };
+    auto recompute = [&](const std::string& name) {
+        const auto& it = results.find(name);
+        if (it == results.end()) {
+            visitFile(fileForNewResult(name));
+        } else if (result.insert(name).second) {
+            // Recomputing a result means revisiting everything that contributed to it
+            for (const std::string& file : it->second.files) {
+                visitFile(file);
+            }
+        }
+    };
+    
+    for (const std::string& file : changedFiles) {
+        visitFile(file);
+    }
+    for (const std::string& name : changedUpstreamResults) {
+        recompute(name);
+    }
+    
+    // Revisiting a file touches every result it contributed to last time,
+    // so those have to be recomputed too
+    while (!fileWorklist.empty()) {
+        std::string file = fileWorklist.back();
+        fileWorklist.pop_back();
+        const auto& it = resultsByFile.find(file);
+        if (it == resultsByFile.end()) {
+            continue;
+        }
+        for (const std::string* name : it->second) {
+            recompute(*name);
+        }
+    }
+    
+    return result;
+}
+
+/* static */
+std::set<std::string> ASTAnalysisIncrementalRecord::changedResults(const ASTAnalysisIncrementalRecord& before, const ASTAnalysisIncrementalRecord& after) {
+    std::set<std::string> result;
+    for (const auto& it : before.results) {
+        const auto& afterIt = after.results.find(it.first);
+        if (afterIt == after.results.end() || afterIt->second.data != it.second.data) {
+            result.insert(it.first);
+        }
+    }
+    for (const auto& it : after.results) {
+        if (!before.results.contains(it.first)) {
+            result.insert(it.first);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,68 @@
+//===----------------------------------------------------------------------===//
+// This source file is part of github.com/apple/SwiftUsd-ast-answerer
+//
+// Copyright © 2025 Apple Inc. and the SwiftUsd-ast-answerer project authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//===----------------------------------------------------------------------===//
+
+#ifndef ASTAnalysisIncrementalRecord_h
+#define ASTAnalysisIncrementalRecord_h
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+// Records what each result of an analysis pass was computed from, so that after the
+// serialized AST is rebuilt (e.g. for a new version of OpenUSD), a pass can keep the results
+// whose inputs didn't change and only revisit the files that could change the rest.
+//
+// A result's inputs are the files of every decl whose visit touched the result,
+// the file of the result's own decl, and the results for the same decl
+// in the passes it depends on.
+struct ASTAnalysisIncrementalRecord {
+    struct Result {
+        std::string data;
+        std::vector<std::string> files;
+    };
+    
+    uint64_t astFingerprint = 0;
+    // Every file the AST was built from, including ones no result came from
+    std::map<std::string, uint64_t> fileDigests;
+    std::map<std::string, Result> results;
+    
+    // Returns nullopt if there's no record, or it can't be read
+    static std::optional<ASTAnalysisIncrementalRecord> load(const std::filesystem::path& path);
+    void write(const std::filesystem::path& path) const;
+    
+    // Finds the results that have to be recomputed, given the files whose digests changed
+    // and the results that changed in passes this pass depends on. Files that have to be revisited
+    // to recompute them are added to `filesToVisit`. `fileForNewResult` is called with the name of
+    // upstream results this pass didn't have a result for, and returns the file it should look in
+    std::set<std::string> findResultsToRecompute(const std::set<std::string>& changedFiles,
+                                                 const std::set<std::string>& changedUpstreamResults,
+                                                 const std::function<std::string(const std::string&)>& fileForNewResult,
+                                                 std::set<std::string>& filesToVisit) const;
+    
+    // Names of results that were added, removed, or changed between two records
+    static std::set<std::string> changedResults(const ASTAnalysisIncrementalRecord& before, const ASTAnalysisIncrementalRecord& after);
+};
+
+#endif /* ASTAnalysisIncrementalRecord_h */
@@ -20,6 +20,10 @@
 
 #include "ASTAnalysisPass.h"
 #include <fstream>
+#include <mutex>
+#include <shared_mutex>
+#include <map>
+#include <unordered_map>
 
 clang::QualType ASTHelpers::removingRefConst(clang::QualType orig) {
     clang::QualType result = orig;
@@ -233,6 +237,32 @@ std::vector<const clang::Type*> ASTHelpers::allAccessibleImplicitNoArgConstConve
     return result;
 }
 
+std::mutex& ASTHelpers::getClangMutex() {
+    static std::mutex result;
+    return result;
+}
+
+clang::QualType ASTHelpers::getLValueReferenceType(clang::ASTContext& astContext, clang::QualType q) {
+    std::lock_guard<std::mutex> lock(getClangMutex());
+    return astContext.getLValueReferenceType(q);
+}
+
+clang::QualType ASTHelpers::getPointerType(clang::ASTContext& astContext, clang::QualType q) {
+    std::lock_guard<std::mutex> lock(getClangMutex());
+    return astContext.getPointerType(q);
+}
+
+clang::QualType ASTHelpers::getThisType(const clang::CXXMethodDecl* cxxMethodDecl) {
+    std::lock_guard<std::mutex> lock(getClangMutex());
+    return cxxMethodDecl->getThisType();
+}
+
+clang::QualType ASTHelpers::getInjectedClassNameSpecialization(clang::ClassTemplateDecl* classTemplateDecl) {
+    // Lazily creates the injected type the first time it's requested
+    std::lock_guard<std::mutex> lock(getClangMutex());
+    return classTemplateDecl->getInjectedClassNameSpecialization();
+}
+
 clang::QualType ASTHelpers::getInjectedClassNameSpecialization(clang::QualType q) {
     if (q.isNull()) {
         return clang::QualType();
@@ -247,7 +277,7 @@ clang::QualType ASTHelpers::getInjectedClassNameSpecialization(clang::QualType q
         return clang::QualType();
     }
     
-    return classTemplateSpecializationDecl->getSpecializedTemplate()->getInjectedClassNameSpecialization();
+    return getInjectedClassNameSpecialization(classTemplateSpecializationDecl->getSpecializedTemplate());
 }
 
 
@@ -299,18 +329,12 @@ bool ASTHelpers::isEqualToOrDerivedFromClass(const clang::CXXRecordDecl* derived
     return _isEqualToOrDerivedFromClass(derived, base, false);
 }
 
-bool ASTHelpers::isConstDuplicateSpecializationDecl(const clang::ClassTemplateSpecializationDecl* d) {
-    static std::map<const clang::ClassTemplateSpecializationDecl*, bool> memoized;
-    if (memoized.find(d) != memoized.end()) {
-        return memoized.find(d)->second;
-    }
-    
+bool _isConstDuplicateSpecializationDeclImpl(const clang::ClassTemplateSpecializationDecl* d) {
     const clang::TemplateArgumentList& argList = d->getTemplateInstantiationArgs();
     for (int i = 0; i < argList.size(); i++) {
         if (argList[i].getKind() != clang::TemplateArgument::Type) {
             // Bailing on non-type arguments isn't correct in general,
             // but Swift doesn't support other kinds of template arguments
-            memoized.insert({d, false});
             return false;
         }
     }
@@ -328,7 +352,6 @@ bool ASTHelpers::isConstDuplicateSpecializationDecl(const clang::ClassTemplateSp
             clang::TemplateArgument otherArgument = otherArgList[i];
             
             if (otherArgument.getKind() != clang::TemplateArgument::Type) {
-                memoized.insert({d, false});
                 return false;
             }
             clang::QualType thisType = thisArgument.getAsType();
@@ -350,15 +373,31 @@ bool ASTHelpers::isConstDuplicateSpecializationDecl(const clang::ClassTemplateSp
         }
         
         if (hadAtLeastOneRemovableConst && allArgumentsMatch) {
-            memoized.insert({d, true});
             return true;
         }
     }
     
-    memoized.insert({d, false});
     return false;
 }
 
+bool ASTHelpers::isConstDuplicateSpecializationDecl(const clang::ClassTemplateSpecializationDecl* d) {
+    // Analysis passes may run on multiple threads, so guard the memo
+    static std::mutex memoMutex;
+    static std::map<const clang::ClassTemplateSpecializationDecl*, bool> memo;
+    {
+        std::lock_guard<std::mutex> lock(memoMutex);
+        const auto& it = memo.find(d);
+        if (it != memo.end()) {
+            return it->second;
+        }
+    }
+    
+    bool result = _isConstDuplicateSpecializationDeclImpl(d);
+    std::lock_guard<std::mutex> lock(memoMutex);
+    memo.insert({d, result});
+    return result;
+}
+
 bool ASTHelpers::hasSwiftAccessibleCopyCtor(const clang::CXXRecordDecl* cxxRecordDecl) {
     for (const clang::CXXConstructorDecl* cxxConstructorDecl : cxxRecordDecl->ctors()) {
         if (!cxxConstructorDecl->isCopyConstructor()) { continue; }
@@ -447,7 +486,10 @@ clang::SourceLocation _getLatestSourceLocationImpl(const clang::Decl* _decl) {
 
         const clang::SourceManager& sourceManager = _decl->getASTContext().getSourceManager();
         const clang::Decl* decl = toProcess[i];
-        locations.push_back(sourceManager.getExpansionLoc(decl->getLocation()));
+        {
+            std::lock_guard<std::mutex> lock(ASTHelpers::getClangMutex());
+            locations.push_back(sourceManager.getExpansionLoc(decl->getLocation()));
+        }
         
         if (const clang::ClassTemplateSpecializationDecl* classTemplateSpecializationDecl = clang::dyn_cast<clang::ClassTemplateSpecializationDecl>(decl)) {
             
@@ -462,12 +504,134 @@ clang::SourceLocation _getLatestSourceLocationImpl(const clang::Decl* _decl) {
     return locations.back();
 }
 
+namespace {
+    // DeclComparator's side table. Every comparison needs both decls' latest
+    // source locations, and ties (e.g. all specializations of one template)
+    // are broken by name, so each decl's key is computed once and compares as integers.
+    //
+    // Names are interned with an order-maintenance label: labels are ordered the same
+    // way as the names they belong to, so comparing two names is comparing two integers.
+    // New names take a label between their neighbors, and if there's no room left,
+    // the names around them are relabeled evenly. Relabeling keeps the relative order
+    // of existing names, so maps already sorted by these keys stay sorted.
+    // Analysis passes may run on multiple threads, so readers share the lock
+    struct DeclSortKeys {
+        struct Key {
+            clang::SourceLocation latestSourceLocation;
+            // Null until the decl's name is needed to break a tie
+            const uint64_t* nameLabel;
+        };
+        
+        std::shared_mutex mutex;
+        std::unordered_map<const clang::Decl*, Key> keys;
+        std::map<std::string, uint64_t> nameLabels;
+        
+        static DeclSortKeys& get() {
+            static DeclSortKeys result;
+            return result;
+        }
+        
+        Key getKey(const clang::Decl* decl) {
+            {
+                std::shared_lock<std::shared_mutex> lock(mutex);
+                const auto& it = keys.find(decl);
+                if (it != keys.end()) {
+                    return it->second;
+                }
+            }
+            
+            clang::SourceLocation latestSourceLocation = _getLatestSourceLocationImpl(decl);
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            return keys.insert({decl, {latestSourceLocation, nullptr}}).first->second;
+        }
+        
+        // The decl must already have a key
+        const uint64_t* getNameLabel(const clang::NamedDecl* namedDecl, const Key& key) {
+            if (key.nameLabel) {
+                return key.nameLabel;
+            }
+            
+            std::string name = ASTHelpers::getAsString(namedDecl);
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            const auto& [it, didInsert] = nameLabels.insert({std::move(name), 0});
+            if (didInsert) {
+                _labelNewName(it);
+            }
+            keys.find(namedDecl)->second.nameLabel = &it->second;
+            return &it->second;
+        }
+        
+        bool isNameLabelLess(const uint64_t* lhs, const uint64_t* rhs) {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            return *lhs < *rhs;
+        }
+        
+    private:
+        // 0 and UINT64_MAX are never used as labels, so they bound the first and last names
+        void _labelNewName(std::map<std::string, uint64_t>::iterator it) {
+            bool hasPrev = it != nameLabels.begin();
+            bool hasNext = std::next(it) != nameLabels.end();
+            uint64_t lo = hasPrev ? std::prev(it)->second : 0;
+            uint64_t hi = hasNext ? std::next(it)->second : UINT64_MAX;
+            
+            if (hi - lo >= 2) {
+                // Names often arrive in sorted order, so step a fixed distance from the ends
+                // rather than halving the remaining space every time
+                constexpr uint64_t endStep = uint64_t(1) << 32;
+                if (!hasPrev && !hasNext) {
+                    it->second = uint64_t(1) << 63;
+                } else if (!hasNext) {
+                    it->second = lo + std::min(endStep, (hi - lo) / 2);
+                } else if (!hasPrev) {
+                    it->second = hi - std::min(endStep, (hi - lo) / 2);
+                } else {
+                    it->second = lo + (hi - lo) / 2;
+                }
+                return;
+            }
+            
+            // No room, so grow a window around the new name until its labels are sparse
+            // enough that relabeling it evenly leaves room for more names, and relabel it
+            auto first = it;
+            auto last = it;
+            uint64_t count = 1;
+            while (true) {
+                for (uint64_t i = 0, n = count; i < n; i++) {
+                    bool didGrow = false;
+                    if (first != nameLabels.begin()) {
+                        --first;
+                        count++;
+                        didGrow = true;
+                    }
+                    if (std::next(last) != nameLabels.end()) {
+                        ++last;
+                        count++;
+                        didGrow = true;
+                    }
+                    if (!didGrow) {
+                        break;
+                    }
+                }
+                lo = first != nameLabels.begin() ? std::prev(first)->second : 0;
+                hi = std::next(last) != nameLabels.end() ? std::next(last)->second : UINT64_MAX;
+                bool isWholeMap = first == nameLabels.begin() && std::next(last) == nameLabels.end();
+                if ((hi - lo) / (count + 1) >= count || isWholeMap) {
+                    break;
+                }
+            }
+            
+            uint64_t spacing = (hi - lo) / (count + 1);
+            uint64_t label = lo;
+            for (auto entry = first; entry != std::next(last); ++entry) {
+                label += spacing;
+                entry->second = label;
+            }
+        }
+    };
+}
+
 clang::SourceLocation ASTHelpers::getLatestSourceLocation(const clang::Decl* decl) {
-    static std::unordered_map<const clang::Decl*, clang::SourceLocation> memo;
-    if (memo.find(decl) == memo.end()) {
-        memo.insert({decl, _getLatestSourceLocationImpl(decl)});
-    }
-    return memo.find(decl)->second;
+    return DeclSortKeys::get().getKey(decl).latestSourceLocation;
 }
 
 
@@ -480,20 +644,20 @@ bool ASTHelpers::DeclComparator::operator ()(const clang::Decl* lhs, const clang
         return true;
     }
     
-    clang::SourceLocation lhsSourceLoc = ASTHelpers::getLatestSourceLocation(lhs);
-    clang::SourceLocation rhsSourceLoc = ASTHelpers::getLatestSourceLocation(rhs);
+    DeclSortKeys& sortKeys = DeclSortKeys::get();
+    DeclSortKeys::Key lhsKey = sortKeys.getKey(lhs);
+    DeclSortKeys::Key rhsKey = sortKeys.getKey(rhs);
     
-    if (lhsSourceLoc == rhsSourceLoc) {
+    if (lhsKey.latestSourceLocation == rhsKey.latestSourceLocation) {
         // Important! Don't let templates be equal
         if (const clang::NamedDecl* lNamed = clang::dyn_cast<clang::NamedDecl>(lhs)) {
             if (const clang::NamedDecl* rNamed = clang::dyn_cast<clang::NamedDecl>(rhs)) {
                 // Try to provide a stable ordering based on sorting of names
+                const uint64_t* lLabel = sortKeys.getNameLabel(lNamed, lhsKey);
+                const uint64_t* rLabel = sortKeys.getNameLabel(rNamed, rhsKey);
                 
-                std::string lString = ASTHelpers::getAsString(lNamed);
-                std::string rString = ASTHelpers::getAsString(rNamed);
-                
-                if (lString != rString) {
-                    return lString < rString;
+                if (lLabel != rLabel) {
+                    return sortKeys.isNameLabelLess(lLabel, rLabel);
                 }
             }
         }
@@ -501,6 +665,6 @@ bool ASTHelpers::DeclComparator::operator ()(const clang::Decl* lhs, const clang
         // Fallback to pointer ordering, which isn't stable
         return lhs < rhs;
     } else {
-        return lhsSourceLoc < rhsSourceLoc;
+        return lhsKey.latestSourceLocation < rhsKey.latestSourceLocation;
     }
 }
@@ -25,12 +25,24 @@
 #include "Util/ClangToolHelper.h"
 #include "Util/CMakeParser.h"
 #include "Util/TestDataLoader.h"
+#include "Util/BinaryAnalysisCache.h"
+#include "Util/Telemetry.h"
+#include "Util/PointerMap.h"
+#include "AnalysisPass/ASTAnalysisIncrementalRecord.h"
 #include "AnalysisResult/FindNamedDeclsAnalysisResult.h"
 #include "AnalysisPass/ASTAnalysisRunner.h"
 #include "clang/AST/RecursiveASTVisitor.h"
+#include <concepts>
 #include <filesystem>
+#include <functional>
 #include <string>
 #include <fstream>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <string_view>
+#include <unordered_map>
 
 // Helper class that provides a lot of convenient functions for working with the clang AST
 struct ASTHelpers {
@@ -43,6 +55,7 @@ struct ASTHelpers {
     static std::vector<const clang::CXXRecordDecl*> allAccessibleSupertypes(const clang::CXXRecordDecl* cxxRecordDecl);
     static std::vector<const clang::Type*> allAccessibleImplicitNoArgConstConversions(const clang::CXXRecordDecl* cxxRecordDecl);
     static clang::QualType getInjectedClassNameSpecialization(clang::QualType q);
+    static clang::QualType getInjectedClassNameSpecialization(clang::ClassTemplateDecl* classTemplateDecl);
     static std::vector<clang::QualType> allRecursiveTypesInTag(const clang::TagDecl* tagDecl);
     static bool isEqualToOrDerivedFromClassVisibleToSwift(const clang::CXXRecordDecl* derived, const clang::CXXRecordDecl* base);
     static bool isEqualToOrDerivedFromClass(const clang::CXXRecordDecl* derived, const clang::CXXRecordDecl* base);
@@ -54,24 +67,102 @@ struct ASTHelpers {
 
     static clang::SourceLocation getLatestSourceLocation(const clang::Decl* decl);
     
+    // Analysis passes may run on multiple threads. The AST is read-only once it's loaded,
+    // but some clang calls lazily create types or update caches in the ASTContext or SourceManager.
+    // Hold this lock around those calls, or use one of the wrappers below
+    static std::mutex& getClangMutex();
+    static clang::QualType getLValueReferenceType(clang::ASTContext& astContext, clang::QualType q);
+    static clang::QualType getPointerType(clang::ASTContext& astContext, clang::QualType q);
+    static clang::QualType getThisType(const clang::CXXMethodDecl* cxxMethodDecl);
+    
     struct DeclComparator {
         DeclComparator();
         bool operator ()(const clang::Decl* lhs, const clang::Decl* rhs) const;
     };
 };
 
+// Storage policies for ASTAnalysisPass::Data. Both iterate in DeclComparator order.
+// Ordered storage is a std::map. Hashed storage is a PointerMap, which is faster for passes
+// whose results are looked up far more often than they're iterated, like ImportAnalysisPass,
+// but must not have decls inserted while its results are being iterated (e.g. in finalize())
+struct OrderedDeclStorage {
+    template <typename AnalysisResult>
+    using Map = std::map<const clang::NamedDecl*, AnalysisResult, ASTHelpers::DeclComparator>;
+};
+struct HashedDeclStorage {
+    template <typename AnalysisResult>
+    using Map = PointerMap<clang::NamedDecl, AnalysisResult, ASTHelpers::DeclComparator>;
+};
+
+// Non-templated interface to an analysis pass, so that ASTAnalysisScheduler can
+// order analysis passes by their dependencies and run them together
+class ASTAnalysisPassBase {
+public:
+    virtual ~ASTAnalysisPassBase() {}
+    
+    virtual std::string serializationFileName() const = 0;
+    // How the pass is named on the command line and in telemetry
+    std::string getPassName() const {
+        return std::filesystem::path(serializationFileName()).stem().string();
+    }
+    // The analysis passes this pass reads from, which must finish before this pass can start.
+    // Every pass implicitly depends on FindNamedDeclsAnalysisPass, which always runs first
+    virtual std::vector<const ASTAnalysisPassBase*> getDependencies() const = 0;
+    virtual bool shouldOnlyVisitDeclsFromUsd() const = 0;
+    virtual bool shouldVisitTemplateInstantiations() const = 0;
+    virtual bool shouldVisitImplicitCode() const = 0;
+    // Whether analysis walks the AST. Passes that only look up known decls by name
+    // and stop traversal at the first decl don't need the whole AST deserialized
+    virtual bool traversesAST() const = 0;
+    // Whether finishing the pass reads ASTAnalysisRunner::getOperatorCandidateIndex(),
+    // so a fused traversal should collect the candidates on the way
+    virtual bool usesOperatorCandidateIndex() const { return false; }
+    virtual void analysisPassIsFinished() = 0;
+    virtual void serialize() const = 0;
+    virtual bool deserialize() = 0;
+    // Traverses the AST on its own. Call _finalizeAll() afterwards
+    virtual void analyze() = 0;
+    virtual void test() const = 0;
+    
+    // MARK: Fused traversal
+    // Runs every Visit method that this pass's own traversal would run on the given node
+    virtual bool _walkUpFromDecl(clang::Decl* decl) = 0;
+    virtual bool _walkUpFromType(clang::Type* type) = 0;
+    // Whether a traversal that only visits decls from Usd would descend into this decl
+    virtual bool _isFromUsdWhileTraversing(clang::Decl* decl) const = 0;
+    // Calls finalize() on every NamedDecl that has been insert_or_assign'd
+    virtual void _finalizeAll() = 0;
+    // Called once results are complete, before other threads read them
+    virtual void _prepareDataForSharing() const = 0;
+    
+    // MARK: Incremental analysis
+    // Whether this pass can keep results across rebuilds of the serialized AST
+    // when running with `--incremental`. Only return true if every result only depends
+    // on the decls whose visits touch it (through insert_or_assign or non-const find),
+    // and the results for the same decl in the passes this pass depends on
+    virtual bool supportsIncrementalAnalysis() const = 0;
+    // Names of results that changed since the last run, or nullptr if that isn't known
+    virtual const std::set<std::string>* _getChangedResultNames() const = 0;
+    
+    // MARK: Telemetry
+    // Running totals of decls visited and results inserted
+    virtual Telemetry::Counters _getTelemetryCounters() const = 0;
+    virtual const Telemetry* _getTelemetry() const = 0;
+};
+
 
-// Base class of all analysis passes. Inherit with CRTP, specifying the AnalysisResult type as well
-template <typename Derived, typename AnalysisResult>
-class ASTAnalysisPass: public clang::RecursiveASTVisitor<ASTAnalysisPass<Derived, AnalysisResult>> {
+// Base class of all analysis passes. Inherit with CRTP, specifying the AnalysisResult type as well,
+// and optionally a storage policy for the results
+template <typename Derived, typename AnalysisResult, typename Storage = OrderedDeclStorage>
+class ASTAnalysisPass: public clang::RecursiveASTVisitor<ASTAnalysisPass<Derived, AnalysisResult, Storage>>, public ASTAnalysisPassBase {
 public:
-    typedef std::map<const clang::NamedDecl*, AnalysisResult, ASTHelpers::DeclComparator> Data;
+    typedef typename Storage::template Map<AnalysisResult> Data;
     
 public:
     // MARK: Virtual
     // These methods can be used to customize the behavior of visiting the AST.
     // Override one or more Visit methods to analyze that part of the AST
-    virtual std::string serializationFileName() const = 0;
+    virtual std::string serializationFileName() const override = 0;
     virtual std::string testFileName() const = 0;
     virtual bool VisitCXXMethodDecl(clang::CXXMethodDecl* methodDecl) { return true; }
     virtual bool VisitFunctionDecl(clang::FunctionDecl* functionDecl) { return true; }
@@ -97,36 +188,83 @@ public:
     
     virtual bool VisitType(clang::Type* type) { return true; }
     
-    virtual bool shouldVisitTemplateInstantiations() const { return true; }
-    virtual bool shouldVisitImplicitCode() const { return true; }
+    virtual bool shouldVisitTemplateInstantiations() const override { return true; }
+    virtual bool shouldVisitImplicitCode() const override { return true; }
+    virtual bool traversesAST() const override { return true; }
+    virtual bool supportsIncrementalAnalysis() const override { return false; }
     
     // Finalize is automatically called on every NameDecl that has been insert_or_assign'd,
     // at the end of AST traversal. You can use this method to finalize analysis decisions
     // that require more than a single forward pass
     virtual void finalize(const clang::NamedDecl* namedDecl) {}
-    virtual bool shouldOnlyVisitDeclsFromUsd() const { return true; }
+    // Called once at the end of AST traversal, before finalize() is called on any decl
+    virtual void traversalIsFinished() {}
+    virtual bool shouldOnlyVisitDeclsFromUsd() const override { return true; }
     
     // Called after the analysis pass finishes testing, whether the AST was traversed or
     // the analysis pass was loaded from disk
-    virtual void analysisPassIsFinished() {}
+    virtual void analysisPassIsFinished() override {}
 
     // MARK: AST Traversal
     bool TraverseDecl(clang::Decl* decl) {
         if (!decl) { return true; }
         
-        bool fromUsd = isEarliestDeclLocFromUsd(decl) || (clang::dyn_cast<clang::TypeDecl>(decl) && doesTypeContainUsdTypes(clang::dyn_cast<clang::TypeDecl>(decl)));
         bool shouldVisit = (bool) clang::dyn_cast<clang::TranslationUnitDecl>(decl) ||
-                           fromUsd ||
-                           !shouldOnlyVisitDeclsFromUsd();
+                           !shouldOnlyVisitDeclsFromUsd() ||
+                           _isFromUsdWhileTraversing(decl);
         
         if (shouldVisit) {
             // Visit by calling the base class implementation
-            return clang::RecursiveASTVisitor<ASTAnalysisPass<Derived, AnalysisResult>>::TraverseDecl(decl);
+            _telemetryCounters.declsVisited += 1;
+            const clang::Decl* previouslyVisitedDecl = _currentlyVisitedDecl;
+            _currentlyVisitedDecl = decl;
+            bool result = clang::RecursiveASTVisitor<ASTAnalysisPass<Derived, AnalysisResult, Storage>>::TraverseDecl(decl);
+            _currentlyVisitedDecl = previouslyVisitedDecl;
+            return result;
         } else {
             // Continue traversal, but don't visit
             return true;
         }
     }
+    
+    bool _isFromUsdWhileTraversing(clang::Decl* decl) const override {
+        const clang::TypeDecl* typeDecl = clang::dyn_cast<clang::TypeDecl>(decl);
+        return isEarliestDeclLocFromUsd(decl) || (typeDecl && doesTypeContainUsdTypes(typeDecl));
+    }
+    
+    // Dispatches on the dynamic kind of the node the same way RecursiveASTVisitor does,
+    // so a fused traversal calls exactly the same Visit methods as our own traversal would
+    bool _walkUpFromDecl(clang::Decl* decl) override {
+        if (_isIncrementallyAnalyzing && !_incrementalFilesToVisit.contains(latestDeclLocFilePath(decl))) {
+            return true;
+        }
+        
+        _telemetryCounters.declsVisited += 1;
+        const clang::Decl* previouslyVisitedDecl = _currentlyVisitedDecl;
+        _currentlyVisitedDecl = decl;
+        bool result = true;
+        switch (decl->getKind()) {
+#define ABSTRACT_DECL(DECL)
+#define DECL(CLASS, BASE) \
+            case clang::Decl::CLASS: \
+                result = this->WalkUpFrom##CLASS##Decl(static_cast<clang::CLASS##Decl*>(decl)); \
+                break;
+#include "clang/AST/DeclNodes.inc"
+        }
+        _currentlyVisitedDecl = previouslyVisitedDecl;
+        return result;
+    }
+    
+    bool _walkUpFromType(clang::Type* type) override {
+        switch (type->getTypeClass()) {
+#define ABSTRACT_TYPE(CLASS, BASE)
+#define TYPE(CLASS, BASE) \
+            case clang::Type::CLASS: \
+                return this->WalkUpFrom##CLASS##Type(static_cast<clang::CLASS##Type*>(type));
+#include "clang/AST/TypeNodes.inc"
+        }
+        return true;
+    }
 
     // MARK: Accessors
 private:
@@ -152,6 +290,7 @@ public:
     }
     Data::iterator find(const clang::NamedDecl* namedDecl) {
         const clang::NamedDecl* x = _prepareForDataAccess(namedDecl);
+        _noteContribution(x);
         return _data.find(x);
     }
     Data::const_iterator end() const {
@@ -163,11 +302,15 @@ public:
     template <typename T>
     void insert_or_assign(const clang::NamedDecl* namedDecl, const T& value) {
         const clang::NamedDecl* x = _prepareForDataAccess(namedDecl);
+        _noteContribution(x);
+        _telemetryCounters.resultsInserted += 1;
         _data.insert_or_assign(x, AnalysisResult(value));
     }
     
     void insert_or_assign(const clang::NamedDecl* namedDecl, const AnalysisResult& analysisResult) {
         const clang::NamedDecl* x = _prepareForDataAccess(namedDecl);
+        _noteContribution(x);
+        _telemetryCounters.resultsInserted += 1;
         _data.insert_or_assign(x, analysisResult);
     }
     
@@ -189,30 +332,12 @@ public:
     }
     
     std::string makePathRelativeForUsd(const std::string& p) const {
-        const FileSystemInfo& f = getFileSystemInfo();
-        std::vector<std::string> prefixes = {
-            f.usdSourceRepoPath.string(),
-            f.usdInstalledHeaderPath.string(),
-        };
-        
-        for (const auto& prefix : prefixes) {
-            if (p.starts_with(prefix)) {
-                return p.substr(prefix.size() + 1);
-            }
-        }
-        
-        return "";
+        return getFileSystemInfo().makePathRelativeForUsd(p);
     }
     
     std::string makePathIncludeForUsd(const std::string& p) const {
-        static std::vector<std::filesystem::path> publicHeaders = getFileSystemInfo().getListOfPublicHeaders();
-        for (const auto& h : publicHeaders) {
-            if (h.string() == p) {
-                return makePathRelativeForUsd(p);
-            }
-        }
-        
-        return "";
+        const CMakeParser::UsdFileInfo* usdFileInfo = getASTAnalysisRunner().getDriver()->getCMakeParser()->getUsdFileInfo(p);
+        return usdFileInfo && usdFileInfo->isPublic ? usdFileInfo->includePath : "";
     }
     
     
@@ -222,80 +347,57 @@ public:
     // given `shared_ptr<HdTask>`, returns a stl header for `<memory.h>`.
     // Compare with latestDeclLocFilePath.
     std::string earliestDeclLocFilePath(const clang::Decl* decl) const {
-        if (!decl) { return ""; }
-        
-        const clang::SourceManager& sourceManager = decl->getASTContext().getSourceManager();
-        // Using getExpansionLoc is _very_ important, because we care about where a macro expands to,
-        // and "expansion locations represent where the location is in the user's view"
-        clang::SourceLocation spellingLoc = sourceManager.getExpansionLoc(decl->getLocation());
-        
-        std::string filePath = sourceManager.getFilename(spellingLoc).str();
-        return filePath;
+        return getASTAnalysisRunner().getEarliestDeclLocFileClassification(decl).fileName;
     }
     
     // Given `TfRefPtr<UsdStage>`, returns `pxr/usd/usd/stage.h`,
     // given `shared_ptr<HdTask>`, returns `pxr/imaging/hd/task.h`.
     // Compare with earliestDeclLocFilePath.
     std::string latestDeclLocFilePath(const clang::Decl* decl) const {
-        if (!decl) { return ""; }
-        
-        const clang::SourceManager& sourceManager = decl->getASTContext().getSourceManager();
-        clang::SourceLocation loc = ASTHelpers::getLatestSourceLocation(decl);
-        std::string filePath = sourceManager.getFilename(loc).str();
-        
-        return filePath;
+        return getASTAnalysisRunner().getLatestDeclLocFileClassification(decl).fileName;
     }
     
     std::string headerPathForUsdType(const clang::Decl* decl) const {
-        return makePathRelativeForUsd(latestDeclLocFilePath(decl));
+        return getASTAnalysisRunner().getLatestDeclLocFileClassification(decl).relativePath;
     }
     
     std::string makePathIncludeForUsd(const clang::Decl* decl) const {
-        return makePathIncludeForUsd(latestDeclLocFilePath(decl));
+        const ASTFileClassifier::FileClassification& classification = getASTAnalysisRunner().getLatestDeclLocFileClassification(decl);
+        return classification.isPublicHeader ? classification.relativePath : "";
     }
     
     bool isEarliestDeclLocFromUsd(const clang::Decl* decl) const {
-        return makePathRelativeForUsd(earliestDeclLocFilePath(decl)) != "";
+        return getASTAnalysisRunner().getEarliestDeclLocFileClassification(decl).isFromUsd();
     }
     
     std::string getUsdLibraryForDecl(const clang::Decl* decl) const {
-        std::string relative = makePathRelativeForUsd(latestDeclLocFilePath(decl));
-        if (relative == "") {
-            return "";
-        }
-        
-        // pxr/foo/result/bar.h
-        std::vector<std::string> components = splitStringByRegex(relative, std::regex("/"));
-        if (components.size() < 3) { return ""; }
-        return components[2];
+        return getASTAnalysisRunner().getLatestDeclLocFileClassification(decl).libraryName;
     }
     
-    bool isFromUsdLibrary(const clang::Decl* decl, std::string lib) const {
-        return lib == getUsdLibraryForDecl(decl);
+    bool isFromUsdLibrary(const clang::Decl* decl, const std::string& lib) const {
+        return lib == getASTAnalysisRunner().getLatestDeclLocFileClassification(decl).libraryName;
     }
     
-    bool isFromUsdLibraryStrictlyBefore(const clang::Decl* decl, std::string lib) const {
-        std::string declLib = getUsdLibraryForDecl(decl);
-        
-        if (lib == declLib) {
+    bool isFromUsdLibraryStrictlyBefore(const clang::Decl* decl, const std::string& lib) const {
+        const ASTFileClassifier::FileClassification& classification = getASTAnalysisRunner().getLatestDeclLocFileClassification(decl);
+        if (lib == classification.libraryName) {
             // Same library isn't strictly before
             return false;
         }
         
-        std::vector<std::string> allLibs = getASTAnalysisRunner().getDriver()->getCMakeParser()->getNamesOfPxrLibraries();
-        for (const auto& someLib : allLibs) {
-            if (someLib == declLib) {
-                // Got to the decl's lib before the argument lib
-                return true;
-            }
-            if (someLib == lib) {
-                // Got to the argument lib before the decl's lib
-                return false;
-            }
+        int libOrdinal = getASTAnalysisRunner().getPxrLibraryOrdinal(lib);
+        if (libOrdinal == -1 && classification.libraryOrdinal == -1) {
+            std::cout << "WARNING: '" << lib << "' not contained in CMakeParser.getNamesOfPxrLibraries()" << std::endl;
+            return false;
         }
-        
-        std::cout << "WARNING: '" << lib << "' not contained in CMakeParser.getNamesOfPxrLibraries()" << std::endl;
-        return false;
+        // A decl from a library CMake doesn't know about comes after every library that it does know
+        if (classification.libraryOrdinal == -1) {
+            return false;
+        }
+        if (libOrdinal == -1) {
+            return true;
+        }
+        return classification.libraryOrdinal < libOrdinal;
     }
     
     bool doesTypeContainUsdTypes(const clang::TypeDecl* typeDecl) const {
@@ -356,7 +458,7 @@ public:
     }
 
     // MARK: Serialization
-    virtual void serialize() const {
+    virtual void serialize() const override {
         std::cout << "Serializing " << serializationFileName() << std::endl;
         
         const FileSystemInfo& f = getFileSystemInfo();
@@ -373,33 +475,74 @@ public:
         }
         
         stream.close();
+        _serializeBinaryCache();
+        
+        if (_incrementalRecord) {
+            _incrementalRecord->write(f.getSerializedAnalysisIncrementalRecordPath(serializationFileName()));
+        }
     }
-    virtual bool deserialize() {
+    virtual bool deserialize() override {
+        _keepsIncrementalRecord = getASTAnalysisRunner().getDriver()->isIncrementalAnalysisEnabled();
+        _recordsContributions = _keepsIncrementalRecord && supportsIncrementalAnalysis();
+        _changedResultNames = std::set<std::string>();
+        
         const FileSystemInfo& f = getFileSystemInfo();
         std::filesystem::path filePath = f.getSerializedAnalysisPath(serializationFileName());
         
+        // Without a record, there's no way to tell if results
+        // from disk are from an older AST, so start over
+        if (_keepsIncrementalRecord && !std::filesystem::exists(f.getSerializedAnalysisIncrementalRecordPath(serializationFileName()))) {
+            _changedResultNames = std::nullopt;
+            return false;
+        }
+        
+        // Deleting the text file is how to force a pass to be analyzed again,
+        // so a binary cache without one is stale
         if (!std::filesystem::exists(filePath)) {
+            std::filesystem::remove(f.getSerializedAnalysisCachePath(serializationFileName()));
+            _changedResultNames = std::nullopt;
             return false;
         }
         
+        if (_deserializeBinaryCache()) {
+            return true;
+        }
+        
+        if (_keepsIncrementalRecord) {
+            std::optional<ASTAnalysisIncrementalRecord> record = ASTAnalysisIncrementalRecord::load(f.getSerializedAnalysisIncrementalRecordPath(serializationFileName()));
+            uint64_t fingerprint = getASTAnalysisRunner().getDriver()->getClangToolHelper()->getSerializedASTFingerprint();
+            if (record && record->astFingerprint != fingerprint) {
+                // The AST was rebuilt since these results were computed, so some of them
+                // have to be recomputed. If this pass supports it, analysis will
+                // only revisit what it has to
+                _changedResultNames = std::nullopt;
+                _previousIncrementalRecord = std::move(record);
+                if (supportsIncrementalAnalysis()) {
+                    _prepareIncrementalAnalysis();
+                }
+                return false;
+            }
+        }
+        
         std::cout << "Deserializing " << serializationFileName() << std::endl;
         
         // Important! Don't do PXR_NS replacement on the serialized result data, because
         // some types include `PXR_NS` as part of a token
-        std::vector<std::vector<std::string>> loadedFields = TestDataLoader::load(filePath, TestDataLoader::PxrNsReplacement::dontReplace);
+        TestDataReader reader(filePath, TestDataLoader::PxrNsReplacement::dontReplace);
         
-        for (const std::vector<std::string>& line : loadedFields) {
+        while (reader.next()) {
+            const std::vector<std::string_view>& line = reader.fields();
             if (line.size() != 2) {
                 std::cerr << "Expected 2 fields in deserialization, but got " << line.size() << std::endl;
-                for (const std::string& x : line) {
+                for (std::string_view x : line) {
                     std::cerr << x << "; ";
                 }
                 std::cerr << std::endl;
                 __builtin_trap();
             }
             
-            std::string declName = line[0];
-            std::string data = line[1];
+            std::string declName = std::string(line[0]);
+            std::string data = std::string(line[1]);
             
             const clang::NamedDecl* namedDecl = findNamedDecl(declName);
             if (!namedDecl) {
@@ -416,6 +559,90 @@ public:
             insert_or_assign_while_deserializing(namedDecl, *analysisResult);
         }
         
+        // Next time, skip looking up every decl by name
+        _serializeBinaryCache();
+        return true;
+    }
+    
+private:
+    // The text file is kept as a human-readable export, but the binary cache
+    // is keyed by DeclID so loading it doesn't need to look up decls by name.
+    // The cache records the text file's size and modification time, so it's only used while the text file is unchanged
+    //
+    // Results that provide serializeBinary() and deserializeBinary() are stored in that form,
+    // and everything else falls back to the same text as the text file
+    static constexpr bool _hasBinaryResultEncoding = requires(const AnalysisResult& result, std::string& out, std::string_view data, const Derived* pass) {
+        result.serializeBinary(out);
+        { AnalysisResult::deserializeBinary(data, pass) } -> std::same_as<std::optional<AnalysisResult>>;
+    };
+    static constexpr BinaryAnalysisCache::ValueFormat _binaryCacheValueFormat = _hasBinaryResultEncoding ? BinaryAnalysisCache::ValueFormat::binary : BinaryAnalysisCache::ValueFormat::text;
+    
+    void _serializeBinaryCache() const {
+        std::filesystem::path cachePath = getFileSystemInfo().getSerializedAnalysisCachePath(serializationFileName());
+        BinaryAnalysisCache::SourceStamp textStamp = BinaryAnalysisCache::stampFile(getFileSystemInfo().getSerializedAnalysisPath(serializationFileName()));
+        
+        std::vector<std::pair<uint64_t, std::string>> records;
+        records.reserve(_data.size());
+        for (const auto& it : _data) {
+            uint64_t declID = getASTAnalysisRunner().getSerializedDeclID(it.first);
+            if (declID == 0) {
+                // Can't key this decl, so fall back to the text file
+                std::filesystem::remove(cachePath);
+                return;
+            }
+            std::string value;
+            if constexpr (_hasBinaryResultEncoding) {
+                it.second.serializeBinary(value);
+            } else {
+                // Trim now, the same way reading the text file does, so reading the cache doesn't have to
+                std::ostringstream stream;
+                stream << it.second;
+                value = trimWhitespace(stream.str());
+            }
+            records.push_back({declID, std::move(value)});
+        }
+        
+        std::filesystem::create_directories(cachePath.parent_path());
+        uint64_t fingerprint = getASTAnalysisRunner().getDriver()->getClangToolHelper()->getSerializedASTFingerprint();
+        if (!BinaryAnalysisCache::write(cachePath, fingerprint, textStamp, _binaryCacheValueFormat, records)) {
+            std::cerr << "Could not write " << cachePath << std::endl;
+        }
+    }
+    
+    bool _deserializeBinaryCache() {
+        std::filesystem::path cachePath = getFileSystemInfo().getSerializedAnalysisCachePath(serializationFileName());
+        uint64_t fingerprint = getASTAnalysisRunner().getDriver()->getClangToolHelper()->getSerializedASTFingerprint();
+        BinaryAnalysisCache::SourceStamp textStamp = BinaryAnalysisCache::stampFile(getFileSystemInfo().getSerializedAnalysisPath(serializationFileName()));
+        std::unique_ptr<BinaryAnalysisCache> cache = BinaryAnalysisCache::load(cachePath, fingerprint, textStamp, _binaryCacheValueFormat);
+        if (!cache) {
+            return false;
+        }
+        
+        std::cout << "Deserializing " << serializationFileName() << " from binary cache" << std::endl;
+        
+        for (uint64_t i = 0; i < cache->size(); i++) {
+            BinaryAnalysisCache::Record record = (*cache)[i];
+            
+            const clang::NamedDecl* namedDecl = clang::dyn_cast_or_null<clang::NamedDecl>(getASTAnalysisRunner().getDeclForSerializedDeclID(record.key));
+            if (!namedDecl) {
+                std::cerr << "Could not find decl " << record.key << " while deserializing" << std::endl;
+                __builtin_trap();
+            }
+            
+            std::optional<AnalysisResult> analysisResult;
+            if constexpr (_hasBinaryResultEncoding) {
+                analysisResult = AnalysisResult::deserializeBinary(record.value, static_cast<Derived*>(this));
+            } else {
+                analysisResult = AnalysisResult::deserialize(std::string(record.value), static_cast<Derived*>(this));
+            }
+            if (!analysisResult) {
+                std::cerr << "Could not deserialize the cached result for decl " << record.key << std::endl;
+                __builtin_trap();
+            }
+            
+            insert_or_assign_while_deserializing(namedDecl, *analysisResult);
+        }
+        
         return true;
     }
     
@@ -423,24 +650,197 @@ protected:
     // MARK: Analysis and Testing
     ASTAnalysisPass(ASTAnalysisRunner* astAnalysisRunner) :
     _astAnalysisRunner(astAnalysisRunner),
-    _data({})
+    _data({}),
+    _keepsIncrementalRecord(false),
+    _recordsContributions(false),
+    _currentlyVisitedDecl(nullptr),
+    _isIncrementallyAnalyzing(false),
+    _incrementalAnalysisFailed(false)
     {
     }
     
 private:
-    void analyze() {
+    void analyze() override {
         std::cout << "Analyzing " << serializationFileName() << std::endl;
+        // Only fused traversals skip decls outside of the files being revisited
+        _abandonIncrementalAnalysis();
         TraverseDecl((clang::TranslationUnitDecl*) getASTAnalysisRunner().getTranslationUnitDecl());
+    }
+    
+public:
+    void _finalizeAll() override {
+        if (_incrementalAnalysisFailed) {
+            // A revisited decl touched a result that was kept from the last run,
+            // so it must have been missing from the record. Start over from scratch
+            std::cout << "Incremental analysis of " << serializationFileName() << " touched a kept result, analyzing everything" << std::endl;
+            _abandonIncrementalAnalysis();
+            TraverseDecl((clang::TranslationUnitDecl*) getASTAnalysisRunner().getTranslationUnitDecl());
+        }
+        
+        traversalIsFinished();
+        
         for (const auto& it : _data) {
-            finalize(it.first);
+            if (!_keptDecls.contains(it.first)) {
+                finalize(it.first);
+            }
+        }
+        
+        _makeIncrementalRecord();
+    }
+    
+    void _prepareDataForSharing() const override {
+        if constexpr (requires { _data.sort(); }) {
+            _data.sort();
         }
     }
     
+    const std::set<std::string>* _getChangedResultNames() const override {
+        return _changedResultNames ? &*_changedResultNames : nullptr;
+    }
+    
+    Telemetry::Counters _getTelemetryCounters() const override {
+        return _telemetryCounters;
+    }
+    const Telemetry* _getTelemetry() const override {
+        return getASTAnalysisRunner().getDriver()->getTelemetry();
+    }
+    
+private:
+    // MARK: Incremental analysis
+    void _noteContribution(const clang::NamedDecl* namedDecl) {
+        if (!_recordsContributions || !_currentlyVisitedDecl) {
+            return;
+        }
+        if (_keptDecls.contains(namedDecl)) {
+            _incrementalAnalysisFailed = true;
+        }
+        _contributingDecls[namedDecl].insert(_currentlyVisitedDecl);
+    }
+    
+    // Keeps every result from the last run whose inputs didn't change,
+    // and decides which files have to be revisited to recompute the rest
+    void _prepareIncrementalAnalysis() {
+        const ASTAnalysisIncrementalRecord& record = *_previousIncrementalRecord;
+        
+        // Files that are new, or that the AST no longer includes, count as changed,
+        // because they can add results that weren't in the record
+        const std::set<std::string>& inputFiles = getASTAnalysisRunner().getASTInputFiles();
+        std::set<std::string> changedFiles;
+        for (const auto& it : record.fileDigests) {
+            if (!inputFiles.contains(it.first) || getASTAnalysisRunner().getSourceFileDigest(it.first) != it.second) {
+                changedFiles.insert(it.first);
+            }
+        }
+        for (const std::string& file : inputFiles) {
+            if (!record.fileDigests.contains(file)) {
+                changedFiles.insert(file);
+            }
+        }
+        std::set<std::string> changedUpstreamResults;
+        for (const ASTAnalysisPassBase* dependency : getDependencies()) {
+            const std::set<std::string>* changed = dependency->_getChangedResultNames();
+            if (!changed) {
+                // Anything could have changed
+                return;
+            }
+            changedUpstreamResults.insert(changed->begin(), changed->end());
+        }
+        
+        std::set<std::string> filesToVisit;
+        std::set<std::string> toRecompute = record.findResultsToRecompute(changedFiles, changedUpstreamResults, [this](const std::string& name) {
+            return latestDeclLocFilePath(findNamedDecl(name));
+        }, filesToVisit);
+        
+        for (const auto& it : record.results) {
+            if (toRecompute.contains(it.first)) {
+                continue;
+            }
+            const clang::NamedDecl* namedDecl = findNamedDecl(it.first);
+            std::optional<AnalysisResult> analysisResult = AnalysisResult::deserialize(it.second.data, static_cast<Derived*>(this));
+            if (!namedDecl || !analysisResult) {
+                // The decl went away even though none of its files changed,
+                // so the record can't be trusted
+                _abandonIncrementalAnalysis();
+                return;
+            }
+            insert_or_assign_while_deserializing(namedDecl, *analysisResult);
+            _keptDecls.insert(_prepareForDataAccess(namedDecl));
+        }
+        
+        std::cout << "Incrementally analyzing " << serializationFileName() << ": keeping " << _keptDecls.size() << " of " << record.results.size() << " results, revisiting " << filesToVisit.size() << " files" << std::endl;
+        _incrementalFilesToVisit = std::move(filesToVisit);
+        _isIncrementallyAnalyzing = true;
+    }
+    
+    void _abandonIncrementalAnalysis() {
+        if (!_keptDecls.empty()) {
+            _data.clear();
+        }
+        _keptDecls.clear();
+        _contributingDecls.clear();
+        _incrementalFilesToVisit.clear();
+        _isIncrementallyAnalyzing = false;
+        _incrementalAnalysisFailed = false;
+    }
+    
+    // Every pass keeps a record with `--incremental`, so that passes that depend on it
+    // know which of its results changed, but only passes that support incremental analysis
+    // record which files their results came from
+    void _makeIncrementalRecord() {
+        if (!_keepsIncrementalRecord) {
+            return;
+        }
+        
+        ASTAnalysisIncrementalRecord record;
+        record.astFingerprint = getASTAnalysisRunner().getDriver()->getClangToolHelper()->getSerializedASTFingerprint();
+        if (_recordsContributions) {
+            // Every input file, not just the ones results came from,
+            // so the next run can tell which files are new
+            for (const std::string& file : getASTAnalysisRunner().getASTInputFiles()) {
+                record.fileDigests.insert({file, getASTAnalysisRunner().getSourceFileDigest(file)});
+            }
+        }
+        for (const auto& it : _data) {
+            std::string name = ASTHelpers::getAsString(it.first);
+            std::ostringstream data;
+            data << it.second;
+            
+            std::set<std::string> files;
+            if (!_recordsContributions) {
+                // Nothing to record
+            } else if (_keptDecls.contains(it.first)) {
+                const auto& previousIt = _previousIncrementalRecord->results.find(name);
+                if (previousIt != _previousIncrementalRecord->results.end()) {
+                    files.insert(previousIt->second.files.begin(), previousIt->second.files.end());
+                }
+            } else {
+                files.insert(latestDeclLocFilePath(it.first));
+                const auto& contributingIt = _contributingDecls.find(it.first);
+                if (contributingIt != _contributingDecls.end()) {
+                    for (const clang::Decl* decl : contributingIt->second) {
+                        files.insert(latestDeclLocFilePath(decl));
+                    }
+                }
+            }
+            files.erase("");
+            
+            for (const std::string& file : files) {
+                record.fileDigests.insert({file, getASTAnalysisRunner().getSourceFileDigest(file)});
+            }
+            record.results.insert_or_assign(name, ASTAnalysisIncrementalRecord::Result{data.str(), std::vector<std::string>(files.begin(), files.end())});
+        }
+        
+        if (_previousIncrementalRecord) {
+            _changedResultNames = ASTAnalysisIncrementalRecord::changedResults(*_previousIncrementalRecord, record);
+        }
+        _incrementalRecord = std::move(record);
+    }
+    
 protected:
     // Prefer overriding comparesEqualWhileTesting().
     // Only override the test() function if really needed. The default
     // behavior ensures that testing occurs automatically after every analysis pass finishes
-    virtual void test() const {
+    virtual void test() const override {
         std::cout << "Testing " << serializationFileName() << std::endl;
         // Let testing do PXR_NS replacement, because we don't usually write tests using types
         // that contain `PXR_NS` as part of a token
@@ -504,6 +904,21 @@ private:
     
     ASTAnalysisRunner* _astAnalysisRunner;
     Data _data;
+    
+    bool _keepsIncrementalRecord;
+    bool _recordsContributions;
+    const clang::Decl* _currentlyVisitedDecl;
+    // Decls whose visits touched each result
+    std::unordered_map<const clang::NamedDecl*, std::set<const clang::Decl*>> _contributingDecls;
+    bool _isIncrementallyAnalyzing;
+    bool _incrementalAnalysisFailed;
+    std::set<std::string> _incrementalFilesToVisit;
+    // Results kept from the last run without being recomputed
+    std::set<const clang::NamedDecl*> _keptDecls;
+    std::optional<ASTAnalysisIncrementalRecord> _previousIncrementalRecord;
+    std::optional<ASTAnalysisIncrementalRecord> _incrementalRecord;
+    std::optional<std::set<std::string>> _changedResultNames;
+    Telemetry::Counters _telemetryCounters;
 };
 
 class ASTAnalysisPassFactory {
@@ -511,14 +926,29 @@ public:
     template <typename T>
     static std::unique_ptr<T> makeAnalysisPass(ASTAnalysisRunner* astAnalysisRunner) {
         std::unique_ptr<T> result = std::make_unique<T>(astAnalysisRunner);
-        if (!result->deserialize()) {
-            result->analyze();
-            result->serialize();
+        bool didDeserialize = measure(result.get(), "deserialize", [&]() { return result->deserialize(); });
+        if (!didDeserialize) {
+            measure(result.get(), "analyze", [&]() { result->analyze(); return true; });
+            measure(result.get(), "finalize", [&]() { result->_finalizeAll(); return true; });
+            measure(result.get(), "serialize", [&]() { result->serialize(); return true; });
         }
-        result->test();
+        measure(result.get(), "test", [&]() { result->test(); return true; });
         result->analysisPassIsFinished();
         return result;
     }
+    
+    // Runs one phase of a pass, and records it with the Driver's telemetry.
+    // `phase` returns whether it hit a cache, which is only recorded for deserialization
+    static bool measure(ASTAnalysisPassBase* pass, const std::string& phaseName, const std::function<bool()>& phase) {
+        Telemetry::Measurement measurement(pass->_getTelemetry(), pass->getPassName(), phaseName, [pass]() {
+            return pass->_getTelemetryCounters();
+        });
+        bool result = phase();
+        if (phaseName == "deserialize") {
+            measurement.setCacheHit(result);
+        }
+        return result;
+    }
 };
 
 
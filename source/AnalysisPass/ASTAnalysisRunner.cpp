@@ -19,6 +19,9 @@
 //===----------------------------------------------------------------------===//
 
 #include "AnalysisPass/ASTAnalysisRunner.h"
+#include "AnalysisPass/ASTAnalysisScheduler.h"
+#include "AnalysisPass/ASTShardIndex.h"
+#include "AnalysisPass/OperatorCandidateIndex.h"
 #include "Driver/Driver.h"
 #include "Util/TestDataLoader.h"
 #include "Util/FileWriterHelper.h"
@@ -28,6 +31,9 @@
 #include "clang/AST/RecursiveASTVisitor.h"
 #include "clang/Sema/Sema.h"
 #include "clang/Sema/Lookup.h"
+#include "clang/Serialization/ASTReader.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/xxhash.h"
 #include <regex>
 #include <filesystem>
 #include <fstream>
@@ -57,39 +63,57 @@
 ASTAnalysisRunner::~ASTAnalysisRunner() {}
 
 ASTAnalysisRunner::ASTAnalysisRunner(const Driver* driver) :
-    _driver(driver)
+    _driver(driver),
+    _isASTFullyDeserialized(false),
+    _hasOperatorCandidateIndex(false)
 {
-    if (_driver->getClangToolHelper()->getASTUnits().size() != 1) {
-        std::cerr << "Error! Expected 1 AST unit, but got " << _driver->getClangToolHelper()->getASTUnits().size() << std::endl;
+    if (_driver->getClangToolHelper()->getASTUnits().empty()) {
+        std::cerr << "Error! Expected at least 1 AST unit" << std::endl;
         __builtin_trap();
     }
+    // Passes traverse the first unit. Any others are shards, which are only used for lookups
     _astUnit = _driver->getClangToolHelper()->getASTUnits().front().get();
     _astContext = &_astUnit->getASTContext();
     _sourceManager = &_astUnit->getSourceManager();
     _translationUnitDecl = _astContext->getTranslationUnitDecl();
+    for (const auto& astUnit : _driver->getClangToolHelper()->getASTUnits()) {
+        const clang::SourceManager* sourceManager = &astUnit->getSourceManager();
+        _fileClassifiers[sourceManager] = std::make_unique<ASTFileClassifier>(_driver, sourceManager);
+    }
     
     // Now that we've set up our clang fields,
-    // start doing analysis passes. The order we do these in
-    // is important, because later passes may assume earlier passes
-    // have already completed
+    // start doing analysis passes. Every pass looks up decls by name
+    // (even while deserializing), so FindNamedDecls has to run on its own
+    // before anything else
     _findNamedDeclsAnalysisPass = ASTAnalysisPassFactory::makeAnalysisPass<FindNamedDeclsAnalysisPass>(this);
-    _importAnalysisPass = ASTAnalysisPassFactory::makeAnalysisPass<ImportAnalysisPass>(this);
-    _publicInheritanceAnalysisPass = ASTAnalysisPassFactory::makeAnalysisPass<PublicInheritanceAnalysisPass>(this);
-    _equatableAnalysisPass = ASTAnalysisPassFactory::makeAnalysisPass<EquatableAnalysisPass>(this);
-    _hashableAnalysisPass = ASTAnalysisPassFactory::makeAnalysisPass<HashableAnalysisPass>(this);
-    _comparableAnalysisPass = ASTAnalysisPassFactory::makeAnalysisPass<ComparableAnalysisPass>(this);
-    _findEnumsAnalysisPass = ASTAnalysisPassFactory::makeAnalysisPass<FindEnumsAnalysisPass>(this);
-    _findStaticTokensAnalysisPass = ASTAnalysisPassFactory::makeAnalysisPass<FindStaticTokensAnalysisPass>(this);
-    _findTfNoticeSubclassesAnalysisPass = ASTAnalysisPassFactory::makeAnalysisPass<FindTfNoticeSubclassesAnalysisPass>(this);
-    _customStringConvertibleAnalysisPass = ASTAnalysisPassFactory::makeAnalysisPass<CustomStringConvertibleAnalysisPass>(this);
-    _swiftSubclassCxxAnalysisPass = ASTAnalysisPassFactory::makeAnalysisPass<SwiftSubclassCxxAnalysisPass>(this);
-    _typedefAnalysisPass = ASTAnalysisPassFactory::makeAnalysisPass<TypedefAnalysisPass>(this);
-    _sdfValueTypeNamesMembersAnalysisPass = ASTAnalysisPassFactory::makeAnalysisPass<SdfValueTypeNamesMembersAnalysisPass>(this);
-    _findSchemasAnalysisPass = ASTAnalysisPassFactory::makeAnalysisPass<FindSchemasAnalysisPass>(this);
-    _findVtValueRefFunctionsAnalysisPass = ASTAnalysisPassFactory::makeAnalysisPass<FindVtValueRefFunctionsAnalysisPass>(this);
-    _findSendableDependenciesAnalysisPass = ASTAnalysisPassFactory::makeAnalysisPass<FindSendableDependenciesAnalysisPass>(this);
-    _sendableAnalysisPass = ASTAnalysisPassFactory::makeAnalysisPass<SendableAnalysisPass>(this);
-    _apiNotesAnalysisPass = ASTAnalysisPassFactory::makeAnalysisPass<APINotesAnalysisPass>(this);
+    if (_driver->getClangToolHelper()->getASTUnits().size() > 1) {
+        _shardIndex = std::make_unique<ASTShardIndex>(this);
+    }
+    
+    // Every other pass declares the passes it depends on,
+    // and the scheduler runs independent passes in parallel
+    ASTAnalysisScheduler scheduler(this);
+    _importAnalysisPass = scheduler.add<ImportAnalysisPass>();
+    _publicInheritanceAnalysisPass = scheduler.add<PublicInheritanceAnalysisPass>();
+    _equatableAnalysisPass = scheduler.add<EquatableAnalysisPass>();
+    _hashableAnalysisPass = scheduler.add<HashableAnalysisPass>();
+    _comparableAnalysisPass = scheduler.add<ComparableAnalysisPass>();
+    _findEnumsAnalysisPass = scheduler.add<FindEnumsAnalysisPass>();
+    _findStaticTokensAnalysisPass = scheduler.add<FindStaticTokensAnalysisPass>();
+    _findTfNoticeSubclassesAnalysisPass = scheduler.add<FindTfNoticeSubclassesAnalysisPass>();
+    _customStringConvertibleAnalysisPass = scheduler.add<CustomStringConvertibleAnalysisPass>();
+    _swiftSubclassCxxAnalysisPass = scheduler.add<SwiftSubclassCxxAnalysisPass>();
+    _typedefAnalysisPass = scheduler.add<TypedefAnalysisPass>();
+    _sdfValueTypeNamesMembersAnalysisPass = scheduler.add<SdfValueTypeNamesMembersAnalysisPass>();
+    _findSchemasAnalysisPass = scheduler.add<FindSchemasAnalysisPass>();
+    _findVtValueRefFunctionsAnalysisPass = scheduler.add<FindVtValueRefFunctionsAnalysisPass>();
+    _findSendableDependenciesAnalysisPass = scheduler.add<FindSendableDependenciesAnalysisPass>();
+    _sendableAnalysisPass = scheduler.add<SendableAnalysisPass>();
+    _apiNotesAnalysisPass = scheduler.add<APINotesAnalysisPass>();
+    if (const std::set<std::string>* requested = _driver->getRequestedAnalysisPasses()) {
+        scheduler.restrictTo(*requested);
+    }
+    scheduler.run();
 }
 
 // MARK: Accessors
@@ -112,12 +136,127 @@ const clang::TranslationUnitDecl* ASTAnalysisRunner::getTranslationUnitDecl() co
     return _translationUnitDecl;
 }
 
+uint64_t ASTAnalysisRunner::getSerializedDeclID(const clang::Decl* decl) const {
+    if (!decl || !decl->isFromASTFile()) {
+        return 0;
+    }
+    // With `--sharded-ast`, decls can come from any unit, and each unit numbers its own decls,
+    // so the top byte says which unit to resolve the ID in
+    const std::vector<std::unique_ptr<clang::ASTUnit>>& astUnits = _driver->getClangToolHelper()->getASTUnits();
+    const clang::ASTContext* astContext = &decl->getASTContext();
+    uint64_t unitIndex = 0;
+    while (unitIndex < astUnits.size() && &astUnits[unitIndex]->getASTContext() != astContext) {
+        unitIndex++;
+    }
+    uint64_t rawValue = decl->getGlobalID().getRawValue();
+    if (unitIndex == astUnits.size() || unitIndex > _maxSerializedDeclIDUnitIndex || rawValue > _serializedDeclIDRawValueMask) {
+        return 0;
+    }
+    return (unitIndex << _serializedDeclIDUnitIndexShift) | rawValue;
+}
+
+const clang::Decl* ASTAnalysisRunner::getDeclForSerializedDeclID(uint64_t declID) const {
+    if (declID == 0) {
+        return nullptr;
+    }
+    const std::vector<std::unique_ptr<clang::ASTUnit>>& astUnits = _driver->getClangToolHelper()->getASTUnits();
+    uint64_t unitIndex = declID >> _serializedDeclIDUnitIndexShift;
+    if (unitIndex >= astUnits.size()) {
+        return nullptr;
+    }
+    // The reader may need to deserialize the decl, and
+    // passes can deserialize in parallel
+    std::lock_guard<std::mutex> lock(ASTHelpers::getClangMutex());
+    return astUnits[unitIndex]->getASTReader()->GetDecl(clang::GlobalDeclID(declID & _serializedDeclIDRawValueMask));
+}
+
+namespace {
+    struct FullASTDeserializer : public clang::RecursiveASTVisitor<FullASTDeserializer> {
+        bool shouldVisitTemplateInstantiations() const { return true; }
+        bool shouldVisitImplicitCode() const { return true; }
+    };
+}
+
+void ASTAnalysisRunner::ensureASTIsFullyDeserialized() const {
+    std::call_once(_astIsFullyDeserializedFlag, [this]() {
+        if (!_findNamedDeclsAnalysisPass->didLoadNameIndex()) {
+            // FindNamedDecls already traversed everything
+            _isASTFullyDeserialized = true;
+            return;
+        }
+        std::cout << "Deserializing AST" << std::endl;
+        std::lock_guard<std::mutex> lock(ASTHelpers::getClangMutex());
+        FullASTDeserializer visitor;
+        visitor.TraverseDecl((clang::TranslationUnitDecl*) _translationUnitDecl);
+        _isASTFullyDeserialized = true;
+    });
+}
+
+bool ASTAnalysisRunner::isASTLazilyLoaded() const {
+    return _findNamedDeclsAnalysisPass->didLoadNameIndex() && !_isASTFullyDeserialized;
+}
+
+uint64_t ASTAnalysisRunner::getSourceFileDigest(const std::string& path) const {
+    {
+        std::lock_guard<std::mutex> lock(_sourceFileDigestsMutex);
+        const auto& it = _sourceFileDigests.find(path);
+        if (it != _sourceFileDigests.end()) {
+            return it->second;
+        }
+    }
+    
+    uint64_t result = 0;
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> buffer = llvm::MemoryBuffer::getFile(path);
+    if (buffer) {
+        // Don't let an empty file look like a missing one
+        result = llvm::xxh3_64bits((*buffer)->getBuffer()) | 1;
+    }
+    
+    std::lock_guard<std::mutex> lock(_sourceFileDigestsMutex);
+    _sourceFileDigests.insert({path, result});
+    return result;
+}
+
+const std::set<std::string>& ASTAnalysisRunner::getASTInputFiles() const {
+    std::call_once(_astInputFilesFlag, [this]() {
+        _astInputFiles = _fileClassifiers.at(_sourceManager)->getFileNames();
+    });
+    return _astInputFiles;
+}
+
+const ASTFileClassifier::FileClassification& ASTAnalysisRunner::getEarliestDeclLocFileClassification(const clang::Decl* decl) const {
+    if (!decl) {
+        return ASTFileClassifier::getEmptyClassification();
+    }
+    const clang::SourceManager& sourceManager = decl->getASTContext().getSourceManager();
+    // Classifying by expansion location is _very_ important, because we care about where a macro expands to,
+    // and "expansion locations represent where the location is in the user's view".
+    // classify() does that itself, without calling into the source manager
+    return _fileClassifiers.at(&sourceManager)->classify(decl->getLocation());
+}
+
+const ASTFileClassifier::FileClassification& ASTAnalysisRunner::getLatestDeclLocFileClassification(const clang::Decl* decl) const {
+    if (!decl) {
+        return ASTFileClassifier::getEmptyClassification();
+    }
+    const clang::SourceManager& sourceManager = decl->getASTContext().getSourceManager();
+    return _fileClassifiers.at(&sourceManager)->classify(ASTHelpers::getLatestSourceLocation(decl));
+}
+
+int ASTAnalysisRunner::getPxrLibraryOrdinal(const std::string& libraryName) const {
+    return _fileClassifiers.at(_sourceManager)->getLibraryOrdinal(libraryName);
+}
+
 const clang::TagDecl* ASTAnalysisRunner::findTagDecl(const std::string &typeName) const {
-    return _findNamedDeclsAnalysisPass->findTagDecl(typeName);
+    return clang::dyn_cast_or_null<clang::TagDecl>(findNamedDecl(typeName));
 }
 
 const clang::NamedDecl* ASTAnalysisRunner::findNamedDecl(const std::string &name) const {
-    return _findNamedDeclsAnalysisPass->findNamedDecl(name);
+    const clang::NamedDecl* result = _findNamedDeclsAnalysisPass->findNamedDecl(name);
+    if (!result && _shardIndex) {
+        result = _shardIndex->findNamedDecl(name);
+    }
+    return result;
 }
 const clang::Type* ASTAnalysisRunner::findType(const std::string &name) const {
     return _findNamedDeclsAnalysisPass->findType(name);
@@ -125,6 +264,36 @@ const clang::Type* ASTAnalysisRunner::findType(const std::string &name) const {
 const clang::FunctionDecl* ASTAnalysisRunner::findFunctionDecl(const std::string& signature) const {
     return _findNamedDeclsAnalysisPass->findFunctionDecl(signature);
 }
+std::vector<const clang::NamedDecl*> ASTAnalysisRunner::lookupInShards(const std::string& qualifiedName) const {
+    if (!_shardIndex) {
+        return {};
+    }
+    return _shardIndex->lookupInShards(qualifiedName);
+}
+bool ASTAnalysisRunner::isTfSingletonSpecializedInShards(const std::string& typeName) const {
+    return _shardIndex && _shardIndex->isTfSingletonSpecializedInShards(typeName);
+}
+
+const OperatorCandidateIndex& ASTAnalysisRunner::getOperatorCandidateIndex() const {
+    std::call_once(_operatorCandidateIndexFlag, [this]() {
+        ensureASTIsFullyDeserialized();
+        Telemetry::Measurement measurement(_driver->getTelemetry(), "OperatorCandidateIndex", "build");
+        _operatorCandidateIndex = std::make_unique<OperatorCandidateIndex>(_translationUnitDecl);
+        _hasOperatorCandidateIndex = true;
+    });
+    return *_operatorCandidateIndex;
+}
+
+bool ASTAnalysisRunner::hasOperatorCandidateIndex() const {
+    return _hasOperatorCandidateIndex;
+}
+
+void ASTAnalysisRunner::setOperatorCandidateIndex(std::unique_ptr<OperatorCandidateIndex> operatorCandidateIndex) {
+    std::call_once(_operatorCandidateIndexFlag, [this, &operatorCandidateIndex]() {
+        _operatorCandidateIndex = std::move(operatorCandidateIndex);
+        _hasOperatorCandidateIndex = true;
+    });
+}
 
 const FindNamedDeclsAnalysisPass* ASTAnalysisRunner::getFindNamedDeclsAnalysisPass() const {
     return _findNamedDeclsAnalysisPass.get();
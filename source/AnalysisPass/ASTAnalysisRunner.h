@@ -27,8 +27,12 @@
 
 #include "Driver/Driver.h"
 #include "Util/ClangToolHelper.h"
+#include "AnalysisPass/ASTFileClassifier.h"
 
+#include <atomic>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 
 class FindNamedDeclsAnalysisPass;
@@ -49,6 +53,8 @@ class FindVtValueRefFunctionsAnalysisPass;
 class FindSendableDependenciesAnalysisPass;
 class SendableAnalysisPass;
 class APINotesAnalysisPass;
+class ASTShardIndex;
+class OperatorCandidateIndex;
 
 // Owns and coordinates running different AST analysis passes
 class ASTAnalysisRunner {
@@ -65,10 +71,49 @@ public:
     const clang::SourceManager* getSourceManager() const;
     const clang::TranslationUnitDecl* getTranslationUnitDecl() const;
     
+    // Stable identifiers for decls loaded from the serialized AST (or any of its shards), for use in on-disk caches.
+    // Returns 0 for decls that weren't loaded from the serialized AST.
+    // IDs are only valid while ClangToolHelper::getSerializedASTFingerprint() doesn't change
+    uint64_t getSerializedDeclID(const clang::Decl* decl) const;
+    const clang::Decl* getDeclForSerializedDeclID(uint64_t declID) const;
+    
+    // Traversals lazily load decls from the serialized AST, which isn't thread-safe,
+    // so this loads everything up front before passes traverse the AST in parallel.
+    // Runs that only need passes that don't traverse the AST never load everything
+    void ensureASTIsFullyDeserialized() const;
+    // Whether any lookup might still deserialize decls from the AST,
+    // in which case passes must not look up decls from more than one thread
+    bool isASTLazilyLoaded() const;
+    
+    // A hash of a source file's contents, memoized for the whole run. Returns 0 for missing files
+    uint64_t getSourceFileDigest(const std::string& path) const;
+    // Every file the AST was built from, as named by latestDeclLocFilePath() and friends
+    const std::set<std::string>& getASTInputFiles() const;
+    
+    // Which OpenUSD file and library a decl's location is in, from a table indexed by FileID.
+    // The earliest location is where the decl is written (after macro expansion), and the latest
+    // is the last header needed to see it, e.g. the header for a template argument (see ASTHelpers::getLatestSourceLocation)
+    const ASTFileClassifier::FileClassification& getEarliestDeclLocFileClassification(const clang::Decl* decl) const;
+    const ASTFileClassifier::FileClassification& getLatestDeclLocFileClassification(const clang::Decl* decl) const;
+    // Index of a library in CMakeParser::getNamesOfPxrLibraries(), or -1
+    int getPxrLibraryOrdinal(const std::string& libraryName) const;
+    
     const clang::TagDecl* findTagDecl(const std::string& typeName) const;
     const clang::NamedDecl* findNamedDecl(const std::string& name) const;
     const clang::Type* findType(const std::string& name) const;
     const clang::FunctionDecl* findFunctionDecl(const std::string& signature) const;
+    // With `--sharded-ast`, the decl named `qualifiedName` in each shard. Empty otherwise
+    std::vector<const clang::NamedDecl*> lookupInShards(const std::string& qualifiedName) const;
+    // With `--sharded-ast`, whether a shard specializes `TfSingleton<T>` for the type named `typeName`. False otherwise
+    bool isTfSingletonSpecializedInShards(const std::string& typeName) const;
+    
+    // Candidate operators and hash functions for Equatable, Comparable and CustomStringConvertible.
+    // Usually handed over by the fused traversal that analyzes those passes, and otherwise
+    // indexed with a traversal of its own the first time it's needed
+    const OperatorCandidateIndex& getOperatorCandidateIndex() const;
+    bool hasOperatorCandidateIndex() const;
+    // Does nothing if the index has already been built
+    void setOperatorCandidateIndex(std::unique_ptr<OperatorCandidateIndex> operatorCandidateIndex);
     
     const FindNamedDeclsAnalysisPass* getFindNamedDeclsAnalysisPass() const;
     const ImportAnalysisPass* getImportAnalysisPass() const;
@@ -93,10 +138,28 @@ private:
     // MARK: Fields
     const Driver* _driver;
     
+    // getSerializedDeclID() keeps the index of the decl's AST unit in the top byte,
+    // above the reader's own ID (whose module file index is far smaller than 2^24)
+    static constexpr uint64_t _serializedDeclIDUnitIndexShift = 56;
+    static constexpr uint64_t _maxSerializedDeclIDUnitIndex = 0xFF;
+    static constexpr uint64_t _serializedDeclIDRawValueMask = (uint64_t(1) << _serializedDeclIDUnitIndexShift) - 1;
+    
     const clang::ASTUnit* _astUnit;
     const clang::ASTContext* _astContext;
     const clang::SourceManager* _sourceManager;
     const clang::TranslationUnitDecl* _translationUnitDecl;
+    mutable std::once_flag _astIsFullyDeserializedFlag;
+    mutable std::atomic<bool> _isASTFullyDeserialized;
+    mutable std::mutex _sourceFileDigestsMutex;
+    mutable std::map<std::string, uint64_t> _sourceFileDigests;
+    mutable std::once_flag _astInputFilesFlag;
+    mutable std::set<std::string> _astInputFiles;
+    std::unique_ptr<ASTShardIndex> _shardIndex;
+    mutable std::once_flag _operatorCandidateIndexFlag;
+    mutable std::unique_ptr<OperatorCandidateIndex> _operatorCandidateIndex;
+    mutable std::atomic<bool> _hasOperatorCandidateIndex;
+    // One per unit, since every shard has its own FileIDs. Built up front, and read-only after that
+    std::map<const clang::SourceManager*, std::unique_ptr<ASTFileClassifier>> _fileClassifiers;
     
     std::unique_ptr<FindNamedDeclsAnalysisPass> _findNamedDeclsAnalysisPass;
     std::unique_ptr<ImportAnalysisPass> _importAnalysisPass;
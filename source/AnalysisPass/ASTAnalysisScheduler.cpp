@@ -0,0 +1,345 @@
+//===----------------------------------------------------------------------===//
+// This source file is part of github.com/apple/SwiftUsd-ast-answerer
+//
+// Copyright © 2025 Apple Inc. and the SwiftUsd-ast-answerer project authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//===----------------------------------------------------------------------===//
+
+#include "AnalysisPass/ASTAnalysisScheduler.h"
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <optional>
+#include <set>
+
+// MARK: ASTAnalysisScheduler
+ASTAnalysisScheduler::ASTAnalysisScheduler(ASTAnalysisRunner* astAnalysisRunner) :
+    _astAnalysisRunner(astAnalysisRunner) {}
+
+void ASTAnalysisScheduler::restrictTo(const std::set<std::string>& passNames) {
+    std::map<std::string, ASTAnalysisPassBase*> passesByName;
+    for (ASTAnalysisPassBase* pass : _passes) {
+        passesByName.insert({pass->getPassName(), pass});
+    }
+    
+    std::set<const ASTAnalysisPassBase*> selected;
+    std::vector<const ASTAnalysisPassBase*> worklist;
+    for (const std::string& name : passNames) {
+        const auto& it = passesByName.find(name);
+        if (it == passesByName.end()) {
+            std::cerr << "Error! No analysis pass named " << name << std::endl;
+            __builtin_trap();
+        }
+        worklist.push_back(it->second);
+    }
+    while (!worklist.empty()) {
+        const ASTAnalysisPassBase* pass = worklist.back();
+        worklist.pop_back();
+        // _computeWaves() reports dependencies on passes that don't exist
+        if (!pass || !selected.insert(pass).second) {
+            continue;
+        }
+        for (const ASTAnalysisPassBase* dependency : pass->getDependencies()) {
+            worklist.push_back(dependency);
+        }
+    }
+    
+    std::erase_if(_passes, [&selected](ASTAnalysisPassBase* pass) { return !selected.contains(pass); });
+    
+    std::cout << "Running " << _passes.size() << " of " << passesByName.size() << " analysis passes:";
+    for (const ASTAnalysisPassBase* pass : _passes) {
+        std::cout << " " << pass->getPassName();
+    }
+    std::cout << std::endl;
+}
+
+void ASTAnalysisScheduler::run() {
+    std::vector<std::vector<ASTAnalysisPassBase*>> waves = _computeWaves();
+    
+    ThreadPool threadPool(ThreadPool::defaultThreadCount());
+    for (const auto& wave : waves) {
+        ASTAnalysisWave(_astAnalysisRunner, wave).run(threadPool);
+    }
+}
+
+std::vector<std::vector<ASTAnalysisPassBase*>> ASTAnalysisScheduler::_computeWaves() const {
+    std::set<const ASTAnalysisPassBase*> scheduledPasses(_passes.begin(), _passes.end());
+    
+    // A pass's wave is one more than the latest wave of any of its dependencies.
+    // Dependencies that aren't scheduled here must have already finished
+    std::map<const ASTAnalysisPassBase*, uint64_t> waveIndices;
+    std::set<const ASTAnalysisPassBase*> inProgress;
+    std::function<uint64_t(const ASTAnalysisPassBase*)> getWaveIndex = [&](const ASTAnalysisPassBase* pass) -> uint64_t {
+        const auto& it = waveIndices.find(pass);
+        if (it != waveIndices.end()) {
+            return it->second;
+        }
+        if (inProgress.contains(pass)) {
+            std::cerr << "Error! Analysis pass dependency cycle involving " << pass->serializationFileName() << std::endl;
+            __builtin_trap();
+        }
+        inProgress.insert(pass);
+        
+        uint64_t result = 0;
+        for (const ASTAnalysisPassBase* dependency : pass->getDependencies()) {
+            if (!dependency) {
+                std::cerr << "Error! " << pass->serializationFileName() << " depends on an analysis pass that doesn't exist" << std::endl;
+                __builtin_trap();
+            }
+            if (scheduledPasses.contains(dependency)) {
+                result = std::max(result, getWaveIndex(dependency) + 1);
+            }
+        }
+        
+        inProgress.erase(pass);
+        waveIndices.insert({pass, result});
+        return result;
+    };
+    
+    std::vector<std::vector<ASTAnalysisPassBase*>> result;
+    for (ASTAnalysisPassBase* pass : _passes) {
+        uint64_t waveIndex = getWaveIndex(pass);
+        if (result.size() <= waveIndex) {
+            result.resize(waveIndex + 1);
+        }
+        result[waveIndex].push_back(pass);
+    }
+    return result;
+}
+
+// MARK: ASTAnalysisWave
+ASTAnalysisWave::ASTAnalysisWave(ASTAnalysisRunner* astAnalysisRunner, const std::vector<ASTAnalysisPassBase*>& passes) :
+    _astAnalysisRunner(astAnalysisRunner),
+    _passes(passes) {}
+
+void ASTAnalysisWave::run(ThreadPool& threadPool) {
+    // Passes in a wave don't read each other, so everything
+    // up to analysisPassIsFinished() can happen in parallel.
+    // The exception is deserializing while the AST is lazily loaded,
+    // because looking up and comparing decls pulls them from the ASTReader
+    bool canDeserializeInParallel = !_astAnalysisRunner->isASTLazilyLoaded();
+    std::vector<char> didDeserialize(_passes.size(), false);
+    for (size_t i = 0; i < _passes.size(); i++) {
+        std::function<void()> job = [this, &didDeserialize, i]() {
+            didDeserialize[i] = ASTAnalysisPassFactory::measure(_passes[i], "deserialize", [this, i]() {
+                return _passes[i]->deserialize();
+            });
+        };
+        if (canDeserializeInParallel) {
+            threadPool.enqueue(job);
+        } else {
+            job();
+        }
+    }
+    threadPool.waitUntilIdle();
+    
+    bool needsFullAST = false;
+    for (size_t i = 0; i < _passes.size(); i++) {
+        if (!didDeserialize[i] && _passes[i]->traversesAST()) {
+            needsFullAST = true;
+        }
+    }
+    if (needsFullAST) {
+        _astAnalysisRunner->ensureASTIsFullyDeserialized();
+    }
+    
+    // Otherwise, passes and tests deserialize decls lazily as they look them up,
+    // which isn't thread-safe, so run them all on this thread
+    std::function<void(std::function<void()>)> run = [&threadPool, needsFullAST](std::function<void()> job) {
+        if (needsFullAST) {
+            threadPool.enqueue(job);
+        } else {
+            job();
+        }
+    };
+    
+    // Every pass that can be fused shares one traversal of the AST,
+    // and the rest traverse on their own alongside it
+    std::vector<ASTAnalysisPassBase*> fusedPasses;
+    for (size_t i = 0; i < _passes.size(); i++) {
+        if (didDeserialize[i]) {
+            continue;
+        }
+        if (FusedASTVisitor::canBeFused(_passes[i])) {
+            fusedPasses.push_back(_passes[i]);
+        } else {
+            ASTAnalysisPassBase* pass = _passes[i];
+            run([pass]() {
+                ASTAnalysisPassFactory::measure(pass, "analyze", [pass]() { pass->analyze(); return true; });
+                ASTAnalysisPassFactory::measure(pass, "finalize", [pass]() { pass->_finalizeAll(); return true; });
+                ASTAnalysisPassFactory::measure(pass, "serialize", [pass]() { pass->serialize(); return true; });
+            });
+        }
+    }
+    
+    if (!fusedPasses.empty()) {
+        // Collect operator candidates on the way if a fused pass needs them and nothing built them yet,
+        // instead of walking the AST again the first time they're asked for. The index must cover
+        // the whole AST, so only do it once the AST is fully deserialized
+        bool collectsOperatorCandidates = needsFullAST && !_astAnalysisRunner->hasOperatorCandidateIndex() &&
+            std::any_of(fusedPasses.begin(), fusedPasses.end(), [](ASTAnalysisPassBase* pass) { return pass->usesOperatorCandidateIndex(); });
+        
+        run([this, &fusedPasses, &run, collectsOperatorCandidates]() {
+            for (ASTAnalysisPassBase* pass : fusedPasses) {
+                std::cout << "Analyzing " << pass->serializationFileName() << std::endl;
+            }
+            
+            {
+                // The traversal is shared, so it's recorded once for all of them
+                std::string groupName;
+                for (ASTAnalysisPassBase* pass : fusedPasses) {
+                    groupName += (groupName.empty() ? "" : "+") + pass->getPassName();
+                }
+                Telemetry::Measurement measurement(_astAnalysisRunner->getDriver()->getTelemetry(), groupName, "analyze", [&fusedPasses]() {
+                    Telemetry::Counters result;
+                    for (ASTAnalysisPassBase* pass : fusedPasses) {
+                        result.declsVisited += pass->_getTelemetryCounters().declsVisited;
+                        result.resultsInserted += pass->_getTelemetryCounters().resultsInserted;
+                    }
+                    return result;
+                });
+                
+                FusedASTVisitor visitor(fusedPasses, collectsOperatorCandidates);
+                visitor.TraverseDecl((clang::TranslationUnitDecl*) _astAnalysisRunner->getTranslationUnitDecl());
+                if (collectsOperatorCandidates) {
+                    _astAnalysisRunner->setOperatorCandidateIndex(visitor.takeOperatorCandidateIndex());
+                }
+            }
+            
+            // Finishing up only touches each pass's own results, so passes do it in parallel
+            for (ASTAnalysisPassBase* pass : fusedPasses) {
+                run([pass]() {
+                    ASTAnalysisPassFactory::measure(pass, "finalize", [pass]() { pass->_finalizeAll(); return true; });
+                    ASTAnalysisPassFactory::measure(pass, "serialize", [pass]() { pass->serialize(); return true; });
+                });
+            }
+        });
+    }
+    threadPool.waitUntilIdle();
+    
+    // From here on, results are read from more than one thread
+    for (ASTAnalysisPassBase* pass : _passes) {
+        pass->_prepareDataForSharing();
+    }
+    
+    for (ASTAnalysisPassBase* pass : _passes) {
+        run([pass]() {
+            ASTAnalysisPassFactory::measure(pass, "test", [pass]() { pass->test(); return true; });
+        });
+    }
+    threadPool.waitUntilIdle();
+    
+    // Later waves may depend on side effects of finishing, so do it in a predictable order
+    for (ASTAnalysisPassBase* pass : _passes) {
+        pass->analysisPassIsFinished();
+    }
+}
+
+// MARK: FusedASTVisitor
+FusedASTVisitor::FusedASTVisitor(const std::vector<ASTAnalysisPassBase*>& passes, bool collectsOperatorCandidates) :
+    _passes(passes),
+    _isStopped(passes.size(), false),
+    _isSuppressed(passes.size(), false),
+    _nRunning(passes.size()),
+    _collectsOperatorCandidates(collectsOperatorCandidates) {}
+
+bool FusedASTVisitor::canBeFused(const ASTAnalysisPassBase* pass) {
+    return pass->shouldVisitTemplateInstantiations() && pass->shouldVisitImplicitCode();
+}
+
+bool FusedASTVisitor::TraverseDecl(clang::Decl* decl) {
+    if (!decl) { return true; }
+    
+    // Mirror ASTAnalysisPass::TraverseDecl for each pass. Whether a decl is from Usd
+    // doesn't depend on the pass, so compute it at most once per decl
+    bool isTranslationUnit = (bool) clang::dyn_cast<clang::TranslationUnitDecl>(decl);
+    std::optional<bool> fromUsd;
+    std::vector<size_t> newlySuppressed;
+    bool anyPassWillVisit = false;
+    
+    for (size_t i = 0; i < _passes.size(); i++) {
+        if (_isStopped[i] || _isSuppressed[i]) {
+            continue;
+        }
+        if (!isTranslationUnit && _passes[i]->shouldOnlyVisitDeclsFromUsd()) {
+            if (!fromUsd) {
+                fromUsd = _passes[i]->_isFromUsdWhileTraversing(decl);
+            }
+            if (!*fromUsd) {
+                _isSuppressed[i] = true;
+                newlySuppressed.push_back(i);
+                continue;
+            }
+        }
+        anyPassWillVisit = true;
+    }
+    
+    bool result = true;
+    // Operator candidates come from the whole AST, like OperatorCandidateIndex's own traversal
+    if (anyPassWillVisit || _collectsOperatorCandidates) {
+        result = clang::RecursiveASTVisitor<FusedASTVisitor>::TraverseDecl(decl);
+    }
+    
+    for (size_t i : newlySuppressed) {
+        _isSuppressed[i] = false;
+    }
+    return result;
+}
+
+bool FusedASTVisitor::VisitDecl(clang::Decl* decl) {
+    if (_collectsOperatorCandidates) {
+        if (const clang::FunctionDecl* functionDecl = clang::dyn_cast<clang::FunctionDecl>(decl)) {
+            if (std::optional<OperatorCandidateIndex::Candidate> candidate = OperatorCandidateIndex::makeCandidate(functionDecl)) {
+                _operatorCandidates.push_back(*candidate);
+            }
+        }
+    }
+    
+    for (size_t i = 0; i < _passes.size(); i++) {
+        if (_isStopped[i] || _isSuppressed[i]) {
+            continue;
+        }
+        if (!_passes[i]->_walkUpFromDecl(decl)) {
+            _isStopped[i] = true;
+            _nRunning -= 1;
+        }
+    }
+    // Only stop the traversal once every pass has stopped, and we've seen every operator candidate
+    return _nRunning > 0 || _collectsOperatorCandidates;
+}
+
+bool FusedASTVisitor::VisitType(clang::Type* type) {
+    for (size_t i = 0; i < _passes.size(); i++) {
+        if (_isStopped[i] || _isSuppressed[i]) {
+            continue;
+        }
+        if (!_passes[i]->_walkUpFromType(type)) {
+            _isStopped[i] = true;
+            _nRunning -= 1;
+        }
+    }
+    return _nRunning > 0 || _collectsOperatorCandidates;
+}
+
+std::unique_ptr<OperatorCandidateIndex> FusedASTVisitor::takeOperatorCandidateIndex() {
+    if (!_collectsOperatorCandidates) {
+        std::cerr << "Error! FusedASTVisitor didn't collect operator candidates" << std::endl;
+        __builtin_trap();
+    }
+    std::unique_ptr<OperatorCandidateIndex> result = std::make_unique<OperatorCandidateIndex>(_operatorCandidates);
+    _operatorCandidates.clear();
+    return result;
+}
@@ -0,0 +1,111 @@
+//===----------------------------------------------------------------------===//
+// This source file is part of github.com/apple/SwiftUsd-ast-answerer
+//
+// Copyright © 2025 Apple Inc. and the SwiftUsd-ast-answerer project authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//===----------------------------------------------------------------------===//
+
+#ifndef ASTAnalysisScheduler_h
+#define ASTAnalysisScheduler_h
+
+#include "AnalysisPass/ASTAnalysisPass.h"
+#include "AnalysisPass/OperatorCandidateIndex.h"
+#include "Util/ThreadPool.h"
+#include "clang/AST/RecursiveASTVisitor.h"
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+// Runs a set of analysis passes in an order that respects their declared dependencies.
+// Passes are grouped into waves: every pass in a wave only depends on passes from earlier waves,
+// so passes within a wave are independent of each other and run in parallel on a thread pool
+class ASTAnalysisScheduler {
+public:
+    ASTAnalysisScheduler(ASTAnalysisRunner* astAnalysisRunner);
+    
+    // Creates an analysis pass to be scheduled. The pass isn't
+    // deserialized, analyzed, or tested until run() is called
+    template <typename T>
+    std::unique_ptr<T> add() {
+        std::unique_ptr<T> result = std::make_unique<T>(_astAnalysisRunner);
+        _passes.push_back(result.get());
+        return result;
+    }
+    
+    // Only runs the named passes and the passes they transitively depend on.
+    // A pass's name is its serializationFileName() without the extension.
+    // Passes that don't run stay empty
+    void restrictTo(const std::set<std::string>& passNames);
+    
+    // Groups every added pass into waves, and runs the waves in order
+    void run();
+    
+private:
+    std::vector<std::vector<ASTAnalysisPassBase*>> _computeWaves() const;
+    
+    ASTAnalysisRunner* _astAnalysisRunner;
+    std::vector<ASTAnalysisPassBase*> _passes;
+};
+
+// A group of analysis passes that don't depend on each other. Passes are deserialized in parallel,
+// and passes that can't be deserialized share a single traversal of the AST when they can be fused,
+// or traverse on their own alongside it
+class ASTAnalysisWave {
+public:
+    ASTAnalysisWave(ASTAnalysisRunner* astAnalysisRunner, const std::vector<ASTAnalysisPassBase*>& passes);
+    
+    // Deserializes or analyzes every pass in the wave, tests them,
+    // and then finishes them in the order they were added to the scheduler
+    void run(ThreadPool& threadPool);
+    
+private:
+    ASTAnalysisRunner* _astAnalysisRunner;
+    std::vector<ASTAnalysisPassBase*> _passes;
+};
+
+// Traverses the AST once on behalf of multiple analysis passes, forwarding every visited
+// Decl and Type to each pass that would have visited it during its own traversal.
+// Can also collect the OperatorCandidateIndex, in which case it visits the whole AST
+class FusedASTVisitor: public clang::RecursiveASTVisitor<FusedASTVisitor> {
+public:
+    FusedASTVisitor(const std::vector<ASTAnalysisPassBase*>& passes, bool collectsOperatorCandidates);
+    
+    // Passes can only be fused if they agree with our traversal policies
+    static bool canBeFused(const ASTAnalysisPassBase* pass);
+    
+    bool shouldVisitTemplateInstantiations() const { return true; }
+    bool shouldVisitImplicitCode() const { return true; }
+    
+    bool TraverseDecl(clang::Decl* decl);
+    bool VisitDecl(clang::Decl* decl);
+    bool VisitType(clang::Type* type);
+    
+    // Only valid after traversal, and only if we collect operator candidates
+    std::unique_ptr<OperatorCandidateIndex> takeOperatorCandidateIndex();
+    
+private:
+    std::vector<ASTAnalysisPassBase*> _passes;
+    // A pass stops once one of its Visit methods returns false, like it would in its own traversal
+    std::vector<bool> _isStopped;
+    // A pass is suppressed while we traverse a subtree that it wouldn't have traversed on its own
+    std::vector<bool> _isSuppressed;
+    uint64_t _nRunning;
+    bool _collectsOperatorCandidates;
+    std::vector<OperatorCandidateIndex::Candidate> _operatorCandidates;
+};
+
+#endif /* ASTAnalysisScheduler_h */
@@ -0,0 +1,173 @@
+//===----------------------------------------------------------------------===//
+// This source file is part of github.com/apple/SwiftUsd-ast-answerer
+//
+// Copyright © 2025 Apple Inc. and the SwiftUsd-ast-answerer project authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//===----------------------------------------------------------------------===//
+
+#include "AnalysisPass/ASTFileClassifier.h"
+#include "Driver/Driver.h"
+#include "Util/CMakeParser.h"
+#include "Util/FileSystemInfo.h"
+#include <algorithm>
+
+ASTFileClassifier::ASTFileClassifier(const Driver* driver, const clang::SourceManager* sourceManager) :
+_driver(driver),
+_sourceManager(sourceManager),
+_nextLocalOffset(sourceManager->getNextLocalOffset()) {
+    std::vector<std::string> libraryNames = _driver->getCMakeParser()->getNamesOfPxrLibraries();
+    for (int i = 0; i < libraryNames.size(); i++) {
+        _libraryOrdinals.try_emplace(libraryNames[i], i);
+    }
+    
+    // Locations that aren't in a file all share the first classification
+    _makeClassification("");
+    _buildOffsetTable();
+}
+
+const ASTFileClassifier::FileClassification& ASTFileClassifier::classify(clang::SourceLocation loc) const {
+    if (loc.isInvalid()) {
+        return _classifications.front();
+    }
+    
+    const OffsetTableEntry* entry = _findEntry(_getOffset(loc));
+    return entry ? _classifications[entry->classification] : _classifications.front();
+}
+
+int ASTFileClassifier::getLibraryOrdinal(const std::string& libraryName) const {
+    const auto& it = _libraryOrdinals.find(libraryName);
+    return it == _libraryOrdinals.end() ? -1 : it->second;
+}
+
+std::set<std::string> ASTFileClassifier::getFileNames() const {
+    std::set<std::string> result;
+    for (const OffsetTableEntry& entry : _offsetTable) {
+        if (entry.isFile) {
+            result.insert(_classifications[entry.classification].fileName);
+        }
+    }
+    result.erase("");
+    return result;
+}
+
+const ASTFileClassifier::FileClassification& ASTFileClassifier::getEmptyClassification() {
+    static const FileClassification result = {"", "", "", -1, false};
+    return result;
+}
+
+void ASTFileClassifier::_buildOffsetTable() {
+    // Macro expansions are classified by where they expand to, which can be another
+    // expansion, so they're resolved once every entry is in the table.
+    // Until then, each entry is paired with where it expands to
+    std::vector<std::pair<OffsetTableEntry, clang::SourceLocation>> entries;
+    entries.reserve(_sourceManager->local_sloc_entry_size() + _sourceManager->loaded_sloc_entry_size());
+    auto addEntry = [this, &entries](const clang::SrcMgr::SLocEntry& entry) {
+        if (entry.isFile()) {
+            llvm::StringRef fileName;
+            if (clang::OptionalFileEntryRef fileEntryRef = entry.getFile().getContentCache().OrigEntry) {
+                fileName = fileEntryRef->getName();
+            }
+            entries.push_back({{entry.getOffset(), _makeClassification(fileName), true}, clang::SourceLocation()});
+        } else {
+            entries.push_back({{entry.getOffset(), 0, false}, entry.getExpansion().getExpansionLocStart()});
+        }
+    };
+    
+    for (uint64_t i = 0; i < _sourceManager->local_sloc_entry_size(); i++) {
+        addEntry(_sourceManager->getLocalSLocEntry((unsigned)i));
+    }
+    for (uint64_t i = 0; i < _sourceManager->loaded_sloc_entry_size(); i++) {
+        bool invalid = false;
+        const clang::SrcMgr::SLocEntry& entry = _sourceManager->getLoadedSLocEntry((unsigned)i, &invalid);
+        if (!invalid) {
+            addEntry(entry);
+        }
+    }
+    
+    std::sort(entries.begin(), entries.end(), [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+    _offsetTable.reserve(entries.size());
+    for (const auto& entry : entries) {
+        _offsetTable.push_back(entry.first);
+    }
+    
+    // Same as SourceManager::getExpansionLoc(), which follows expansion starts until reaching a file
+    for (uint64_t i = 0; i < _offsetTable.size(); i++) {
+        if (_offsetTable[i].isFile) {
+            continue;
+        }
+        clang::SourceLocation loc = entries[i].second;
+        const OffsetTableEntry* target = nullptr;
+        for (uint64_t depth = 0; loc.isValid() && depth < _offsetTable.size(); depth++) {
+            target = _findEntry(_getOffset(loc));
+            if (!target || target->isFile) {
+                break;
+            }
+            loc = entries[target - _offsetTable.data()].second;
+        }
+        _offsetTable[i].classification = target && target->isFile ? target->classification : 0;
+    }
+}
+
+/* static */
+clang::SourceLocation::UIntTy ASTFileClassifier::_getOffset(clang::SourceLocation loc) {
+    // SourceLocation keeps its offset in the low bits, and flags macro locations in the top bit
+    constexpr clang::SourceLocation::UIntTy macroIDBit = clang::SourceLocation::UIntTy(1) << (8 * sizeof(clang::SourceLocation::UIntTy) - 1);
+    return loc.getRawEncoding() & ~macroIDBit;
+}
+
+const ASTFileClassifier::OffsetTableEntry* ASTFileClassifier::_findEntry(clang::SourceLocation::UIntTy offset) const {
+    // The last entry that starts at or before offset
+    auto it = std::upper_bound(_offsetTable.begin(), _offsetTable.end(), OffsetTableEntry{offset, 0, false});
+    if (it == _offsetTable.begin()) {
+        return nullptr;
+    }
+    --it;
+    if (it->offset < _nextLocalOffset && offset >= _nextLocalOffset) {
+        // Past the last local entry this table knows about
+        return nullptr;
+    }
+    return &*it;
+}
+
+uint32_t ASTFileClassifier::_makeClassification(llvm::StringRef fileName) {
+    auto [it, inserted] = _classificationIndices.try_emplace(fileName, (uint32_t)_classifications.size());
+    if (!inserted) {
+        return it->second;
+    }
+    
+    FileClassification result = getEmptyClassification();
+    result.fileName = fileName.str();
+    result.relativePath = _driver->getFileSystemInfo()->makePathRelativeForUsd(result.fileName);
+    
+    // pxr/foo/result/bar.h
+    std::vector<std::string> components;
+    for (uint64_t start = 0; start <= result.relativePath.size() && !result.relativePath.empty(); ) {
+        uint64_t slash = std::min(result.relativePath.find('/', start), result.relativePath.size());
+        components.push_back(result.relativePath.substr(start, slash - start));
+        start = slash + 1;
+    }
+    if (components.size() >= 3) {
+        result.libraryName = components[2];
+        result.libraryOrdinal = getLibraryOrdinal(result.libraryName);
+    }
+    
+    if (const CMakeParser::UsdFileInfo* usdFileInfo = _driver->getCMakeParser()->getUsdFileInfo(result.fileName)) {
+        result.isPublicHeader = usdFileInfo->isPublic;
+    }
+    
+    _classifications.push_back(std::move(result));
+    return it->second;
+}
@@ -0,0 +1,102 @@
+//===----------------------------------------------------------------------===//
+// This source file is part of github.com/apple/SwiftUsd-ast-answerer
+//
+// Copyright © 2025 Apple Inc. and the SwiftUsd-ast-answerer project authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//===----------------------------------------------------------------------===//
+
+#ifndef ASTFileClassifier_h
+#define ASTFileClassifier_h
+
+#include <clang/Basic/SourceManager.h>
+#include <llvm/ADT/StringMap.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+class Driver;
+
+// Passes ask which OpenUSD file and library a decl comes from for almost every decl they visit.
+// This answers that from a table built once from every SLocEntry, so the file name, prefix checks
+// and CMakeParser lookups happen once per file instead of once per query, and answering
+// doesn't call into the SourceManager at all, so it doesn't need ASTHelpers::getClangMutex().
+// There's one classifier per SourceManager, since each shard has its own FileIDs
+class ASTFileClassifier {
+public:
+    struct FileClassification {
+        // As reported by clang. Empty for locations that aren't in a file
+        std::string fileName;
+        // Relative to the OpenUSD source repo or installed headers, e.g. `pxr/usd/usd/stage.h`.
+        // Empty if the file isn't from OpenUSD
+        std::string relativePath;
+        // The directory the library lives in, e.g. `usd`
+        std::string libraryName;
+        // Index of libraryName in CMakeParser::getNamesOfPxrLibraries(), or -1
+        int libraryOrdinal;
+        // Listed in PUBLIC_HEADERS or PUBLIC_CLASSES
+        bool isPublicHeader;
+        
+        bool isFromUsd() const { return !relativePath.empty(); }
+    };
+    
+    // Loads every SLocEntry, so this must finish before anything else uses the source manager
+    ASTFileClassifier(const Driver* driver, const clang::SourceManager* sourceManager);
+    
+    // Macro locations are classified by the file they expand into,
+    // like classifying SourceManager::getExpansionLoc()
+    const FileClassification& classify(clang::SourceLocation loc) const;
+    
+    // Index of a library in CMakeParser::getNamesOfPxrLibraries(), or -1
+    int getLibraryOrdinal(const std::string& libraryName) const;
+    
+    // The name of every file the source manager has an entry for, as classify() reports it
+    std::set<std::string> getFileNames() const;
+    
+    // For decls that don't have a location
+    static const FileClassification& getEmptyClassification();
+    
+private:
+    // Where an SLocEntry starts in the source manager's offset space,
+    // and the classification of everything up to the next entry
+    struct OffsetTableEntry {
+        clang::SourceLocation::UIntTy offset;
+        uint32_t classification;
+        bool isFile;
+        
+        bool operator <(const OffsetTableEntry& other) const { return offset < other.offset; }
+    };
+    
+    const Driver* _driver;
+    const clang::SourceManager* _sourceManager;
+    std::map<std::string, int> _libraryOrdinals;
+    
+    // Deduplicated by file name, because one header can have many FileIDs
+    std::vector<FileClassification> _classifications;
+    llvm::StringMap<uint32_t> _classificationIndices;
+    // Sorted by offset. Local entries start at 0 and count up, and entries
+    // loaded from a serialized AST count down from the top of the offset space
+    std::vector<OffsetTableEntry> _offsetTable;
+    // Offsets from here up to the first loaded entry belong to buffers created after this was built
+    clang::SourceLocation::UIntTy _nextLocalOffset;
+    
+    void _buildOffsetTable();
+    static clang::SourceLocation::UIntTy _getOffset(clang::SourceLocation loc);
+    const OffsetTableEntry* _findEntry(clang::SourceLocation::UIntTy offset) const;
+    uint32_t _makeClassification(llvm::StringRef fileName);
+};
+
+#endif /* ASTFileClassifier_h */
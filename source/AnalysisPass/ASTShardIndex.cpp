@@ -0,0 +1,174 @@
+//===----------------------------------------------------------------------===//
+// This source file is part of github.com/apple/SwiftUsd-ast-answerer
+//
+// Copyright © 2025 Apple Inc. and the SwiftUsd-ast-answerer project authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//===----------------------------------------------------------------------===//
+
+#include "AnalysisPass/ASTShardIndex.h"
+#include "AnalysisPass/ASTAnalysisRunner.h"
+#include "AnalysisPass/ASTAnalysisPass.h"
+#include "Util/ThreadPool.h"
+#include "clang/AST/DeclTemplate.h"
+#include "clang/AST/RecursiveASTVisitor.h"
+#include <mutex>
+
+namespace {
+    // Collects every named decl under a shard's own top-level decls,
+    // without walking into the public headers it shares with the primary unit
+    struct ShardDeclCollector : public clang::RecursiveASTVisitor<ShardDeclCollector> {
+        NameIndex<const clang::NamedDecl*> namedDecls;
+        std::vector<std::string> tfSingletonTypeArguments;
+        bool (*shouldReplace)(const clang::NamedDecl*);
+        
+        bool shouldVisitTemplateInstantiations() const { return true; }
+        
+        bool VisitNamedDecl(clang::NamedDecl* namedDecl) {
+            if (const clang::TagDecl* tagDecl = clang::dyn_cast<clang::TagDecl>(namedDecl)) {
+                if (tagDecl->getDefinition()) {
+                    namedDecl = tagDecl->getDefinition();
+                }
+            }
+            std::string name = ASTHelpers::getAsString(namedDecl);
+            const clang::NamedDecl* const* existing = namedDecls.find(name);
+            if (!existing || shouldReplace(*existing)) {
+                namedDecls.insert_or_assign(name, namedDecl);
+            }
+            return true;
+        }
+        
+        static bool visitTopLevelDecl(void* context, const clang::Decl* decl) {
+            static_cast<ShardDeclCollector*>(context)->TraverseDecl(const_cast<clang::Decl*>(decl));
+            return true;
+        }
+    };
+}
+
+ASTShardIndex::ASTShardIndex(const ASTAnalysisRunner* astAnalysisRunner) :
+_astAnalysisRunner(astAnalysisRunner) {
+    const auto& astUnits = _astAnalysisRunner->getClangToolHelper().getASTUnits();
+    for (uint64_t i = 1; i < astUnits.size(); i++) {
+        _shards.push_back(astUnits[i].get());
+    }
+    
+    std::cout << "Indexing " << _shards.size() << " AST shards" << std::endl;
+    
+    // Shards don't share an ASTContext, so they can be deserialized in parallel
+    std::vector<ShardDeclCollector> collectors(_shards.size());
+    {
+        ThreadPool threadPool(ThreadPool::defaultThreadCount());
+        for (uint64_t i = 0; i < _shards.size(); i++) {
+            threadPool.enqueue([this, i, &collectors]() {
+                collectors[i].shouldReplace = &ASTShardIndex::_shouldReplace;
+                _shards[i]->visitLocalTopLevelDecls(&collectors[i], &ShardDeclCollector::visitTopLevelDecl);
+                
+                // ImportAnalysisPass asks about TfSingleton specializations for every candidate tag,
+                // so collect them by name now instead of looking them up each time
+                clang::NamedDecl* tfSingleton = _lookupInShard(_shards[i], {PXR_NS, "TfSingleton"});
+                if (const clang::ClassTemplateDecl* classTemplateDecl = clang::dyn_cast_or_null<clang::ClassTemplateDecl>(tfSingleton)) {
+                    for (const clang::ClassTemplateSpecializationDecl* specialization : classTemplateDecl->specializations()) {
+                        const clang::TemplateArgumentList& templateArgs = specialization->getTemplateInstantiationArgs();
+                        if (templateArgs.size() != 1) { continue; }
+                        const clang::TemplateArgument& templateArg = templateArgs.asArray()[0];
+                        if (templateArg.getKind() != clang::TemplateArgument::Type) { continue; }
+                        
+                        if (const clang::TagDecl* argTagDecl = templateArg.getAsType()->getAsTagDecl()) {
+                            collectors[i].tfSingletonTypeArguments.push_back(ASTHelpers::getAsString(argTagDecl));
+                        }
+                    }
+                }
+            });
+        }
+        threadPool.waitUntilIdle();
+    }
+    
+    // Merge in shard order, so lookups don't depend on thread timing
+    for (const ShardDeclCollector& collector : collectors) {
+        collector.namedDecls.forEach([this](const std::string& name, const clang::NamedDecl* namedDecl) {
+            const clang::NamedDecl* const* existing = _namedDecls.find(name);
+            if (!existing || _shouldReplace(*existing)) {
+                _namedDecls.insert_or_assign(name, namedDecl);
+            }
+        });
+        _tfSingletonTypeArguments.insert(collector.tfSingletonTypeArguments.begin(), collector.tfSingletonTypeArguments.end());
+    }
+}
+
+bool ASTShardIndex::_shouldReplace(const clang::NamedDecl* existing) {
+    // Only replace declarations of tags, so a definition wins wherever it's found
+    const clang::TagDecl* tagDecl = clang::dyn_cast<clang::TagDecl>(existing);
+    return tagDecl && !tagDecl->isThisDeclarationADefinition();
+}
+
+const clang::NamedDecl* ASTShardIndex::findNamedDecl(const std::string& name) const {
+    const clang::NamedDecl* const* it = _namedDecls.find(name);
+    return it ? *it : nullptr;
+}
+
+std::vector<const clang::NamedDecl*> ASTShardIndex::lookupInShards(const std::string& qualifiedName) const {
+    std::vector<std::string> components;
+    for (uint64_t start = 0; start <= qualifiedName.size(); ) {
+        uint64_t end = qualifiedName.find("::", start);
+        if (end == std::string::npos) {
+            end = qualifiedName.size();
+        }
+        components.push_back(qualifiedName.substr(start, end - start));
+        start = end + 2;
+    }
+    
+    std::vector<const clang::NamedDecl*> result;
+    
+    // Lookups deserialize from the shard and intern identifiers
+    std::lock_guard<std::mutex> lock(ASTHelpers::getClangMutex());
+    for (clang::ASTUnit* shard : _shards) {
+        clang::NamedDecl* found = _lookupInShard(shard, components);
+        if (!found) {
+            continue;
+        }
+        
+        if (clang::ClassTemplateDecl* classTemplateDecl = clang::dyn_cast<clang::ClassTemplateDecl>(found)) {
+            // Load the specializations from the shard's source files now,
+            // so callers can iterate them without the clang mutex
+            (void)classTemplateDecl->specializations();
+        }
+        result.push_back(found);
+    }
+    return result;
+}
+
+bool ASTShardIndex::isTfSingletonSpecializedInShards(const std::string& typeName) const {
+    return _tfSingletonTypeArguments.contains(typeName);
+}
+
+/* static */
+clang::NamedDecl* ASTShardIndex::_lookupInShard(clang::ASTUnit* shard, const std::vector<std::string>& components) {
+    clang::ASTContext& astContext = shard->getASTContext();
+    clang::DeclContext* declContext = astContext.getTranslationUnitDecl();
+    clang::NamedDecl* found = nullptr;
+    
+    for (const std::string& component : components) {
+        if (!declContext) {
+            return nullptr;
+        }
+        clang::DeclContextLookupResult lookupResult = declContext->lookup(clang::DeclarationName(&astContext.Idents.get(component)));
+        found = lookupResult.empty() ? nullptr : lookupResult.front();
+        if (!found) {
+            return nullptr;
+        }
+        declContext = clang::dyn_cast<clang::DeclContext>(found);
+    }
+    return found;
+}
@@ -0,0 +1,65 @@
+//===----------------------------------------------------------------------===//
+// This source file is part of github.com/apple/SwiftUsd-ast-answerer
+//
+// Copyright © 2025 Apple Inc. and the SwiftUsd-ast-answerer project authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//===----------------------------------------------------------------------===//
+
+#ifndef ASTShardIndex_h
+#define ASTShardIndex_h
+
+#include <clang/Frontend/ASTUnit.h>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "Util/NameIndex.h"
+
+class ASTAnalysisRunner;
+
+// With `--sharded-ast`, ClangToolHelper loads the public headers as the primary ASTUnit,
+// and the source files of each OpenUSD library as a shard built on top of them.
+// Passes only traverse the primary unit, so this answers lookups for decls that only
+// exist in shards. Decls from a shard belong to that shard's ASTContext and SourceManager.
+class ASTShardIndex {
+public:
+    ASTShardIndex(const ASTAnalysisRunner* astAnalysisRunner);
+    
+    // Decls declared in a shard's own source files, named like ASTHelpers::getAsString().
+    // Returns nullptr if no shard declares the name
+    const clang::NamedDecl* findNamedDecl(const std::string& name) const;
+    
+    // Looks up a plain qualified name like `PXR_NS::TfSingleton` in every shard.
+    // Use this for decls from the public headers that shards add to,
+    // e.g. class templates that source files specialize
+    std::vector<const clang::NamedDecl*> lookupInShards(const std::string& qualifiedName) const;
+    
+    // Whether any shard specializes `TfSingleton<T>` for the type named `typeName`
+    // (named like ASTHelpers::getAsString()). Collected once while indexing
+    bool isTfSingletonSpecializedInShards(const std::string& typeName) const;
+    
+private:
+    static bool _shouldReplace(const clang::NamedDecl* existing);
+    // The caller must hold ASTHelpers::getClangMutex(), unless no other thread is using the shard
+    static clang::NamedDecl* _lookupInShard(clang::ASTUnit* shard, const std::vector<std::string>& components);
+    
+    const ASTAnalysisRunner* _astAnalysisRunner;
+    std::vector<clang::ASTUnit*> _shards;
+    NameIndex<const clang::NamedDecl*> _namedDecls;
+    std::unordered_set<std::string> _tfSingletonTypeArguments;
+};
+
+#endif /* ASTShardIndex_h */
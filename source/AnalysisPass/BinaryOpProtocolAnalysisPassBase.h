@@ -23,6 +23,7 @@
 
 #include "AnalysisPass/ASTAnalysisPass.h"
 #include "AnalysisPass/ImportAnalysisPass.h"
+#include "AnalysisPass/OperatorCandidateIndex.h"
 #include "AnalysisResult/BinaryOpProtocolAnalysisResult.h"
 
 // Equatable and Comparable are a) complicated, b) nearly identical.
@@ -64,6 +65,11 @@ public:
         return false;
     }
     
+    // Candidates are replayed from the index in traversalIsFinished()
+    bool usesOperatorCandidateIndex() const override {
+        return true;
+    }
+    
     bool checkIfBlockedByEquatable(const clang::CXXRecordDecl* cxxRecordDecl);
         
     void finalize(const clang::NamedDecl* namedDecl) override {
@@ -127,7 +133,7 @@ public:
         }
         if (const clang::ClassTemplateSpecializationDecl* classTemplateSpecializationDecl = clang::dyn_cast<clang::ClassTemplateSpecializationDecl>(cxxRecordDecl)) {
             clang::ClassTemplateDecl* classTemplateDecl = classTemplateSpecializationDecl->getSpecializedTemplate();
-            convertibleTypes.push_back(classTemplateDecl->getInjectedClassNameSpecialization().getCanonicalType());
+            convertibleTypes.push_back(ASTHelpers::getInjectedClassNameSpecialization(classTemplateDecl).getCanonicalType());
         }
         for (const clang::Type* convertibleType : ASTHelpers::allAccessibleImplicitNoArgConstConversions(cxxRecordDecl)) {
             convertibleTypes.push_back(convertibleType->getCanonicalTypeUnqualified());
@@ -271,34 +277,34 @@ public:
         
         return true;
     }
-    bool VisitFunctionDecl(clang::FunctionDecl* functionDecl) override {
+    void traversalIsFinished() override {
+        // Candidates are in the order our own traversal would have visited them,
+        // so later functions for the same pair of types still replace earlier ones
+        const OperatorCandidateIndex& operatorCandidateIndex = this->getASTAnalysisRunner().getOperatorCandidateIndex();
+        OperatorCandidateIndex::Kind kind = isComparablePass() ? OperatorCandidateIndex::Kind::less : OperatorCandidateIndex::Kind::equalEqual;
+        for (const OperatorCandidateIndex::Candidate& candidate : operatorCandidateIndex.getCandidates(kind)) {
+            insertWitnesses(candidate.functionDecl);
+        }
+    }
+    
+    // Given an `operator==` (or `operator<` for Comparable)
+    void insertWitnesses(const clang::FunctionDecl* functionDecl) {
         // Important: Don't disallow functions not from Usd,
         // because we might want to use `==` functions from stdlib
         // (e.g., GfHalf using `==(float, float)`
         if (this->isEarliestDeclLocFromUsd(functionDecl) && !this->areAllUsdDeclsFromPublicHeaders(functionDecl)) {
 #warning suspect use of declLocFromUsd
-            return true;
+            return;
         }
         
-        if (isComparablePass()) {
-            // Must be <
-            if (functionDecl->getOverloadedOperator() != clang::OO_Less) {
-                return true;
-            }
-        } else {
-            // Must be ==
-            if (functionDecl->getOverloadedOperator() != clang::OO_EqualEqual) {
-                return true;
-            }
-        }
         // Must return bool
         if (!functionDecl->getReturnType()->isBooleanType()) {
-            return true;
+            return;
         }
         
         // Ignore if Swift can't see it
         if (functionDecl->isDeleted() || ASTHelpers::isNotVisibleToSwift(functionDecl->getAccess())) {
-            return true;
+            return;
         }
         
         // Pull out the types of the arguments...
@@ -308,12 +314,12 @@ public:
         if (functionDecl->getNumParams() == 1) {
             const clang::CXXMethodDecl* cxxMethodDecl = clang::dyn_cast<clang::CXXMethodDecl>(functionDecl);
             if (!cxxMethodDecl) {
-                return true;
+                return;
             }
             
             // Go from (probably) `const This*` to `const This&`
-            lhsType = cxxMethodDecl->getThisType()->getPointeeType();
-            lhsType = functionDecl->getASTContext().getLValueReferenceType(lhsType);
+            lhsType = ASTHelpers::getThisType(cxxMethodDecl)->getPointeeType();
+            lhsType = ASTHelpers::getLValueReferenceType(functionDecl->getASTContext(), lhsType);
             
             rhsType = cxxMethodDecl->parameters()[0]->getType();
             
@@ -321,7 +327,7 @@ public:
             lhsType = functionDecl->parameters()[0]->getType();
             rhsType = functionDecl->parameters()[1]->getType();
         } else {
-            return true;
+            return;
         }
 
         
@@ -333,7 +339,7 @@ public:
             rhsType = ASTHelpers::removingRefConst(rhsType);
         }
         if (lhsType.isNull() || rhsType.isNull()) {
-            return true;
+            return;
         }
         
         // Arguments from Usd must be imported into swift and not-noncopyable
@@ -342,7 +348,7 @@ public:
             if (this->doesTypeContainUsdTypes(lhsTagDecl)) {
                 const auto& it = importAnalysisPass->find(lhsTagDecl);
                 if (it == importAnalysisPass->end() || !it->second.isImportedSomehow() || it->second.isImportedAsNonCopyable()) {
-                    return true;
+                    return;
                 }
             }
         }
@@ -350,7 +356,7 @@ public:
             if (this->doesTypeContainUsdTypes(rhsTagDecl)) {
                 const auto& it = importAnalysisPass->find(rhsTagDecl);
                 if (it == importAnalysisPass->end() || !it->second.isImportedSomehow() || it->second.isImportedAsNonCopyable()) {
-                    return true;
+                    return;
                 }
             }
         }
@@ -382,8 +388,6 @@ public:
                 _witnessSet.insert(l, r, properties);
             }
         }
-        
-        return true;
     }
 
 private:
@@ -32,3 +32,10 @@ std::string ComparableAnalysisPass::serializationFileName() const {
 std::string ComparableAnalysisPass::testFileName() const {
     return "testComparable.txt";
 }
+
+std::vector<const ASTAnalysisPassBase*> ComparableAnalysisPass::getDependencies() const {
+    return {
+        getASTAnalysisRunner().getImportAnalysisPass(),
+        getASTAnalysisRunner().getEquatableAnalysisPass(),
+    };
+}
@@ -21,6 +21,7 @@
 #include "AnalysisPass/ImportAnalysisPass.h"
 #include "AnalysisPass/CustomStringConvertibleAnalysisPass.h"
 #include "AnalysisPass/FindEnumsAnalysisPass.h"
+#include "AnalysisPass/OperatorCandidateIndex.h"
 
 CustomStringConvertibleAnalysisPass::CustomStringConvertibleAnalysisPass(ASTAnalysisRunner* astAnalysisRunner) :
     ASTAnalysisPass<CustomStringConvertibleAnalysisPass, CustomStringConvertibleAnalysisResult>(astAnalysisRunner) {}
@@ -33,6 +34,13 @@ std::string CustomStringConvertibleAnalysisPass::testFileName() const {
     return "testCustomStringConvertible.txt";
 }
 
+std::vector<const ASTAnalysisPassBase*> CustomStringConvertibleAnalysisPass::getDependencies() const {
+    return {
+        getASTAnalysisRunner().getImportAnalysisPass(),
+        getASTAnalysisRunner().getFindEnumsAnalysisPass(),
+    };
+}
+
 // Unfortunately, we need to visit decls not from Usd,
 // because types like GfHalf might define implicit conversions
 // to e.g. stdlib types like float with an <<
@@ -40,6 +48,10 @@ bool CustomStringConvertibleAnalysisPass::shouldOnlyVisitDeclsFromUsd() const {
     return false;
 }
 
+bool CustomStringConvertibleAnalysisPass::usesOperatorCandidateIndex() const {
+    return true;
+}
+
 void CustomStringConvertibleAnalysisPass::finalize(const clang::NamedDecl* namedDecl) {
     const clang::TagDecl* tagDecl = clang::dyn_cast<clang::TagDecl>(namedDecl);
     // We only need to do checking on this tagDecl and not worry about templates,
@@ -55,7 +67,7 @@ void CustomStringConvertibleAnalysisPass::finalize(const clang::NamedDecl* named
     if (!cxxRecordDecl) {
         // Could be an enum with an <<
         clang::QualType q = tagDecl->getTypeForDecl()->getCanonicalTypeUnqualified();
-        if (_lessThanLessThanFunctionTypes.contains(q)) {
+        if (hasLessThanLessThanFunction(q)) {
             insert_or_assign(tagDecl, CustomStringConvertibleAnalysisResult::available);
         } else {
             insert_or_assign(tagDecl, CustomStringConvertibleAnalysisResult::blockedByNoCandidate);
@@ -85,7 +97,7 @@ void CustomStringConvertibleAnalysisPass::finalize(const clang::NamedDecl* named
     // and make this type CustomStringConvertible.
     int nCandidates = 0;
     for (uint64_t i = 0; i < convertibleTypes.size(); i++) {
-        if (_lessThanLessThanFunctionTypes.contains(convertibleTypes[i].getCanonicalType())) {
+        if (hasLessThanLessThanFunction(convertibleTypes[i].getCanonicalType())) {
             nCandidates += 1;
             break;
         } else if (convertibleTypes[i]->isArithmeticType()) {
@@ -190,27 +202,42 @@ bool CustomStringConvertibleAnalysisPass::VisitCXXRecordDecl(clang::CXXRecordDec
     return true;
 }
 
-bool CustomStringConvertibleAnalysisPass::VisitFunctionDecl(clang::FunctionDecl *functionDecl) {
+bool CustomStringConvertibleAnalysisPass::hasLessThanLessThanFunction(clang::QualType qualType) const {
+    qualType = qualType.getCanonicalType();
+    const auto& it = _hasLessThanLessThanFunction.find(qualType);
+    if (it != _hasLessThanLessThanFunction.end()) {
+        return it->second;
+    }
+    
+    bool result = false;
+    const OperatorCandidateIndex& operatorCandidateIndex = getASTAnalysisRunner().getOperatorCandidateIndex();
+    for (const OperatorCandidateIndex::Candidate* candidate : operatorCandidateIndex.getCandidates(OperatorCandidateIndex::Kind::lessLess, qualType)) {
+        if (isLessThanLessThanFunction(candidate->functionDecl)) {
+            result = true;
+            break;
+        }
+    }
+    _hasLessThanLessThanFunction.insert({qualType, result});
+    return result;
+}
+
+bool CustomStringConvertibleAnalysisPass::isLessThanLessThanFunction(const clang::FunctionDecl* functionDecl) const {
     // Important: Don't disallow functions not from Usd,
     // because we might want to use `<<` functions from stdlib
     // (e.g., GfHalf)
     if (isEarliestDeclLocFromUsd(functionDecl) && !areAllUsdDeclsFromPublicHeaders(functionDecl)) {
 #warning suspect use of declLocFromUsd
-        return true;
+        return false;
     }
     
-    // Must be <<
-    if (functionDecl->getOverloadedOperator() != clang::OO_LessLess) {
-        return true;
-    }
     
     // Ignore if Swift can't see it
     if (functionDecl->isDeleted() || ASTHelpers::isNotVisibleToSwift(functionDecl->getAccess())) {
-        return true;
+        return false;
     }
     
     if (functionDecl->getNumParams() != 2) {
-        return true;
+        return false;
     }
     
     // Pull out the types of the arguments...
@@ -222,15 +249,15 @@ bool CustomStringConvertibleAnalysisPass::VisitFunctionDecl(clang::FunctionDecl
     // Not sure this is the best way to do a check,
     // but I don't know a better way
     if (lhsType.getAsString() != "std::ostream &") {
-        return true;
+        return false;
     }
     if (retType.getAsString() != "std::ostream &") {
-        return true;
+        return false;
     }
     if (!rhsType->isBuiltinType()) {
         rhsType = ASTHelpers::removingRefConst(rhsType);
         if (rhsType.isNull()) {
-            return true;
+            return false;
         }
     }
     
@@ -242,19 +269,14 @@ bool CustomStringConvertibleAnalysisPass::VisitFunctionDecl(clang::FunctionDecl
         if (doesTypeContainUsdTypes(rhsTagDecl)) {
             const auto& it = importAnalysisPass->find(rhsTagDecl);
             if (it == importAnalysisPass->end() || !it->second.isImportedSomehow() || it->second.isImportedAsNonCopyable()) {
-                return true;
+                return false;
             }
         }
     }
     
     // We used to support templated types here for efficiency,
-    // but that caused problems because we didn't handle things correctly
-    std::vector<clang::QualType> rhsTypes = {rhsType};
-    
-    for (clang::QualType r : rhsTypes) {
-        _lessThanLessThanFunctionTypes.insert(r.getCanonicalType());
-    }
-    
+    // but that caused problems because we didn't handle things correctly.
+    // The index already keyed this function by the canonical type of rhsType
     return true;
 }
 
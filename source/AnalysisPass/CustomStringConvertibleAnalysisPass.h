@@ -23,6 +23,7 @@
 
 #include "AnalysisPass/ASTAnalysisPass.h"
 #include "AnalysisResult/CustomStringConvertibleAnalysisResult.h"
+#include <map>
 
 // A type T is CustomStringConvertible iff there is a function `std::ostream& operator<<(std::ostream& os, const U& obj)` where T is convertible to U.
 // CustomStringConvertible is inheritable
@@ -33,14 +34,21 @@ public:
     
     std::string serializationFileName() const override;
     std::string testFileName() const override;
+    std::vector<const ASTAnalysisPassBase*> getDependencies() const override;
     bool VisitEnumDecl(clang::EnumDecl* enumDecl) override;
     bool VisitCXXRecordDecl(clang::CXXRecordDecl* cxxRecordDecl) override;
-    bool VisitFunctionDecl(clang::FunctionDecl* functionDecl) override;
     void finalize(const clang::NamedDecl* namedDecl) override;
     bool shouldOnlyVisitDeclsFromUsd() const override;
+    bool usesOperatorCandidateIndex() const override;
     
 private:
-    std::set<clang::QualType> _lessThanLessThanFunctionTypes;
+    // Whether there's a `std::ostream& operator<<(std::ostream&, const T&)` for the canonical type T,
+    // looked up in ASTAnalysisRunner::getOperatorCandidateIndex()
+    bool hasLessThanLessThanFunction(clang::QualType qualType) const;
+    bool isLessThanLessThanFunction(const clang::FunctionDecl* functionDecl) const;
+    
+    // hasLessThanLessThanFunction() by canonical type. Only used while finalizing, which is single-threaded
+    mutable std::map<clang::QualType, bool> _hasLessThanLessThanFunction;
 };
 
 #endif /* CustomStringConvertibleAnalysisPass_h */
@@ -32,3 +32,9 @@ std::string EquatableAnalysisPass::serializationFileName() const {
 std::string EquatableAnalysisPass::testFileName() const {
     return "testEquatable.txt";
 }
+
+std::vector<const ASTAnalysisPassBase*> EquatableAnalysisPass::getDependencies() const {
+    return {
+        getASTAnalysisRunner().getImportAnalysisPass(),
+    };
+}
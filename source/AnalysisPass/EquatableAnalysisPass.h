@@ -31,6 +31,7 @@ public:
     
     std::string serializationFileName() const override;
     std::string testFileName() const override;
+    std::vector<const ASTAnalysisPassBase*> getDependencies() const override;
 };
 
 #endif /* EquatableAnalysisPass_h */
@@ -33,6 +33,15 @@ std::string FindEnumsAnalysisPass::testFileName() const {
     return "testFindEnums.txt";
 }
 
+std::vector<const ASTAnalysisPassBase*> FindEnumsAnalysisPass::getDependencies() const {
+    return {};
+}
+
+// Cases are only added while visiting the enum's own constants
+bool FindEnumsAnalysisPass::supportsIncrementalAnalysis() const {
+    return true;
+}
+
 bool FindEnumsAnalysisPass::VisitEnumConstantDecl(clang::EnumConstantDecl* enumConstantDecl) {
     if (!isEarliestDeclLocFromUsd(enumConstantDecl)) {
         return true;
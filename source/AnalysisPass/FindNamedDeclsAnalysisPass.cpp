@@ -22,12 +22,16 @@
 #include "AnalysisPass/ASTAnalysisPass.h"
 #include "AnalysisResult/FindNamedDeclsAnalysisResult.h"
 #include "AnalysisPass/ASTAnalysisRunner.h"
+#include "Util/BinaryAnalysisCache.h"
 #include <fstream>
+#include <mutex>
 
 
 
 FindNamedDeclsAnalysisPass::FindNamedDeclsAnalysisPass(ASTAnalysisRunner* astAnalysisRunner) :
-ASTAnalysisPass<FindNamedDeclsAnalysisPass, FindNamedDeclsAnalysisResult>(astAnalysisRunner) {
+ASTAnalysisPass<FindNamedDeclsAnalysisPass, FindNamedDeclsAnalysisResult>(astAnalysisRunner),
+_currentAnchorDecl(nullptr),
+_didLoadNameIndex(false) {
     insert_or_assign(nullptr, FindNamedDeclsAnalysisResult());
 }
 
@@ -39,6 +43,10 @@ std::string FindNamedDeclsAnalysisPass::testFileName() const {
     return "testFindNamedDecls.txt";
 }
 
+std::vector<const ASTAnalysisPassBase*> FindNamedDeclsAnalysisPass::getDependencies() const {
+    return {};
+}
+
 void FindNamedDeclsAnalysisPass::serialize() const {
     std::cout << "Serializing " << serializationFileName() << std::endl;
     
@@ -51,10 +59,189 @@ void FindNamedDeclsAnalysisPass::serialize() const {
     stream << find(nullptr)->second << std::endl;
     
     stream.close();
+    
+    if (!_serializeNameIndex()) {
+        std::cerr << "Warning: Could not persist the name index, so " << serializationFileName() << " will be rerun next time" << std::endl;
+    }
 }
 
 bool FindNamedDeclsAnalysisPass::deserialize() {
-    return false;
+    return _deserializeNameIndex();
+}
+
+bool FindNamedDeclsAnalysisPass::didLoadNameIndex() const {
+    return _didLoadNameIndex;
+}
+
+bool FindNamedDeclsAnalysisPass::_serializeNameIndex() const {
+    const FileSystemInfo& f = getFileSystemInfo();
+    const ASTAnalysisRunner& runner = getASTAnalysisRunner();
+    const clang::TranslationUnitDecl* translationUnitDecl = runner.getTranslationUnitDecl();
+    
+    std::vector<std::pair<uint64_t, std::string>> namedDeclRecords;
+    bool hasDeclsWithoutIDs = false;
+    getNamedDeclMap().forEach([&](std::string name, const clang::NamedDecl* namedDecl) {
+        uint64_t declID = runner.getSerializedDeclID(namedDecl);
+        if (declID == 0) {
+            // Builtin decls that clang makes for every AST don't have IDs,
+            // but they're found again while deserializing
+            hasDeclsWithoutIDs |= namedDecl->getDeclContext() != translationUnitDecl;
+            return;
+        }
+        namedDeclRecords.push_back({declID, std::move(name)});
+    });
+    
+    std::vector<std::pair<uint64_t, std::string>> typeRecords;
+    getTypeMap().forEach([&](std::string name, const clang::Type* type) {
+        // An anchor of 0 means searching the decls that weren't loaded from the serialized AST,
+        // so that only works for types visited within builtin decls
+        const auto& anchorIt = _typeAnchorDecls.find(type);
+        const clang::Decl* anchor = anchorIt != _typeAnchorDecls.end() ? anchorIt->second : nullptr;
+        uint64_t anchorID = runner.getSerializedDeclID(anchor);
+        if (anchorID == 0) {
+            while (anchor && anchor->getLexicalDeclContext() && anchor->getLexicalDeclContext() != translationUnitDecl) {
+                anchor = clang::Decl::castFromDeclContext(anchor->getLexicalDeclContext());
+            }
+            hasDeclsWithoutIDs |= !anchor || anchor == translationUnitDecl || anchor->isFromASTFile();
+        }
+        typeRecords.push_back({anchorID, std::move(name)});
+    });
+    if (hasDeclsWithoutIDs) {
+        std::filesystem::remove(f.getSerializedNamedDeclIndexPath());
+        std::filesystem::remove(f.getSerializedTypeIndexPath());
+        return false;
+    }
+    
+    // Like other passes' binary caches, the index is only used while the text file is unchanged
+    uint64_t fingerprint = getASTAnalysisRunner().getDriver()->getClangToolHelper()->getSerializedASTFingerprint();
+    BinaryAnalysisCache::SourceStamp textStamp = BinaryAnalysisCache::stampFile(f.getSerializedAnalysisPath(serializationFileName()));
+    return BinaryAnalysisCache::write(f.getSerializedNamedDeclIndexPath(), fingerprint, textStamp, BinaryAnalysisCache::ValueFormat::text, namedDeclRecords) &&
+           BinaryAnalysisCache::write(f.getSerializedTypeIndexPath(), fingerprint, textStamp, BinaryAnalysisCache::ValueFormat::text, typeRecords);
+}
+
+bool FindNamedDeclsAnalysisPass::_deserializeNameIndex() {
+    const FileSystemInfo& f = getFileSystemInfo();
+    uint64_t fingerprint = getASTAnalysisRunner().getDriver()->getClangToolHelper()->getSerializedASTFingerprint();
+    BinaryAnalysisCache::SourceStamp textStamp = BinaryAnalysisCache::stampFile(f.getSerializedAnalysisPath(serializationFileName()));
+    if (!textStamp.exists()) {
+        // Deleting the text file forces this pass to be analyzed again
+        std::filesystem::remove(f.getSerializedNamedDeclIndexPath());
+        std::filesystem::remove(f.getSerializedTypeIndexPath());
+        return false;
+    }
+    std::unique_ptr<BinaryAnalysisCache> namedDeclIndex = BinaryAnalysisCache::load(f.getSerializedNamedDeclIndexPath(), fingerprint, textStamp, BinaryAnalysisCache::ValueFormat::text);
+    std::unique_ptr<BinaryAnalysisCache> typeIndex = BinaryAnalysisCache::load(f.getSerializedTypeIndexPath(), fingerprint, textStamp, BinaryAnalysisCache::ValueFormat::text);
+    if (!namedDeclIndex || !typeIndex) {
+        return false;
+    }
+    
+    std::cout << "Deserializing " << serializationFileName() << " from name index" << std::endl;
+    
+    _serializedNamedDeclIDs.reserve(namedDeclIndex->size());
+    for (uint64_t i = 0; i < namedDeclIndex->size(); i++) {
+        BinaryAnalysisCache::Record record = (*namedDeclIndex)[i];
+        _serializedNamedDeclIDs.insert_or_assign(record.value, record.key);
+    }
+    _serializedTypeAnchorDeclIDs.reserve(typeIndex->size());
+    for (uint64_t i = 0; i < typeIndex->size(); i++) {
+        BinaryAnalysisCache::Record record = (*typeIndex)[i];
+        _serializedTypeAnchorDeclIDs.insert_or_assign(record.value, record.key);
+    }
+    
+    // Builtin decls aren't in the index, but they're already in memory,
+    // so finding them doesn't load anything from the serialized AST
+    for (clang::Decl* decl : getASTAnalysisRunner().getTranslationUnitDecl()->noload_decls()) {
+        clang::NamedDecl* namedDecl = clang::dyn_cast<clang::NamedDecl>(decl);
+        if (namedDecl && !namedDecl->isFromASTFile()) {
+            getNamedDeclMap().insert_or_assign(ASTHelpers::getAsString(namedDecl), namedDecl);
+        }
+    }
+    
+    _didLoadNameIndex = true;
+    return true;
+}
+
+const clang::NamedDecl* FindNamedDeclsAnalysisPass::_materializeNamedDecl(const std::string& name) const {
+    const uint64_t* declID = _serializedNamedDeclIDs.find(name);
+    if (!declID) {
+        return nullptr;
+    }
+    
+    {
+        std::shared_lock<std::shared_mutex> lock(_materializedMutex);
+        if (const clang::NamedDecl* const* it = _materializedNamedDecls.find(name)) {
+            return *it;
+        }
+    }
+    
+    const clang::NamedDecl* result = clang::dyn_cast_or_null<clang::NamedDecl>(getASTAnalysisRunner().getDeclForSerializedDeclID(*declID));
+    
+    std::unique_lock<std::shared_mutex> lock(_materializedMutex);
+    _materializedNamedDecls.insert_or_assign(name, result);
+    return result;
+}
+
+namespace {
+    // Finds the last type named `name` that's visited while traversing a decl,
+    // the same way FindNamedDecls' traversal would have visited it
+    struct TypeFinder : public clang::RecursiveASTVisitor<TypeFinder> {
+        TypeFinder(const std::string& name) : name(name), result(nullptr) {}
+        
+        bool shouldVisitTemplateInstantiations() const { return true; }
+        bool shouldVisitImplicitCode() const { return true; }
+        
+        bool VisitType(clang::Type* type) {
+            if (type && ASTHelpers::getAsString(type) == name) {
+                result = type;
+            }
+            return true;
+        }
+        
+        const std::string& name;
+        const clang::Type* result;
+    };
+}
+
+const clang::Type* FindNamedDeclsAnalysisPass::_materializeType(const std::string& name) const {
+    const uint64_t* anchorID = _serializedTypeAnchorDeclIDs.find(name);
+    if (!anchorID) {
+        return nullptr;
+    }
+    
+    {
+        std::shared_lock<std::shared_mutex> lock(_materializedMutex);
+        if (const clang::Type* const* it = _materializedTypes.find(name)) {
+            return *it;
+        }
+    }
+    
+    // The type was last visited while traversing the anchor, so that's the only decl to search.
+    // Types without an anchor were visited in builtin decls, which are already in memory
+    std::vector<const clang::Decl*> anchors;
+    if (const clang::Decl* anchor = getASTAnalysisRunner().getDeclForSerializedDeclID(*anchorID)) {
+        anchors.push_back(anchor);
+    } else {
+        for (const clang::Decl* decl : getASTAnalysisRunner().getTranslationUnitDecl()->noload_decls()) {
+            if (!decl->isFromASTFile()) {
+                anchors.push_back(decl);
+            }
+        }
+    }
+    
+    const clang::Type* result = nullptr;
+    for (const clang::Decl* anchor : anchors) {
+        // Traversing may deserialize parts of the anchor
+        std::lock_guard<std::mutex> lock(ASTHelpers::getClangMutex());
+        TypeFinder finder(name);
+        finder.TraverseDecl(const_cast<clang::Decl*>(anchor));
+        if (finder.result) {
+            result = finder.result;
+        }
+    }
+    
+    std::unique_lock<std::shared_mutex> lock(_materializedMutex);
+    _materializedTypes.insert_or_assign(name, result);
+    return result;
 }
 
 // We need to traverse the entire AST to find types like `std::vector<pxr::TfToken>`,
@@ -63,6 +250,14 @@ bool FindNamedDeclsAnalysisPass::shouldOnlyVisitDeclsFromUsd() const {
     return false;
 }
 
+bool FindNamedDeclsAnalysisPass::TraverseDecl(clang::Decl* decl) {
+    const clang::Decl* previousAnchorDecl = _currentAnchorDecl;
+    _currentAnchorDecl = decl;
+    bool result = ASTAnalysisPass<FindNamedDeclsAnalysisPass, FindNamedDeclsAnalysisResult>::TraverseDecl(decl);
+    _currentAnchorDecl = previousAnchorDecl;
+    return result;
+}
+
 bool FindNamedDeclsAnalysisPass::VisitNamedDecl(clang::NamedDecl* namedDecl) {
     // Important: Don't require that this tagDecl is from Usd.
     // The import pass has to handle types that are fully non-Usd,
@@ -85,13 +280,12 @@ bool FindNamedDeclsAnalysisPass::VisitNamedDecl(clang::NamedDecl* namedDecl) {
     // because we might be replacing a definition with a declaration
     bool shouldReplace = true;
     
-    const auto& existingIt = namedDeclMap.find(typeName);
-    if (existingIt != namedDeclMap.end()) {
-        if (const clang::TagDecl* existingTag = clang::dyn_cast<clang::TagDecl>(existingIt->second)) {
+    if (const clang::NamedDecl* const* existing = namedDeclMap.find(typeName)) {
+        if (const clang::TagDecl* existingTag = clang::dyn_cast<clang::TagDecl>(*existing)) {
             shouldReplace = !existingTag->isThisDeclarationADefinition();
         }
         
-        if (clang::dyn_cast<clang::TypedefNameDecl>(existingIt->second) && clang::dyn_cast<clang::TypedefNameDecl>(namedDecl)) {
+        if (clang::dyn_cast<clang::TypedefNameDecl>(*existing) && clang::dyn_cast<clang::TypedefNameDecl>(namedDecl)) {
             // Don't replace typedefs/using
             shouldReplace = false;
         }
@@ -107,6 +301,7 @@ bool FindNamedDeclsAnalysisPass::VisitType(clang::Type* type) {
     if (type) {
         std::string typeName = ASTHelpers::getAsString(type);
         getTypeMap().insert_or_assign(typeName, type);
+        _typeAnchorDecls.insert_or_assign(type, _currentAnchorDecl);
     }
     return true;
 }
@@ -115,12 +310,8 @@ void FindNamedDeclsAnalysisPass::test() const {
     std::cout << "Testing " << serializationFileName() << std::endl;
     std::vector<std::string> expected = TestDataLoader::loadOneField(getFileSystemInfo(), testFileName(), TestDataLoader::PxrNsReplacement::replace);
     
-    const auto& namedDeclMap = getNamedDeclMap();
-    const auto& typeMap = getTypeMap();
     for (const std::string& line : expected) {
-        const auto& it1 = namedDeclMap.find(line);
-        const auto& it2 = typeMap.find(line);
-        if (it1 == namedDeclMap.end() && it2 == typeMap.end()) {
+        if (!findNamedDecl(line) && !findType(line)) {
             std::cerr << "No named decl or type matches " << line << std::endl;
             __builtin_trap();
         }
@@ -138,13 +329,17 @@ const clang::TagDecl* FindNamedDeclsAnalysisPass::findTagDecl(const std::string
 }
 
 const clang::NamedDecl* FindNamedDeclsAnalysisPass::findNamedDecl(const std::string& name) const {
-    const auto& it = getNamedDeclMap().find(name);
-    return it != getNamedDeclMap().end() ? it->second : nullptr;
+    if (const clang::NamedDecl* const* it = getNamedDeclMap().find(name)) {
+        return *it;
+    }
+    return _didLoadNameIndex ? _materializeNamedDecl(name) : nullptr;
 }
 
 const clang::Type* FindNamedDeclsAnalysisPass::findType(const std::string& name) const {
-    const auto& it = getTypeMap().find(name);
-    return it != getTypeMap().end() ? it->second : nullptr;
+    if (const clang::Type* const* it = getTypeMap().find(name)) {
+        return *it;
+    }
+    return _didLoadNameIndex ? _materializeType(name) : nullptr;
 }
 
 const clang::FunctionDecl* FindNamedDeclsAnalysisPass::findFunctionDecl(const std::string &signature) const {
@@ -29,12 +29,15 @@
 #include <string>
 #include <fstream>
 #include <optional>
+#include <shared_mutex>
 #include <vector>
 
 // The first analysis pass. This analysis pass allows future analysis passes to find tags by name, which
 // makes testing and deserializing analysis passes much easier. It also makes it easier to write analysis passes and code gen passes,
 // by refering to specific C++ types by their string names.
-// Unfortunately, this analysis pass has to be run every time, and it takes a bit of time to do so. 
+// Traversing the AST to build the index takes a bit of time, so it's persisted next to
+// the serialized AST as a name -> DeclID table. When it's loaded from disk, decls and types
+// are materialized through the ASTReader the first time their name is looked up.
 class FindNamedDeclsAnalysisPass final: public ASTAnalysisPass<FindNamedDeclsAnalysisPass, FindNamedDeclsAnalysisResult> {
 public:
     using AnalysisResult = FindNamedDeclsAnalysisResult;
@@ -43,8 +46,10 @@ public:
         
     std::string serializationFileName() const override;
     std::string testFileName() const override;
+    std::vector<const ASTAnalysisPassBase*> getDependencies() const override;
     void serialize() const override;
     bool deserialize() override;
+    bool TraverseDecl(clang::Decl* decl);
     bool VisitNamedDecl(clang::NamedDecl* namedDecl) override;
     bool VisitType(clang::Type* type) override;
     
@@ -57,6 +62,27 @@ public:
     
     bool shouldOnlyVisitDeclsFromUsd() const override;
     
+    // True if the index was loaded from disk instead of traversing the AST
+    bool didLoadNameIndex() const;
+    
+private:
+    bool _serializeNameIndex() const;
+    bool _deserializeNameIndex();
+    const clang::NamedDecl* _materializeNamedDecl(const std::string& name) const;
+    const clang::Type* _materializeType(const std::string& name) const;
+    
+    // The innermost decl being traversed. The last visit to each type happened while
+    // traversing its anchor decl, so traversing just that decl finds the type again later
+    const clang::Decl* _currentAnchorDecl;
+    std::map<const clang::Type*, const clang::Decl*> _typeAnchorDecls;
+    
+    bool _didLoadNameIndex;
+    NameIndex<uint64_t> _serializedNamedDeclIDs;
+    NameIndex<uint64_t> _serializedTypeAnchorDeclIDs;
+    mutable std::shared_mutex _materializedMutex;
+    mutable FindNamedDeclsAnalysisResult::NamedDeclMap _materializedNamedDecls;
+    mutable FindNamedDeclsAnalysisResult::TypeMap _materializedTypes;
+    
 private:
     const FindNamedDeclsAnalysisResult::NamedDeclMap& getNamedDeclMap() const;
     FindNamedDeclsAnalysisResult::NamedDeclMap& getNamedDeclMap();
@@ -33,6 +33,10 @@ std::string FindSchemasAnalysisPass::testFileName() const {
     return "testFindSchemas.txt";
 }
 
+std::vector<const ASTAnalysisPassBase*> FindSchemasAnalysisPass::getDependencies() const {
+    return {};
+}
+
 bool FindSchemasAnalysisPass::VisitCXXRecordDecl(clang::CXXRecordDecl *cxxRecordDecl) {
     const clang::TagDecl* tagDecl = findTagDecl("class " PXR_NS"::UsdSchemaBase");
     const clang::CXXRecordDecl* usdSchemaBase = clang::dyn_cast<clang::CXXRecordDecl>(tagDecl);
@@ -34,6 +34,7 @@ public:
     
     std::string serializationFileName() const override;
     std::string testFileName() const override;
+    std::vector<const ASTAnalysisPassBase*> getDependencies() const override;
     bool VisitCXXRecordDecl(clang::CXXRecordDecl* cxxRecordDecl) override;
 };
 
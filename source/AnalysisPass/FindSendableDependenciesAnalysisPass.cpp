@@ -32,6 +32,12 @@ std::string FindSendableDependenciesAnalysisPass::testFileName() const {
     return "testFindSendableDependencies.txt";
 }
 
+std::vector<const ASTAnalysisPassBase*> FindSendableDependenciesAnalysisPass::getDependencies() const {
+    return {
+        getASTAnalysisRunner().getImportAnalysisPass(),
+    };
+}
+
 bool FindSendableDependenciesAnalysisPass::shouldOnlyVisitDeclsFromUsd() const {
     return false;
 }
@@ -35,6 +35,7 @@ public:
     
     std::string serializationFileName() const override;
     std::string testFileName() const override;
+    std::vector<const ASTAnalysisPassBase*> getDependencies() const override;
     bool VisitTagDecl(clang::TagDecl* tagDecl) override;
     bool shouldOnlyVisitDeclsFromUsd() const override;
     
@@ -33,6 +33,17 @@ std::string FindStaticTokensAnalysisPass::testFileName() const {
     return "testFindStaticTokens.txt";
 }
 
+std::vector<const ASTAnalysisPassBase*> FindStaticTokensAnalysisPass::getDependencies() const {
+    return {
+        getASTAnalysisRunner().getImportAnalysisPass(),
+    };
+}
+
+// Results only depend on the token type itself and its import result
+bool FindStaticTokensAnalysisPass::supportsIncrementalAnalysis() const {
+    return true;
+}
+
 bool FindStaticTokensAnalysisPass::VisitRecordDecl(clang::RecordDecl* recordDecl) {
     if (!recordDecl->isThisDeclarationADefinition()) {
         return true;
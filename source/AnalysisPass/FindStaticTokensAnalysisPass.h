@@ -34,6 +34,8 @@ public:
     
     std::string serializationFileName() const override;
     std::string testFileName() const override;
+    std::vector<const ASTAnalysisPassBase*> getDependencies() const override;
+    bool supportsIncrementalAnalysis() const override;
     bool VisitRecordDecl(clang::RecordDecl*) override;
 };
 
@@ -36,6 +36,18 @@ std::string FindTfNoticeSubclassesAnalysisPass::testFileName() const {
     return "testFindTfNoticeSubclasses.txt";
 }
 
+std::vector<const ASTAnalysisPassBase*> FindTfNoticeSubclassesAnalysisPass::getDependencies() const {
+    return {
+        getASTAnalysisRunner().getImportAnalysisPass(),
+        getASTAnalysisRunner().getPublicInheritanceAnalysisPass(),
+    };
+}
+
+// Works from PublicInheritance's results
+bool FindTfNoticeSubclassesAnalysisPass::traversesAST() const {
+    return false;
+}
+
 bool FindTfNoticeSubclassesAnalysisPass::VisitTagDecl(clang::TagDecl* _) {
     // We can leverage the result of PublicInheritanceAnalysisPass
     // to make things go very fast, instead of traversing the whole AST
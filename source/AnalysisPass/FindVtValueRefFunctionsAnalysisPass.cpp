@@ -32,6 +32,15 @@ std::string FindVtValueRefFunctionsAnalysisPass::testFileName() const {
     return "testFindVtValueRefFunctions.txt";
 }
 
+std::vector<const ASTAnalysisPassBase*> FindVtValueRefFunctionsAnalysisPass::getDependencies() const {
+    return {};
+}
+
+// Results only depend on the function's own signature
+bool FindVtValueRefFunctionsAnalysisPass::supportsIncrementalAnalysis() const {
+    return true;
+}
+
 bool FindVtValueRefFunctionsAnalysisPass::VisitFunctionDecl(clang::FunctionDecl *functionDecl) {
     if (!functionDecl->isThisDeclarationADefinition()) { return true; }
     if (isFromUsdLibrary(functionDecl, "vt")) { return true; }
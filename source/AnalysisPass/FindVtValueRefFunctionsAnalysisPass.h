@@ -35,6 +35,8 @@ public:
     
     std::string serializationFileName() const override;
     std::string testFileName() const override;
+    std::vector<const ASTAnalysisPassBase*> getDependencies() const override;
+    bool supportsIncrementalAnalysis() const override;
     bool VisitFunctionDecl(clang::FunctionDecl* functionDecl) override;
 };
 
@@ -23,6 +23,7 @@
 #include "AnalysisPass/HashableAnalysisPass.h"
 #include "AnalysisPass/ImportAnalysisPass.h"
 #include "AnalysisPass/EquatableAnalysisPass.h"
+#include "AnalysisPass/OperatorCandidateIndex.h"
 #include "Util/CMakeParser.h"
 #include <fstream>
 
@@ -38,6 +39,13 @@ std::string HashableAnalysisPass::testFileName() const {
     return "testHashable.txt";
 }
 
+std::vector<const ASTAnalysisPassBase*> HashableAnalysisPass::getDependencies() const {
+    return {
+        getASTAnalysisRunner().getImportAnalysisPass(),
+        getASTAnalysisRunner().getEquatableAnalysisPass(),
+    };
+}
+
 // Hashing is complicated!
 //
 // Usd uses a number of different mechanisms for exposing hashing for Usd types.
@@ -96,12 +104,20 @@ void HashableAnalysisPass::finalize(const clang::NamedDecl *namedDecl) {
 }
 
 bool HashableAnalysisPass::VisitFunctionDecl(clang::FunctionDecl* functionDecl) {
+    // Results depend on the order candidates and records are visited in, so candidates
+    // can't be replayed from the index after traversal. Rule out the vast majority of
+    // functions by their operator or name before checking where they're from instead
+    std::optional<OperatorCandidateIndex::Kind> kind = OperatorCandidateIndex::getKind(functionDecl);
+    if (!kind) {
+        return true;
+    }
+    
     if (isEarliestDeclLocFromUsd(functionDecl) && !areAllUsdDeclsFromPublicHeaders(functionDecl)) {
 #warning suspect use of declLocFromUsd
         return true;
     }
     
-    if (functionDecl->getNameAsString() == "TfHashAppend") {
+    if (*kind == OperatorCandidateIndex::Kind::tfHashAppend) {
         if (functionDecl->parameters().size() != 2) {
             return true;
         }
@@ -110,19 +126,19 @@ bool HashableAnalysisPass::VisitFunctionDecl(clang::FunctionDecl* functionDecl)
         
         return true;
         
-    } else if (functionDecl->getNameAsString() == "hash_value") {
+    } else if (*kind == OperatorCandidateIndex::Kind::hashValue) {
         if (functionDecl->parameters().size() != 1) {
             return true;
         }
         
         clang::QualType qualType = functionDecl->parameters()[0]->getType();
         if (qualType.getAsString() == "const half") {
-            qualType = functionDecl->getASTContext().getLValueReferenceType(qualType);
+            qualType = ASTHelpers::getLValueReferenceType(functionDecl->getASTContext(), qualType);
         }
         onFindPotentialCandidate(qualType);
         return true;
         
-    } else if (functionDecl->getOverloadedOperator() == clang::OO_Call) {
+    } else if (*kind == OperatorCandidateIndex::Kind::call) {
         if (functionDecl->parameters().size() != 1) {
             return true;
         }
@@ -39,6 +39,7 @@ public:
     
     std::string serializationFileName() const override;
     std::string testFileName() const override;
+    std::vector<const ASTAnalysisPassBase*> getDependencies() const override;
     bool VisitFunctionDecl(clang::FunctionDecl* functionDecl) override;
     bool VisitCXXRecordDecl(clang::CXXRecordDecl* cxxRecordDecl) override;
     void finalize(const clang::NamedDecl* namedDecl) override;
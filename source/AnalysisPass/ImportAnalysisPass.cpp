@@ -26,7 +26,7 @@
 
 
 ImportAnalysisPass::ImportAnalysisPass(ASTAnalysisRunner* astAnalysisRunner) :
-ASTAnalysisPass<ImportAnalysisPass, ImportAnalysisResult>(astAnalysisRunner) {}
+ASTAnalysisPass<ImportAnalysisPass, ImportAnalysisResult, HashedDeclStorage>(astAnalysisRunner) {}
 
 std::string ImportAnalysisPass::serializationFileName() const {
     return "Import.txt";
@@ -36,6 +36,10 @@ std::string ImportAnalysisPass::testFileName() const {
     return "testImport.txt";
 }
 
+std::vector<const ASTAnalysisPassBase*> ImportAnalysisPass::getDependencies() const {
+    return {};
+}
+
 bool ImportAnalysisPass::shouldOnlyVisitDeclsFromUsd() const {
     return false;
 }
@@ -304,6 +308,11 @@ bool ImportAnalysisPass::checkImmortalReferenceType(const clang::TagDecl *tagDec
             break;
         }
     }
+    if (!isTfSingletonSpecialization) {
+        // With `--sharded-ast`, specializations from .cpp files are only in the shards,
+        // whose decls are distinct from the primary unit's, so compare by name
+        isTfSingletonSpecialization = getASTAnalysisRunner().isTfSingletonSpecializedInShards(ASTHelpers::getAsString(cxxRecordDecl));
+    }
     if (!isTfSingletonSpecialization) {
         return false;
     }
@@ -35,7 +35,7 @@
 // how it will be imported (as a value type, as a non-copyable type, or a reference type),
 // or why it is not imported if it is not imported.
 // Useful for code generation and various analysis passes
-class ImportAnalysisPass final: public ASTAnalysisPass<ImportAnalysisPass, ImportAnalysisResult> {
+class ImportAnalysisPass final: public ASTAnalysisPass<ImportAnalysisPass, ImportAnalysisResult, HashedDeclStorage> {
 public:
     using AnalysisResult = ImportAnalysisResult;
     
@@ -43,6 +43,7 @@ public:
     
     std::string serializationFileName() const override;
     std::string testFileName() const override;
+    std::vector<const ASTAnalysisPassBase*> getDependencies() const override;
     
     bool VisitTagDecl(clang::TagDecl* tagDecl) override;
     bool VisitTypedefNameDecl(clang::TypedefNameDecl* typedefNameDecl) override;
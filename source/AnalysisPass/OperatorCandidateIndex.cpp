@@ -0,0 +1,127 @@
+//===----------------------------------------------------------------------===//
+// This source file is part of github.com/apple/SwiftUsd-ast-answerer
+//
+// Copyright © 2025 Apple Inc. and the SwiftUsd-ast-answerer project authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//===----------------------------------------------------------------------===//
+
+#include "AnalysisPass/OperatorCandidateIndex.h"
+#include "AnalysisPass/ASTAnalysisPass.h"
+#include "clang/AST/RecursiveASTVisitor.h"
+
+namespace {
+    // Visits the same functions as an analysis pass that doesn't only visit decls from Usd
+    struct OperatorCandidateCollector : public clang::RecursiveASTVisitor<OperatorCandidateCollector> {
+        std::vector<OperatorCandidateIndex::Candidate> candidates;
+        
+        bool shouldVisitTemplateInstantiations() const { return true; }
+        bool shouldVisitImplicitCode() const { return true; }
+        
+        bool VisitFunctionDecl(clang::FunctionDecl* functionDecl) {
+            if (std::optional<OperatorCandidateIndex::Candidate> candidate = OperatorCandidateIndex::makeCandidate(functionDecl)) {
+                candidates.push_back(*candidate);
+            }
+            return true;
+        }
+    };
+}
+
+OperatorCandidateIndex::OperatorCandidateIndex(const clang::TranslationUnitDecl* translationUnitDecl) {
+    OperatorCandidateCollector collector;
+    collector.TraverseDecl((clang::TranslationUnitDecl*) translationUnitDecl);
+    _addCandidates(collector.candidates);
+}
+
+OperatorCandidateIndex::OperatorCandidateIndex(const std::vector<Candidate>& candidates) {
+    _addCandidates(candidates);
+}
+
+/* static */
+std::optional<OperatorCandidateIndex::Kind> OperatorCandidateIndex::getKind(const clang::FunctionDecl* functionDecl) {
+    switch (functionDecl->getOverloadedOperator()) {
+        case clang::OO_EqualEqual: return Kind::equalEqual;
+        case clang::OO_Less: return Kind::less;
+        case clang::OO_LessLess: return Kind::lessLess;
+        case clang::OO_Call: return Kind::call;
+            
+        case clang::OO_None:
+        {
+            const clang::IdentifierInfo* identifier = functionDecl->getIdentifier();
+            if (identifier && identifier->getName() == "TfHashAppend") {
+                return Kind::tfHashAppend;
+            } else if (identifier && identifier->getName() == "hash_value") {
+                return Kind::hashValue;
+            }
+            return std::nullopt;
+        }
+            
+        default:
+            return std::nullopt;
+    }
+}
+
+/* static */
+std::optional<OperatorCandidateIndex::Candidate> OperatorCandidateIndex::makeCandidate(const clang::FunctionDecl* functionDecl) {
+    std::optional<Kind> kind = getKind(functionDecl);
+    if (!kind) {
+        return std::nullopt;
+    }
+    
+    clang::QualType parameterType;
+    if (functionDecl->getNumParams() > 0) {
+        parameterType = functionDecl->parameters().back()->getType();
+        if (!parameterType->isBuiltinType()) {
+            parameterType = ASTHelpers::removingRefConst(parameterType);
+        }
+        if (!parameterType.isNull()) {
+            parameterType = parameterType.getCanonicalType();
+        }
+    }
+    
+    return Candidate{functionDecl, *kind, parameterType};
+}
+
+void OperatorCandidateIndex::_addCandidates(const std::vector<Candidate>& candidates) {
+    for (const Candidate& candidate : candidates) {
+        std::vector<Candidate>& candidatesOfKind = _candidates[candidate.kind];
+        uint32_t index = (uint32_t) candidatesOfKind.size();
+        candidatesOfKind.push_back(candidate);
+        if (!candidate.parameterType.isNull()) {
+            _candidatesByParameterType[{candidate.kind, candidate.parameterType}].push_back(index);
+        }
+    }
+    
+    std::cout << "Indexed " << candidates.size() << " operator candidates" << std::endl;
+}
+
+const std::vector<OperatorCandidateIndex::Candidate>& OperatorCandidateIndex::getCandidates(Kind kind) const {
+    static const std::vector<Candidate> empty;
+    const auto& it = _candidates.find(kind);
+    return it == _candidates.end() ? empty : it->second;
+}
+
+std::vector<const OperatorCandidateIndex::Candidate*> OperatorCandidateIndex::getCandidates(Kind kind, clang::QualType parameterType) const {
+    std::vector<const Candidate*> result;
+    const auto& it = _candidatesByParameterType.find({kind, parameterType.getCanonicalType()});
+    if (it == _candidatesByParameterType.end()) {
+        return result;
+    }
+    const std::vector<Candidate>& candidates = _candidates.at(kind);
+    for (uint32_t index : it->second) {
+        result.push_back(&candidates[index]);
+    }
+    return result;
+}
@@ -0,0 +1,81 @@
+//===----------------------------------------------------------------------===//
+// This source file is part of github.com/apple/SwiftUsd-ast-answerer
+//
+// Copyright © 2025 Apple Inc. and the SwiftUsd-ast-answerer project authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//===----------------------------------------------------------------------===//
+
+#ifndef OperatorCandidateIndex_h
+#define OperatorCandidateIndex_h
+
+#include <clang/AST/Decl.h>
+#include <map>
+#include <optional>
+#include <vector>
+
+// Functions that might witness Equatable, Comparable, CustomStringConvertible, or Hashable,
+// found in one traversal of the AST instead of one per analysis pass. Candidates are only
+// picked out by their operator or name, so passes still decide which ones they can use.
+// Usually collected during a wave's fused traversal (see FusedASTVisitor)
+class OperatorCandidateIndex {
+public:
+    enum class Kind {
+        // `operator==`
+        equalEqual,
+        // `operator<`
+        less,
+        // `operator<<`
+        lessLess,
+        // `operator()`
+        call,
+        // Functions named `TfHashAppend`
+        tfHashAppend,
+        // Functions named `hash_value`
+        hashValue,
+    };
+    
+    struct Candidate {
+        const clang::FunctionDecl* functionDecl;
+        Kind kind;
+        // The canonical type of the last parameter, without `const&` unless it's a builtin type.
+        // Null if there are no parameters, or the last one is neither builtin nor a const reference
+        clang::QualType parameterType;
+    };
+    
+    // Traverses the AST the same way analysis passes do, so it should be fully deserialized
+    OperatorCandidateIndex(const clang::TranslationUnitDecl* translationUnitDecl);
+    // Candidates that were already collected, in traversal order
+    OperatorCandidateIndex(const std::vector<Candidate>& candidates);
+    
+    // The kind of candidate a function would be, without looking at its parameters
+    static std::optional<Kind> getKind(const clang::FunctionDecl* functionDecl);
+    // Returns nullopt if the function isn't a candidate
+    static std::optional<Candidate> makeCandidate(const clang::FunctionDecl* functionDecl);
+    
+    // Candidates of one kind, in the order an analysis pass traversing the AST would visit them
+    const std::vector<Candidate>& getCandidates(Kind kind) const;
+    // Candidates of one kind whose parameterType is `parameterType`'s canonical type, in traversal order
+    std::vector<const Candidate*> getCandidates(Kind kind, clang::QualType parameterType) const;
+    
+private:
+    void _addCandidates(const std::vector<Candidate>& candidates);
+    
+    std::map<Kind, std::vector<Candidate>> _candidates;
+    // Indices into _candidates
+    std::map<std::pair<Kind, clang::QualType>, std::vector<uint32_t>> _candidatesByParameterType;
+};
+
+#endif /* OperatorCandidateIndex_h */
@@ -20,7 +20,7 @@
 
 #include "AnalysisPass/PublicInheritanceAnalysisPass.h"
 
-PublicInheritanceAnalysisPass::PublicInheritanceAnalysisPass(ASTAnalysisRunner* astAnalysisRunner) : ASTAnalysisPass<PublicInheritanceAnalysisPass, PublicInheritanceAnalysisResult>(astAnalysisRunner) {}
+PublicInheritanceAnalysisPass::PublicInheritanceAnalysisPass(ASTAnalysisRunner* astAnalysisRunner) : ASTAnalysisPass<PublicInheritanceAnalysisPass, PublicInheritanceAnalysisResult, HashedDeclStorage>(astAnalysisRunner) {}
 
 std::string PublicInheritanceAnalysisPass::serializationFileName() const {
     return "PublicInheritance.txt";
@@ -30,6 +30,10 @@ std::string PublicInheritanceAnalysisPass::testFileName() const {
     return "testPublicInheritance.txt";
 }
 
+std::vector<const ASTAnalysisPassBase*> PublicInheritanceAnalysisPass::getDependencies() const {
+    return {};
+}
+
 bool PublicInheritanceAnalysisPass::VisitCXXRecordDecl(clang::CXXRecordDecl* cxxRecordDecl) {
     if (!cxxRecordDecl->isThisDeclarationADefinition()) {
         return true;
@@ -74,6 +78,7 @@ std::unordered_set<const clang::CXXRecordDecl*> PublicInheritanceAnalysisPass::g
     }
     
     {
+        std::lock_guard<std::mutex> lock(_publicSubtypesMutex);
         const auto& it = _publicSubtypes.find(base);
         if (it != _publicSubtypes.end()) {
             return it->second;
@@ -90,6 +95,7 @@ std::unordered_set<const clang::CXXRecordDecl*> PublicInheritanceAnalysisPass::g
         }
     }
     
+    std::lock_guard<std::mutex> lock(_publicSubtypesMutex);
     _publicSubtypes.insert({base, result});
     return result;
 }
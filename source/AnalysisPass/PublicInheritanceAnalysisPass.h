@@ -24,15 +24,17 @@
 #include "AnalysisPass/ASTAnalysisPass.h"
 #include "AnalysisResult/PublicInheritanceAnalysisResult.h"
 #include "clang/AST/RecursiveASTVisitor.h"
+#include <mutex>
 #include <unordered_map>
 #include <unordered_set>
 
-class PublicInheritanceAnalysisPass final: public ASTAnalysisPass<PublicInheritanceAnalysisPass, PublicInheritanceAnalysisResult> {
+class PublicInheritanceAnalysisPass final: public ASTAnalysisPass<PublicInheritanceAnalysisPass, PublicInheritanceAnalysisResult, HashedDeclStorage> {
 public:
     PublicInheritanceAnalysisPass(ASTAnalysisRunner* astAnalysisRunner);
     
     std::string serializationFileName() const override;
     std::string testFileName() const override;
+    std::vector<const ASTAnalysisPassBase*> getDependencies() const override;
     bool VisitCXXRecordDecl(clang::CXXRecordDecl* cxxRecordDecl) override;
     void analysisPassIsFinished() override;
     
@@ -42,6 +44,8 @@ public:
     
 private:
     bool _analysisPassIsFinished = false;
+    // getPublicSubtypes() may be called by passes running on different threads
+    mutable std::mutex _publicSubtypesMutex;
     mutable std::unordered_map<const clang::CXXRecordDecl*, std::unordered_set<const clang::CXXRecordDecl*>> _publicSubtypes;
 };
 
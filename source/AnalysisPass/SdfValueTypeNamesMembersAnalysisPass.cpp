@@ -32,6 +32,15 @@ std::string SdfValueTypeNamesMembersAnalysisPass::testFileName() const {
     return "testSdfValueTypeNamesMembers.txt";
 }
 
+std::vector<const ASTAnalysisPassBase*> SdfValueTypeNamesMembersAnalysisPass::getDependencies() const {
+    return {};
+}
+
+// Only reads the fields of Sdf_ValueTypeNamesType
+bool SdfValueTypeNamesMembersAnalysisPass::traversesAST() const {
+    return false;
+}
+
 bool SdfValueTypeNamesMembersAnalysisPass::VisitTagDecl(clang::TagDecl *tagDecl) {
     // We're looking for the fields on one specific type with a known name,
     // so we don't want to walk the AST, just pull things out that we already know.
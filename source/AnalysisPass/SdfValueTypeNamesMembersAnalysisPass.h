@@ -33,6 +33,8 @@ public:
     
     std::string serializationFileName() const override;
     std::string testFileName() const override;
+    std::vector<const ASTAnalysisPassBase*> getDependencies() const override;
+    bool traversesAST() const override;
     bool VisitTagDecl(clang::TagDecl* tagDecl) override;
 };
 
@@ -22,7 +22,9 @@
 #include "AnalysisPass/FindSendableDependenciesAnalysisPass.h"
 #include "Util/Graph.h"
 
-SendableAnalysisPass::SendableAnalysisPass(ASTAnalysisRunner* astAnalysisRunner) : ASTAnalysisPass<SendableAnalysisPass, SendableAnalysisResult>(astAnalysisRunner) {}
+SendableAnalysisPass::SendableAnalysisPass(ASTAnalysisRunner* astAnalysisRunner) : ASTAnalysisPass<SendableAnalysisPass, SendableAnalysisResult>(astAnalysisRunner),
+_nUndecidedTagLookups(0),
+_shallowestProvisionalDepth(UINT64_MAX) {}
 
 std::string SendableAnalysisPass::serializationFileName() const {
     return "Sendable.txt";
@@ -32,10 +34,34 @@ std::string SendableAnalysisPass::testFileName() const {
     return "testSendable.txt";
 }
 
+std::vector<const ASTAnalysisPassBase*> SendableAnalysisPass::getDependencies() const {
+    return {
+        getASTAnalysisRunner().getFindSendableDependenciesAnalysisPass(),
+    };
+}
+
+// Works from FindSendableDependencies' results
+bool SendableAnalysisPass::traversesAST() const {
+    return false;
+}
+
 bool SendableAnalysisPass::VisitNamedDecl(clang::NamedDecl *namedDecl) {
     const FindSendableDependenciesAnalysisPass* findSendableDependenciesAnalysisPass = getASTAnalysisRunner().getFindSendableDependenciesAnalysisPass();
         
     DirectedGraph<const clang::Type*> dependencyGraph;
+    _undecidedTagSendability.clear();
+    _walkedUndecidedTags.clear();
+    _nUndecidedTagLookups = 0;
+    _tagsBeingDecided.clear();
+    _shallowestProvisionalDepth = UINT64_MAX;
+    
+    // For every node, the dependency edges that point at it, and the node they come from.
+    // Used to explain why a type is unavailable without scanning every member of its SCC
+    struct IncomingEdge {
+        const clang::Type* source;
+        const FindSendableDependenciesAnalysisResult::Dependency* dependency;
+    };
+    std::unordered_map<const clang::Type*, std::vector<IncomingEdge>> incomingEdges;
     
     std::cout << "Will build dependency graph" << std::endl;
     for (const auto& it : findSendableDependenciesAnalysisPass->getData()) {
@@ -46,12 +72,19 @@ bool SendableAnalysisPass::VisitNamedDecl(clang::NamedDecl *namedDecl) {
             dependencyGraph.addNode(node);
         }
         
-        std::vector<FindSendableDependenciesAnalysisResult::Dependency> edges = it.second.dependencies;
+        // Only the dependencies of the tag the node resolves to explain its edges
+        bool isExplainingDecl = node->getAsTagDecl() == it.first;
+        
+        const std::vector<FindSendableDependenciesAnalysisResult::Dependency>& edges = it.second.dependencies;
         for (const auto& edge : edges) {
             switch (edge.kind) {
                 case FindSendableDependenciesAnalysisResult::inheritance: // fallthrough
                 case FindSendableDependenciesAnalysisResult::field: // fallthrough
+                case FindSendableDependenciesAnalysisResult::specialConditional:
                     dependencyGraph.addEdge(node, edge.type);
+                    if (isExplainingDecl) {
+                        incomingEdges[edge.type].push_back({node, &edge});
+                    }
                     break;
                     
                 case FindSendableDependenciesAnalysisResult::specialAvailable:
@@ -61,10 +94,6 @@ bool SendableAnalysisPass::VisitNamedDecl(clang::NamedDecl *namedDecl) {
                 case FindSendableDependenciesAnalysisResult::specialImportedAsReference:
                     insert_or_assign(it.first, SendableAnalysisResult(SendableAnalysisResult::unavailable, it.second));
                     break;
-                                     
-                case FindSendableDependenciesAnalysisResult::specialConditional:
-                    dependencyGraph.addEdge(node, edge.type);
-                    break;
             }
         }
     }
@@ -77,7 +106,34 @@ bool SendableAnalysisPass::VisitNamedDecl(clang::NamedDecl *namedDecl) {
     
     std::cout << "Analyzing SCCs" << std::endl;
     
+    // Sugared nodes have no edges to the tag they resolve to, so that tag might not
+    // have been decided yet when an SCC asks about them, and gets walked instead.
+    // An answer that only relied on decided tags is final. Otherwise, it's only kept
+    // until one of the tags it walked is decided below, because walking a tag doesn't
+    // always agree with deciding its SCC
+    std::unordered_map<const clang::Type*, bool> nodeSendability;
+    std::unordered_map<const clang::Type*, bool> walkedNodeSendability;
+    auto isNodeSendable = [this, &nodeSendability, &walkedNodeSendability](const clang::Type* node) {
+        auto it = nodeSendability.find(node);
+        if (it != nodeSendability.end()) {
+            return it->second;
+        }
+        it = walkedNodeSendability.find(node);
+        if (it != walkedNodeSendability.end()) {
+            return it->second;
+        }
+        uint64_t nUndecidedTagLookups = _nUndecidedTagLookups;
+        bool result = _isSendable(node);
+        if (nUndecidedTagLookups == _nUndecidedTagLookups) {
+            nodeSendability.insert({node, result});
+        } else {
+            walkedNodeSendability.insert({node, result});
+        }
+        return result;
+    };
+    
     // From Tarjan, outSCCs are in reverse topo sort order (sinks to sources)
+    std::vector<IncomingEdge> edgesFromThisScc;
     for (const auto& scc : outSCCs) {
         // First, figure out if we have any unavailable dependencies.
         SendableAnalysisResult result(SendableAnalysisResult::available);
@@ -92,50 +148,62 @@ bool SendableAnalysisPass::VisitNamedDecl(clang::NamedDecl *namedDecl) {
             continue;
         }
                 
-        // Look at all the SCCs we depend on, our neighborSCCs
-        auto neighborSCCs = outDirectedGraph.neighbors(scc.get());
-        for (const auto& neighborSCC : neighborSCCs) {
+        // Look at all the SCCs we depend on, our neighborSCCs.
+        // neighbors() is sorted the same way as before the graph was stored as CSR arrays,
+        // which keeps the order of the unavailable reasons
+        for (std::set<const clang::Type*>* neighborSCC : outDirectedGraph.neighbors(scc.get())) {
             // This particular neighborSCC is Sendable iff all the individual clang::Type* nodes
             // in it are Sendable, so check all those individual nodes.
             for (const clang::Type* neighborNode : *neighborSCC) {
-                if (!_isSendable(neighborNode)) {
-                    // Our neighbor isn't Sendable, so we won't be either.
-                    // Prepare result so we can say we're blocked by this neighbor
-                    if (result._kind == SendableAnalysisResult::available) {
-                        result._unavailableDependencies.dependencies = {};
-                    }
-                    result._kind = SendableAnalysisResult::unavailable;
-                    
-                    
-                    // We don't know why we have a dependency on this neighbor yet.
-                    // (It might be a path, not just a single edge.)
-                    // But, there must be someone in our own SCC that has an edge
-                    // to the individual neighborNode that isn't Sendable. So,
-                    // we want that to be part of the unavailable reasoning
-                    for (const clang::Type* nodeInThisScc : *scc) {
-                        if (dependencyGraph.hasEdge(nodeInThisScc, neighborNode)) {
-                            // We found a pair of nodes with an edge between them,
-                            // where the first node is in our SCC,
-                            // and the second node is in the non-Sendable neighboring SCC.
-                            const auto& it = findSendableDependenciesAnalysisPass->find(nodeInThisScc->getAsTagDecl());
-                            for (const auto& dependency : it->second.dependencies) {
-                                if (dependency.type == neighborNode) {
-                                    // Okay, we finally have the actual dependency edge. Add it to the result.
-                                    result._unavailableDependencies.dependencies.push_back(dependency);
-                                }
-                            }
+                if (isNodeSendable(neighborNode)) {
+                    continue;
+                }
+                
+                // Our neighbor isn't Sendable, so we won't be either.
+                // Prepare result so we can say we're blocked by this neighbor
+                if (result._kind == SendableAnalysisResult::available) {
+                    result._unavailableDependencies.dependencies = {};
+                }
+                result._kind = SendableAnalysisResult::unavailable;
+                
+                // We don't know why we have a dependency on this neighbor yet.
+                // (It might be a path, not just a single edge.)
+                // But, there must be someone in our own SCC that has an edge
+                // to the individual neighborNode that isn't Sendable. So,
+                // we want that to be part of the unavailable reasoning
+                edgesFromThisScc.clear();
+                auto incomingIt = incomingEdges.find(neighborNode);
+                if (incomingIt != incomingEdges.end()) {
+                    for (const IncomingEdge& incomingEdge : incomingIt->second) {
+                        if (outToSCCMapping.find(incomingEdge.source)->second == scc.get()) {
+                            edgesFromThisScc.push_back(incomingEdge);
                         }
                     }
                 }
+                // Group the edges by the node in our SCC they come from, in the order of the SCC's nodes
+                std::stable_sort(edgesFromThisScc.begin(), edgesFromThisScc.end(), [](const IncomingEdge& l, const IncomingEdge& r) {
+                    return std::less<const clang::Type*>()(l.source, r.source);
+                });
+                for (const IncomingEdge& incomingEdge : edgesFromThisScc) {
+                    result._unavailableDependencies.dependencies.push_back(*incomingEdge.dependency);
+                }
             }
         }
         
         // Now, assign to all the nodes in our sccNode
+        bool didDecideWalkedTag = false;
         for (const clang::Type* node : *scc) {
             if (node->isCanonicalUnqualified() && node->getAsTagDecl()) {
                 insert_or_assign(node->getAsTagDecl(), result);
+                didDecideWalkedTag |= _walkedUndecidedTags.contains(node->getAsTagDecl());
             }
         }
+        if (didDecideWalkedTag) {
+            // Walks through these tags might turn out differently now
+            _undecidedTagSendability.clear();
+            _walkedUndecidedTags.clear();
+            walkedNodeSendability.clear();
+        }
     }
     
     
@@ -144,42 +212,136 @@ bool SendableAnalysisPass::VisitNamedDecl(clang::NamedDecl *namedDecl) {
 }
 
 
-bool SendableAnalysisPass::_isSendable(const clang::TagDecl *tagDecl) const {
+std::optional<bool> SendableAnalysisPass::_knownSendability(const clang::TagDecl* tagDecl) const {
     if (find(tagDecl) != end()) {
         return find(tagDecl)->second.isAvailable();
     }
     
     const FindSendableDependenciesAnalysisPass* findSendableDependenciesAnalysisPass = getASTAnalysisRunner().getFindSendableDependenciesAnalysisPass();
-    const auto& it = findSendableDependenciesAnalysisPass->find(tagDecl);
-    if (it == findSendableDependenciesAnalysisPass->end()) {
+    if (findSendableDependenciesAnalysisPass->find(tagDecl) == findSendableDependenciesAnalysisPass->end()) {
         std::cerr << "Warning! Skipping a tag we can't find: '";
         std::cerr << ASTHelpers::getAsString(tagDecl) << "'" << std::endl;
         return false;
     }
-    FindSendableDependenciesAnalysisResult findSendableDependenciesAnalysisResult = it->second;
     
-    bool result = true;
-    for (const auto& dependency : findSendableDependenciesAnalysisResult.dependencies) {
-        switch (dependency.kind) {
-            case FindSendableDependenciesAnalysisResult::inheritance: // fallthrough
-            case FindSendableDependenciesAnalysisResult::field: // fallthrough
-                result &= _isSendable(dependency.type);
-                
-            case FindSendableDependenciesAnalysisResult::specialAvailable:
-                return true;
-                
-            case FindSendableDependenciesAnalysisResult::specialImportedAsReference:
-                return false;
-                
-            case FindSendableDependenciesAnalysisResult::specialConditional:
-                result &= _isSendable(dependency.type);
-        }
+    _walkedUndecidedTags.insert(tagDecl);
+    _nUndecidedTagLookups += 1;
+    auto memoIt = _undecidedTagSendability.find(tagDecl);
+    if (memoIt != _undecidedTagSendability.end()) {
+        return memoIt->second;
+    }
+    // Sendability is the default, so a tag that (indirectly) depends on itself
+    // sees itself as Sendable while its dependencies are being walked
+    auto beingDecidedIt = _tagsBeingDecided.find(tagDecl);
+    if (beingDecidedIt != _tagsBeingDecided.end()) {
+        _shallowestProvisionalDepth = std::min(_shallowestProvisionalDepth, beingDecidedIt->second);
+        return true;
+    }
+    return std::nullopt;
+}
+
+bool SendableAnalysisPass::_isSendable(const clang::TagDecl *tagDecl) const {
+    std::optional<bool> knownSendability = _knownSendability(tagDecl);
+    if (knownSendability) {
+        return *knownSendability;
     }
     
-    return result;
+    // Template dependency chains can be very deep, so walk them with our own stack
+    struct Walk {
+        const clang::TagDecl* tagDecl;
+        const std::vector<FindSendableDependenciesAnalysisResult::Dependency>* dependencies;
+        size_t nextDependency;
+        bool result;
+        uint64_t depth;
+        uint64_t outerShallowestProvisionalDepth;
+    };
+    std::vector<Walk> walks;
+    const FindSendableDependenciesAnalysisPass* findSendableDependenciesAnalysisPass = getASTAnalysisRunner().getFindSendableDependenciesAnalysisPass();
+    auto startWalk = [this, &walks, findSendableDependenciesAnalysisPass](const clang::TagDecl* tagDecl) {
+        uint64_t depth = _tagsBeingDecided.size();
+        _tagsBeingDecided.insert({tagDecl, depth});
+        walks.push_back({tagDecl, &findSendableDependenciesAnalysisPass->find(tagDecl)->second.dependencies, 0, true, depth, _shallowestProvisionalDepth});
+        _shallowestProvisionalDepth = UINT64_MAX;
+    };
+    startWalk(tagDecl);
+    
+    while (true) {
+        Walk& walk = walks.back();
+        const clang::TagDecl* nextTagDecl = nullptr;
+        bool isFinished = false;
+        while (!nextTagDecl && !isFinished && walk.nextDependency < walk.dependencies->size()) {
+            const FindSendableDependenciesAnalysisResult::Dependency& dependency = (*walk.dependencies)[walk.nextDependency];
+            walk.nextDependency += 1;
+            
+            switch (dependency.kind) {
+                case FindSendableDependenciesAnalysisResult::inheritance: // fallthrough
+                case FindSendableDependenciesAnalysisResult::field: // fallthrough
+                    // Falls through to specialAvailable, which overrides whatever
+                    // the dependency would decide, so there's no point walking it
+                case FindSendableDependenciesAnalysisResult::specialAvailable:
+                    walk.result = true;
+                    isFinished = true;
+                    break;
+                    
+                case FindSendableDependenciesAnalysisResult::specialImportedAsReference:
+                    walk.result = false;
+                    isFinished = true;
+                    break;
+                    
+                case FindSendableDependenciesAnalysisResult::specialConditional:
+                {
+                    _TypeSendability typeSendability = _resolveSendability(dependency.type);
+                    if (!typeSendability.tagDecl) {
+                        walk.result &= typeSendability.isSendable;
+                        break;
+                    }
+                    std::optional<bool> dependencySendability = _knownSendability(typeSendability.tagDecl);
+                    if (dependencySendability) {
+                        walk.result &= *dependencySendability;
+                    } else {
+                        nextTagDecl = typeSendability.tagDecl;
+                    }
+                }
+                    break;
+            }
+        }
+        
+        if (nextTagDecl) {
+            // Come back to this walk once the dependency is decided
+            startWalk(nextTagDecl);
+            continue;
+        }
+        
+        bool result = walk.result;
+        _tagsBeingDecided.erase(walk.tagDecl);
+        if (_shallowestProvisionalDepth >= walk.depth) {
+            // Only this tag or tags deeper in the walk were assumed to be Sendable,
+            // and they've all been decided now, so this is final
+            _undecidedTagSendability.insert({walk.tagDecl, result});
+            _shallowestProvisionalDepth = walk.outerShallowestProvisionalDepth;
+        } else {
+            // Depends on a tag further up that's still being decided, and that might turn out
+            // not to be Sendable, so this has to be walked again next time it's asked about
+            _shallowestProvisionalDepth = std::min(walk.outerShallowestProvisionalDepth, _shallowestProvisionalDepth);
+        }
+        
+        walks.pop_back();
+        if (walks.empty()) {
+            return result;
+        }
+        walks.back().result &= result;
+    }
 }
 
 bool SendableAnalysisPass::_isSendable(const clang::Type *type) const {
+    _TypeSendability typeSendability = _resolveSendability(type);
+    if (typeSendability.tagDecl) {
+        return _isSendable(typeSendability.tagDecl);
+    }
+    return typeSendability.isSendable;
+}
+
+SendableAnalysisPass::_TypeSendability SendableAnalysisPass::_resolveSendability(const clang::Type* type) const {
     if (const clang::AdjustedType* adjustedType = clang::dyn_cast<clang::AdjustedType>(type)) {
         if (const clang::DecayedType* decayedType = clang::dyn_cast<clang::DecayedType>(type)) {
             
@@ -193,13 +355,13 @@ bool SendableAnalysisPass::_isSendable(const clang::Type *type) const {
                 type->dump();
                 __builtin_trap();
             }
-            return _isSendable(constantArrayType->getElementType().getTypePtr());
+            return _resolveSendability(constantArrayType->getElementType().getTypePtr());
         }
         if (const clang::DependentSizedArrayType* dependentSizedArrayType = clang::dyn_cast<clang::DependentSizedArrayType>(type)) {
             
         }
         if (const clang::IncompleteArrayType* incompleteArrayType = clang::dyn_cast<clang::IncompleteArrayType>(type)) {
-            return _isSendable(incompleteArrayType->getElementType().getTypePtr());
+            return _resolveSendability(incompleteArrayType->getElementType().getTypePtr());
         }
         if (const clang::VariableArrayType* variableArrayType = clang::dyn_cast<clang::VariableArrayType>(type)) {
             
@@ -208,10 +370,10 @@ bool SendableAnalysisPass::_isSendable(const clang::Type *type) const {
         __builtin_trap();
     }
     if (const clang::AtomicType* atomicType = clang::dyn_cast<clang::AtomicType>(type)) {
-        return _isSendable(atomicType->getValueType().getTypePtr());
+        return _resolveSendability(atomicType->getValueType().getTypePtr());
     }
     if (const clang::AttributedType* attributedType = clang::dyn_cast<clang::AttributedType>(type)) {
-        return _isSendable(attributedType->getEquivalentType().getTypePtr());
+        return _resolveSendability(attributedType->getEquivalentType().getTypePtr());
     }
     if (const clang::BTFTagAttributedType* btfTagAttributedType = clang::dyn_cast<clang::BTFTagAttributedType>(type)) {
         type->dump();
@@ -220,11 +382,11 @@ bool SendableAnalysisPass::_isSendable(const clang::Type *type) const {
     if (const clang::BitIntType* bitIntType = clang::dyn_cast<clang::BitIntType>(type)) {
         type->dump();
         __builtin_trap();
-        return true;
+        return {nullptr, true};
     }
     if (const clang::BlockPointerType* blockPointerType = clang::dyn_cast<clang::BlockPointerType>(type)) {
 #warning "Is this correct?"
-        return false;
+        return {nullptr, false};
     }
     if (const clang::BoundsAttributedType* boundsAttributedType = clang::dyn_cast<clang::BoundsAttributedType>(type)) {
         if (const clang::CountAttributedType* countAttributedType = clang::dyn_cast<clang::CountAttributedType>(type)) {
@@ -235,14 +397,14 @@ bool SendableAnalysisPass::_isSendable(const clang::Type *type) const {
     }
     if (const clang::BuiltinType* builtinType = clang::dyn_cast<clang::BuiltinType>(type)) {
         if (builtinType->isFloatingPoint() || builtinType->isInteger()) {
-            return true;
+            return {nullptr, true};
         }
         if (builtinType->getKind() == clang::BuiltinType::NullPtr) {
-            return true;
+            return {nullptr, true};
         }
         
         if (builtinType->getKind() == clang::BuiltinType::ObjCId) {
-            return false;
+            return {nullptr, false};
         }
         
         type->dump();
@@ -255,11 +417,11 @@ bool SendableAnalysisPass::_isSendable(const clang::Type *type) const {
     if (const clang::DecltypeType* decltypeType = clang::dyn_cast<clang::DecltypeType>(type)) {
         if (const clang::DependentDecltypeType* dependentDecltypeType = clang::dyn_cast<clang::DependentDecltypeType>(type)) {
         }
-        return _isSendable(decltypeType->getUnderlyingType().getTypePtr());
+        return _resolveSendability(decltypeType->getUnderlyingType().getTypePtr());
     }
     if (const clang::DeducedType* deducedType = clang::dyn_cast<clang::DeducedType>(type)) {
         if (const clang::AutoType* autoType = clang::dyn_cast<clang::AutoType>(type)) {
-            return _isSendable(deducedType->getDeducedType().getTypePtr());
+            return _resolveSendability(deducedType->getDeducedType().getTypePtr());
         }
         if (const clang::DeducedTemplateSpecializationType* deducedTemplateSpecializationType = clang::dyn_cast<clang::DeducedTemplateSpecializationType>(type)) {
             
@@ -311,14 +473,14 @@ bool SendableAnalysisPass::_isSendable(const clang::Type *type) const {
         }
         type->dump();
         __builtin_trap();
-        return true;
+        return {nullptr, true};
     }
     if (const clang::MemberPointerType* memberPointerType = clang::dyn_cast<clang::MemberPointerType>(type)) {
         #warning "Is this correct?"
-        return true;
+        return {nullptr, true};
     }
     if (const clang::ObjCObjectPointerType* objcObjectPointerType = clang::dyn_cast<clang::ObjCObjectPointerType>(type)) {
-        return false;
+        return {nullptr, false};
     }
     if (const clang::ObjCObjectType* objcObjectType = clang::dyn_cast<clang::ObjCObjectType>(type)) {
         if (const clang::ObjCInterfaceType* objcInterfaceType = clang::dyn_cast<clang::ObjCInterfaceType>(type)) {
@@ -328,7 +490,7 @@ bool SendableAnalysisPass::_isSendable(const clang::Type *type) const {
             
         }
         if (objcObjectType->isObjCId()) {
-            return false;
+            return {nullptr, false};
         }
         type->dump();
         __builtin_trap();
@@ -348,15 +510,15 @@ bool SendableAnalysisPass::_isSendable(const clang::Type *type) const {
     if (const clang::ParenType* parenType = clang::dyn_cast<clang::ParenType>(type)) {
         type->dump();
         __builtin_trap();
-        return _isSendable(parenType->getInnerType().getTypePtr());
+        return _resolveSendability(parenType->getInnerType().getTypePtr());
     }
     if (const clang::PipeType* pipeType = clang::dyn_cast<clang::PipeType>(type)) {
         type->dump();
         __builtin_trap();
-        return false;
+        return {nullptr, false};
     }
     if (const clang::PointerType* pointerType = clang::dyn_cast<clang::PointerType>(type)) {
-        return false;
+        return {nullptr, false};
     }
     if (const clang::ReferenceType* referenceType = clang::dyn_cast<clang::ReferenceType>(type)) {
         if (const clang::LValueReferenceType* lvalueReferenceType = clang::dyn_cast<clang::LValueReferenceType>(type)) {
@@ -365,28 +527,28 @@ bool SendableAnalysisPass::_isSendable(const clang::Type *type) const {
         if (const clang::RValueReferenceType* rvalueReferenceType = clang::dyn_cast<clang::RValueReferenceType>(type)) {
             
         }
-        return false;
+        return {nullptr, false};
     }
     if (const clang::SubstTemplateTypeParmPackType* substTemplateTypeParmPackType = clang::dyn_cast<clang::SubstTemplateTypeParmPackType>(type)) {
         type->dump();
         __builtin_trap();
-        return _isSendable(substTemplateTypeParmPackType->desugar().getTypePtr());
+        return _resolveSendability(substTemplateTypeParmPackType->desugar().getTypePtr());
     }
     if (const clang::SubstTemplateTypeParmType* substTemplateTypeParmType = clang::dyn_cast<clang::SubstTemplateTypeParmType>(type)) {
-        return _isSendable(substTemplateTypeParmType->desugar().getTypePtr());
+        return _resolveSendability(substTemplateTypeParmType->desugar().getTypePtr());
     }
     if (const clang::TagType* tagType = clang::dyn_cast<clang::TagType>(type)) {
         if (const clang::EnumType* enumType = clang::dyn_cast<clang::EnumType>(type)) {
-            return _isSendable(enumType->getDecl());
+            return {enumType->getDecl(), false};
         }
         if (const clang::RecordType* recordType = clang::dyn_cast<clang::RecordType>(type)) {
-            return _isSendable(recordType->getDecl());
+            return {recordType->getDecl(), false};
         }
         type->dump();
         __builtin_trap();
     }
     if (const clang::TemplateSpecializationType* templateSpecializationType = clang::dyn_cast<clang::TemplateSpecializationType>(type)) {
-        return _isSendable(templateSpecializationType->desugar().getTypePtr());
+        return _resolveSendability(templateSpecializationType->desugar().getTypePtr());
     }
     if (const clang::TemplateTypeParmType* templateTypeParmType = clang::dyn_cast<clang::TemplateTypeParmType>(type)) {
         type->dump();
@@ -395,12 +557,12 @@ bool SendableAnalysisPass::_isSendable(const clang::Type *type) const {
     if (const clang::TypeOfExprType* typeOfExprType = clang::dyn_cast<clang::TypeOfExprType>(type)) {
         type->dump();
         __builtin_trap();
-        return _isSendable(typeOfExprType->desugar().getTypePtr());
+        return _resolveSendability(typeOfExprType->desugar().getTypePtr());
     }
     if (const clang::TypeOfType* typeOfType = clang::dyn_cast<clang::TypeOfType>(type)) {
         type->dump();
         __builtin_trap();
-        return _isSendable(typeOfType->desugar().getTypePtr());
+        return _resolveSendability(typeOfType->desugar().getTypePtr());
     }
     // TypeWithKeyword cannot be cast to, so handle its three subclasses without casting
     {
@@ -413,29 +575,29 @@ bool SendableAnalysisPass::_isSendable(const clang::Type *type) const {
             __builtin_trap();
         }
         if (const clang::ElaboratedType* elaboratedType = clang::dyn_cast<clang::ElaboratedType>(type)) {
-            return _isSendable(elaboratedType->getNamedType().getTypePtr());
+            return _resolveSendability(elaboratedType->getNamedType().getTypePtr());
         }
     }
     if (const clang::TypedefType* typedefType = clang::dyn_cast<clang::TypedefType>(type)) {
-        return _isSendable(typedefType->desugar().getTypePtr());
+        return _resolveSendability(typedefType->desugar().getTypePtr());
     }
     if (const clang::UnaryTransformType* unaryTransformType = clang::dyn_cast<clang::UnaryTransformType>(type)) {
         if (const clang::DependentUnaryTransformType* dependentUnaryTransformType = clang::dyn_cast<clang::DependentUnaryTransformType>(type)) {
         }
-        return _isSendable(unaryTransformType->getUnderlyingType().getTypePtr());
+        return _resolveSendability(unaryTransformType->getUnderlyingType().getTypePtr());
     }
     if (const clang::UnresolvedUsingType* unresolvingUsingType = clang::dyn_cast<clang::UnresolvedUsingType>(type)) {
         type->dump();
         __builtin_trap();
     }
     if (const clang::UsingType* usingType = clang::dyn_cast<clang::UsingType>(type)) {
-        return _isSendable(usingType->getUnderlyingType().getTypePtr());
+        return _resolveSendability(usingType->getUnderlyingType().getTypePtr());
     }
     if (const clang::VectorType* vectorType = clang::dyn_cast<clang::VectorType>(type)) {
         if (const clang::ExtVectorType* extVectorType = clang::dyn_cast<clang::ExtVectorType>(type)) {
-            return _isSendable(vectorType->getElementType().getTypePtr());
+            return _resolveSendability(vectorType->getElementType().getTypePtr());
         }
-        return _isSendable(vectorType->getElementType().getTypePtr());
+        return _resolveSendability(vectorType->getElementType().getTypePtr());
     }
     
     
@@ -25,6 +25,9 @@
 #include "AnalysisResult/SendableAnalysisResult.h"
 
 #include "clang/AST/RecursiveASTVisitor.h"
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
 
 // Sendable analysis occurs in two sub-passes. This is the second sub-pass, that
 // examines the dependencies of a given type to decide if it is Sendable or not. See all FindSendableDependenciesAnalysisPass.
@@ -39,6 +42,8 @@ public:
     
     std::string serializationFileName() const override;
     std::string testFileName() const override;
+    std::vector<const ASTAnalysisPassBase*> getDependencies() const override;
+    bool traversesAST() const override;
     bool VisitNamedDecl(clang::NamedDecl* namedDecl) override;
     
     bool _isSendable(const clang::TagDecl *tagDecl) const;
@@ -46,6 +51,32 @@ public:
     bool _isSendable(const clang::TemplateArgument& templateArg) const;
 
     bool comparesEqualWhileTesting(const SendableAnalysisResult& expected, const SendableAnalysisResult& actual) const override;
+
+private:
+    // A type is either Sendable or not on its own, or it's as Sendable as the tag it resolves to
+    struct _TypeSendability {
+        // Null if isSendable is already known
+        const clang::TagDecl* tagDecl;
+        bool isSendable;
+    };
+    _TypeSendability _resolveSendability(const clang::Type* type) const;
+    // Nullopt if the tag is undecided and has to be walked through its dependencies
+    std::optional<bool> _knownSendability(const clang::TagDecl* tagDecl) const;
+    
+    // Tags that haven't been decided yet (not in _data) are walked through their
+    // dependencies at most once, until one of _walkedUndecidedTags is decided.
+    // Decided tags always take precedence over this
+    mutable std::unordered_map<const clang::TagDecl*, bool> _undecidedTagSendability;
+    // Undecided tags that answers in _undecidedTagSendability were worked out from
+    mutable std::unordered_set<const clang::TagDecl*> _walkedUndecidedTags;
+    // How many times an undecided tag has been asked about, to tell if an answer relied on one
+    mutable uint64_t _nUndecidedTagLookups;
+    // Tags whose dependencies are being walked, and how deep in the walk they are.
+    // A tag that (indirectly) depends on one of these sees it as Sendable for now,
+    // so its own result isn't final until the walk gets back to that tag
+    mutable std::unordered_map<const clang::TagDecl*, uint64_t> _tagsBeingDecided;
+    // The shallowest tag in _tagsBeingDecided that the current walk has seen as Sendable for now
+    mutable uint64_t _shallowestProvisionalDepth;
 };
 
 #endif /* SendableAnalysisPass_h */
@@ -32,6 +32,15 @@ std::string SwiftSubclassCxxAnalysisPass::testFileName() const {
     return "testSwiftSubclassCxx.txt";
 }
 
+std::vector<const ASTAnalysisPassBase*> SwiftSubclassCxxAnalysisPass::getDependencies() const {
+    return {};
+}
+
+// Only processes a fixed list of base classes
+bool SwiftSubclassCxxAnalysisPass::traversesAST() const {
+    return false;
+}
+
 template <typename T>
 T* canonicalize(T* x) {
     // Pure-virtual methods don't have definitions,
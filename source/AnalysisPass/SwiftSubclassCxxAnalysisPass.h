@@ -30,6 +30,8 @@ public:
     
     std::string serializationFileName() const override;
     std::string testFileName() const override;
+    std::vector<const ASTAnalysisPassBase*> getDependencies() const override;
+    bool traversesAST() const override;
     bool VisitNamedDecl(clang::NamedDecl* namedDecl) override;
     void insert_or_assign_while_deserializing(const clang::NamedDecl* namedDecl, const SwiftSubclassCxxAnalysisResult& analysisResult) override;
     bool comparesEqualWhileTesting(const SwiftSubclassCxxAnalysisResult& expected, const SwiftSubclassCxxAnalysisResult& actual) const override;
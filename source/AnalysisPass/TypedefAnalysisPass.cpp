@@ -31,6 +31,15 @@ std::string TypedefAnalysisPass::testFileName() const {
     return "testTypedef.txt";
 }
 
+std::vector<const ASTAnalysisPassBase*> TypedefAnalysisPass::getDependencies() const {
+    return {};
+}
+
+// Results are only added to while visiting typedefs of the tag
+bool TypedefAnalysisPass::supportsIncrementalAnalysis() const {
+    return true;
+}
+
 bool TypedefAnalysisPass::isTypedefInAllowableDeclContext(const clang::TypedefNameDecl* typedefNameDecl) const {
     const clang::DeclContext* declContext = typedefNameDecl->getLexicalDeclContext();
     if (!declContext) {
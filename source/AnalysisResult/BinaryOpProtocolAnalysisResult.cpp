@@ -20,6 +20,7 @@
 
 #include "AnalysisResult/BinaryOpProtocolAnalysisResult.h"
 #include "Util/TestDataLoader.h"
+#include <cstring>
 
 
 bool BinaryOpProtocolAnalysisResult::isAvailable() const {
@@ -134,6 +135,42 @@ std::optional<BinaryOpProtocolAnalysisResult> BinaryOpProtocolAnalysisResult::de
     return std::nullopt;
 }
 
+void BinaryOpProtocolAnalysisResult::serializeBinary(std::string& out) const {
+    out.push_back((char) _kind);
+    // Like the text form, only this kind keeps its witness types
+    if (_kind == availableDifferentArgumentTypes) {
+        uint32_t firstLength = (uint32_t) witnessFirstType.size();
+        out.append((const char*) &firstLength, sizeof(firstLength));
+        out += witnessFirstType;
+        out += witnessSecondType;
+    }
+}
+
+/* static */
+std::optional<BinaryOpProtocolAnalysisResult> BinaryOpProtocolAnalysisResult::deserializeBinaryImpl(std::string_view data) {
+    if (data.empty() || (uint8_t) data[0] > availableDifferentArgumentTypes) {
+        return std::nullopt;
+    }
+    Kind kind = (Kind) data[0];
+    if (kind != availableDifferentArgumentTypes) {
+        if (data.size() != 1) {
+            return std::nullopt;
+        }
+        return BinaryOpProtocolAnalysisResult(kind);
+    }
+    
+    uint32_t firstLength;
+    if (data.size() < 1 + sizeof(firstLength)) {
+        return std::nullopt;
+    }
+    std::memcpy(&firstLength, data.data() + 1, sizeof(firstLength));
+    std::string_view witnesses = data.substr(1 + sizeof(firstLength));
+    if (firstLength > witnesses.size()) {
+        return std::nullopt;
+    }
+    return BinaryOpProtocolAnalysisResult(kind, std::string(witnesses.substr(0, firstLength)), std::string(witnesses.substr(firstLength)));
+}
+
 std::ostream& operator <<(std::ostream& os, const BinaryOpProtocolAnalysisResult& obj) {
     return os << std::string(obj);
 }
@@ -24,6 +24,7 @@
 #include <string>
 #include <fstream>
 #include <optional>
+#include <string_view>
 #include <vector>
 
 template <typename Derived>
@@ -73,6 +74,15 @@ public:
     }
     
     static std::optional<BinaryOpProtocolAnalysisResult> deserializeImpl(const std::string& data);
+    
+    // The kind as a single byte, followed by the witness types if they're serialized, for BinaryAnalysisCache
+    void serializeBinary(std::string& out) const;
+    template <typename Derived>
+    static std::optional<BinaryOpProtocolAnalysisResult> deserializeBinary(std::string_view data, const BinaryOpProtocolAnalysisPassBase<Derived>*) {
+        return deserializeBinaryImpl(data);
+    }
+    
+    static std::optional<BinaryOpProtocolAnalysisResult> deserializeBinaryImpl(std::string_view data);
 
 };
 std::ostream& operator <<(std::ostream& os, const BinaryOpProtocolAnalysisResult& obj);
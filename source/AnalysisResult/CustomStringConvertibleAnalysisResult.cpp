@@ -86,6 +86,18 @@ std::optional<CustomStringConvertibleAnalysisResult> CustomStringConvertibleAnal
     return std::nullopt;
 }
 
+void CustomStringConvertibleAnalysisResult::serializeBinary(std::string& out) const {
+    out.push_back((char) _kind);
+}
+
+/* static */
+std::optional<CustomStringConvertibleAnalysisResult> CustomStringConvertibleAnalysisResult::deserializeBinary(std::string_view data, const CustomStringConvertibleAnalysisPass* astAnalysisPass) {
+    if (data.size() != 1 || (uint8_t) data[0] > availableUsdGeomXformOp) {
+        return std::nullopt;
+    }
+    return CustomStringConvertibleAnalysisResult((Kind) data[0]);
+}
+
 std::ostream& operator <<(std::ostream& os, const CustomStringConvertibleAnalysisResult& obj) {
     return os << std::string(obj);
 }
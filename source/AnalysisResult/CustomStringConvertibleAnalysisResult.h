@@ -24,6 +24,7 @@
 #include <string>
 #include <fstream>
 #include <optional>
+#include <string_view>
 #include <vector>
 
 class CustomStringConvertibleAnalysisPass;
@@ -58,6 +59,10 @@ public:
     CustomStringConvertibleAnalysisResult();
     CustomStringConvertibleAnalysisResult(Kind kind);
     static std::optional<CustomStringConvertibleAnalysisResult> deserialize(const std::string& data, const CustomStringConvertibleAnalysisPass* ASTAnalysisPass);
+    
+    // The kind as a single byte, for BinaryAnalysisCache
+    void serializeBinary(std::string& out) const;
+    static std::optional<CustomStringConvertibleAnalysisResult> deserializeBinary(std::string_view data, const CustomStringConvertibleAnalysisPass* astAnalysisPass);
 };
 std::ostream& operator <<(std::ostream& os, const CustomStringConvertibleAnalysisResult& obj);
 
@@ -26,7 +26,7 @@
 
 FindNamedDeclsAnalysisResult::operator std::string() const {
     std::stringstream s;
-    for (const auto& it : _namedDeclMap) {
+    for (const auto& it : _namedDeclMap.sortedEntries()) {
         s << it.first << ";";
         #define PRINT_IF(T) if (clang::dyn_cast<clang::T>(it.second)) { s << " " << #T << ";"; }
         PRINT_IF(NamedDecl)
@@ -109,7 +109,7 @@ FindNamedDeclsAnalysisResult::operator std::string() const {
         #undef PRINT_IF
         s << std::endl;
     }
-    for (const auto& it : _typeMap) {
+    for (const auto& it : _typeMap.sortedEntries()) {
         s << it.first << ";" << std::endl;
     }
     return s.str();
@@ -22,6 +22,7 @@
 #define FindNamedDeclsAnalysisResult_h
 
 #include "clang/AST/RecursiveASTVisitor.h"
+#include "Util/NameIndex.h"
 
 #include <string>
 #include <fstream>
@@ -33,8 +34,8 @@ class FindNamedDeclsAnalysisPass;
 struct FindNamedDeclsAnalysisResult {
     explicit operator std::string() const;
     
-    typedef std::map<std::string, const clang::NamedDecl*> NamedDeclMap;
-    typedef std::map<std::string, const clang::Type*> TypeMap;
+    typedef NameIndex<const clang::NamedDecl*> NamedDeclMap;
+    typedef NameIndex<const clang::Type*> TypeMap;
 
     
     FindNamedDeclsAnalysisResult();
@@ -73,6 +73,18 @@ std::optional<HashableAnalysisResult> HashableAnalysisResult::deserialize(const
     return std::nullopt;
 }
 
+void HashableAnalysisResult::serializeBinary(std::string& out) const {
+    out.push_back((char) _kind);
+}
+
+/* static */
+std::optional<HashableAnalysisResult> HashableAnalysisResult::deserializeBinary(std::string_view data, const HashableAnalysisPass* astAnalysisPass) {
+    if (data.size() != 1 || (uint8_t) data[0] > available) {
+        return std::nullopt;
+    }
+    return HashableAnalysisResult((Kind) data[0]);
+}
+
 std::ostream& operator <<(std::ostream& os, const HashableAnalysisResult& obj) {
     return os << std::string(obj);
 }
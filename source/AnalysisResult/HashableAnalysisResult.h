@@ -28,6 +28,7 @@
 #include <string>
 #include <fstream>
 #include <optional>
+#include <string_view>
 #include <vector>
 
 class HashableAnalysisPass;
@@ -56,6 +57,10 @@ public:
     HashableAnalysisResult();
     HashableAnalysisResult(Kind kind);
     static std::optional<HashableAnalysisResult> deserialize(const std::string& data, const HashableAnalysisPass* astAnalysisPass);
+    
+    // The kind as a single byte, for BinaryAnalysisCache
+    void serializeBinary(std::string& out) const;
+    static std::optional<HashableAnalysisResult> deserializeBinary(std::string_view data, const HashableAnalysisPass* astAnalysisPass);
 };
 std::ostream& operator <<(std::ostream& os, const HashableAnalysisResult& obj);
 
@@ -183,10 +183,14 @@ void APINotesCodeGen::writeReplacedOrAugmentedFunction(ReplacedOrAugmentedFuncti
     
     { // documentation
         clang::Preprocessor& preprocessor = getCodeGenRunner()->getDriver()->getClangToolHelper()->getASTUnits()[0]->getPreprocessor();
-        clang::comments::FullComment* comment = function->getASTContext().getCommentForDecl(function, &preprocessor);
-        const char* commentStart = function->getASTContext().getSourceManager().getCharacterData(comment->getBeginLoc());
-        const char* commentEnd = function->getASTContext().getSourceManager().getCharacterData(comment->getEndLoc()) + 1;
-        documentation = std::string(commentStart, static_cast<size_t>(commentEnd - commentStart));
+        {
+            // Parsing comments caches them in the ASTContext, and can load source buffers
+            std::lock_guard<std::mutex> lock(ASTHelpers::getClangMutex());
+            clang::comments::FullComment* comment = function->getASTContext().getCommentForDecl(function, &preprocessor);
+            const char* commentStart = function->getASTContext().getSourceManager().getCharacterData(comment->getBeginLoc());
+            const char* commentEnd = function->getASTContext().getSourceManager().getCharacterData(comment->getEndLoc()) + 1;
+            documentation = std::string(commentStart, static_cast<size_t>(commentEnd - commentStart));
+        }
         // trim leading whitespace on each line
         std::vector<std::string> docLines = {""};
         for (const auto& c : documentation) {
@@ -224,17 +228,17 @@ void APINotesCodeGen::writeReplacedOrAugmentedFunction(ReplacedOrAugmentedFuncti
     }
     
     { // retType
-        std::cout << ASTHelpers::getAsString(function) << ": original ret ";
+        CodeGenRunner::log() << ASTHelpers::getAsString(function) << ": original ret ";
         clang::QualType retQualType = function->getReturnType();
-        std::cout << retQualType.getAsString();
+        CodeGenRunner::log() << retQualType.getAsString();
         if (replacedOrAugmentedFunction.analysisResult.getKind() == APINotesAnalysisResult::Kind::replaceConstRefFunctionWithCopyingWrapper) {
             retQualType = ASTHelpers::removingRefConst(retQualType);
-            std::cout << ", constRef removed to " << retQualType.getAsString();
+            CodeGenRunner::log() << ", constRef removed to " << retQualType.getAsString();
         }
         typeNamePrinters.push_back(typeNamePrinter(retQualType));
         retType = getTypeName<CppNameInCpp>(typeNamePrinters.back());
         
-        std::cout << ", printed as " << retType << std::endl;
+        CodeGenRunner::log() << ", printed as " << retType << std::endl;
     }
         
     { // replacementFName
@@ -246,7 +250,7 @@ void APINotesCodeGen::writeReplacedOrAugmentedFunction(ReplacedOrAugmentedFuncti
             clang::QualType instanceType = owningType->getTypeForDecl()->getCanonicalTypeUnqualified();
             // Make the instance type be const&
             instanceType.addConst();
-            instanceType = function->getASTContext().getLValueReferenceType(instanceType);
+            instanceType = ASTHelpers::getLValueReferenceType(function->getASTContext(), instanceType);
             
             typeNamePrinters.push_back(typeNamePrinter(instanceType));
             argumentTypes.push_back(getTypeName<CppNameInCpp>(typeNamePrinters.back()));
@@ -274,7 +278,7 @@ void APINotesCodeGen::writeReplacedOrAugmentedFunction(ReplacedOrAugmentedFuncti
                 std::optional<std::string> printedArg = CppNameInCpp::getFullyQualifiedExprString(defaultArg);
                 if (printedArg) {
                     defaultArguments.push_back(*printedArg);
-                    std::cout << defaultArguments.back() << std::endl;
+                    CodeGenRunner::log() << defaultArguments.back() << std::endl;
                 }
             } else {
                 defaultArguments.push_back("");
@@ -414,13 +418,12 @@ void APINotesCodeGen::writeAPINotesFile() {
     _root->write(lines, 0);
     
     // Deduplicate consecutive empty lines
-    std::vector<std::string> linesCopy;
+    bool previousLineWasEmpty = false;
     for (const auto& l : lines) {
-        if (!linesCopy.empty() && linesCopy.back().empty() && l.empty()) {
+        if (previousLineWasEmpty && l.empty()) {
             continue;
         }
-        linesCopy.push_back(l);
+        writeLine(l);
+        previousLineWasEmpty = l.empty();
     }
-    
-    writeLines(linesCopy);
 }
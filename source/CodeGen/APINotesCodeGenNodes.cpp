@@ -208,7 +208,7 @@ void SwiftSafetyField::_write(std::vector<std::string> &lines, int indentation)
     // keys so that users get a compiler diagnostic that they're using unsafe APIs in Swift.
     //
     // rdar://182429180 (Add a way to version API Notes based on Swift compiler version (not language mode))
-    std::cout << "Warning! Skipping SwiftSafety key in API Notes writing" << std::endl;
+    CodeGenRunner::log() << "Warning! Skipping SwiftSafety key in API Notes writing" << std::endl;
     // lines.push_back(indent(indentation) + "SwiftSafety: " + kind);
 }
 
@@ -353,7 +353,7 @@ void NamespaceItem::add(const clang::NamedDecl *target, APINotesAnalysisResult r
     DeclContext* currentNode = this;
     for (const clang::NamedDecl* namedDecl : declContexts) {
         if (currentNode->dyn_cast_opt<MethodItem>()) {
-            std::cout << "Cannot have decl nexted under MethodItem!" << std::endl;
+            std::cerr << "Cannot have decl nexted under MethodItem!" << std::endl;
             __builtin_trap();
         }
         
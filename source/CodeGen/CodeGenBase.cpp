@@ -20,6 +20,13 @@
 
 #include "CodeGen/CodeGenBase.h"
 #include "CodeGen/ReferenceTypeConformanceCodeGen.h"
+#include <clang/AST/ASTDumper.h>
+#include <llvm/ADT/Hashing.h>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <unordered_set>
 
 std::string swiftSpellingForIntegralType(std::string x) {
     if (x == "bool") { return "CBool"; }
@@ -47,80 +54,163 @@ std::string getQualifiedNameAsStringInLanguage(const clang::NamedDecl* nd, bool
     }
 }
 
+// The configurations TypeNamePrinterImpl can run in
+enum class TypeNameLanguage : uint8_t {
+    swiftNameInSwift,
+    swiftNameInCpp,
+    doccRef,
+    cppNameInCpp,
+    includePathsForSwiftNameInCpp,
+};
+
+// Feature flag guards only depend on whether the open file is C++, Swift, or neither
+enum class FeatureFlagGuardLanguage : uint8_t {
+    none,
+    cpp,
+    swift,
+};
+
+FeatureFlagGuardLanguage _featureFlagGuardLanguage(const std::string& openFileSuffix) {
+    if (openFileSuffix == "h" || openFileSuffix == "cpp" || openFileSuffix == "mm") {
+        return FeatureFlagGuardLanguage::cpp;
+    }
+    if (openFileSuffix == "swift") {
+        return FeatureFlagGuardLanguage::swift;
+    }
+    if (openFileSuffix == "modulemap" || openFileSuffix == "apinotes" || openFileSuffix == "md" || openFileSuffix == "") {
+        return FeatureFlagGuardLanguage::none;
+    }
+    std::cerr << "Unknown openFileSuffix " << openFileSuffix << std::endl;
+    __builtin_trap();
+}
+
+// Process-wide memo of type names, include paths, and feature flag guards.
+// Entries are immutable once published, so lookups return stable pointers instead of copies,
+// and concurrently running code gen passes can share one cache. Nothing is computed while
+// holding the lock, because printing a name recursively looks up other names.
+class TypeNameCache {
+public:
+    struct Entry {
+        // Interned, or nullptr if the type has no name in this language
+        const std::string* result;
+        std::set<std::string> includePaths;
+    };
+    
+    static TypeNameCache& shared() {
+        static TypeNameCache cache;
+        return cache;
+    }
+    
+    const Entry* findName(const Driver* driver, TypeNamePrinter::Type type, TypeNameLanguage language, bool isCopy) const {
+        std::shared_lock<std::shared_mutex> lock(_mutex);
+        auto it = _names.find(_makeKey(driver, type, (uint8_t)language, isCopy));
+        return it == _names.end() ? nullptr : it->second;
+    }
+    
+    // If another thread published the same name first, its entry wins. Both are equal
+    const Entry* insertName(const Driver* driver, TypeNamePrinter::Type type, TypeNameLanguage language, bool isCopy,
+                            const std::optional<std::string>& result, std::set<std::string>&& includePaths) {
+        std::unique_lock<std::shared_mutex> lock(_mutex);
+        auto [it, didInsert] = _names.try_emplace(_makeKey(driver, type, (uint8_t)language, isCopy), nullptr);
+        if (didInsert) {
+            it->second = &_nameStorage.emplace_back(Entry{_intern(result), std::move(includePaths)});
+        }
+        return it->second;
+    }
+    
+    // Guards are interned, or nullptr if no guard is needed
+    bool findGuard(const Driver* driver, TypeNamePrinter::Type type, FeatureFlagGuardLanguage language, const std::string*& outGuard) const {
+        std::shared_lock<std::shared_mutex> lock(_mutex);
+        auto it = _typeGuards.find(_makeKey(driver, type, (uint8_t)language, false));
+        if (it == _typeGuards.end()) {
+            return false;
+        }
+        outGuard = it->second;
+        return true;
+    }
+    const std::string* insertGuard(const Driver* driver, TypeNamePrinter::Type type, FeatureFlagGuardLanguage language, const std::optional<std::string>& guard) {
+        std::unique_lock<std::shared_mutex> lock(_mutex);
+        return _typeGuards.try_emplace(_makeKey(driver, type, (uint8_t)language, false), _intern(guard)).first->second;
+    }
+    
+    bool findGuard(const std::string& includedHeader, const std::string*& outGuard) const {
+        std::shared_lock<std::shared_mutex> lock(_mutex);
+        auto it = _headerGuards.find(includedHeader);
+        if (it == _headerGuards.end()) {
+            return false;
+        }
+        outGuard = it->second;
+        return true;
+    }
+    const std::string* insertGuard(const std::string& includedHeader, const std::optional<std::string>& guard) {
+        std::unique_lock<std::shared_mutex> lock(_mutex);
+        return _headerGuards.try_emplace(includedHeader, _intern(guard)).first->second;
+    }
+    
+private:
+    // The type's opaque pointer, plus the language, isCopy, and which variant the type holds packed into one byte
+    struct Key {
+        const Driver* driver;
+        const void* type;
+        uint8_t flags;
+        
+        bool operator==(const Key& other) const = default;
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return llvm::hash_combine(key.driver, key.type, key.flags);
+        }
+    };
+    
+    static Key _makeKey(const Driver* driver, TypeNamePrinter::Type type, uint8_t language, bool isCopy) {
+        return Key{driver, type.getOpaquePtr(), (uint8_t)((language << 2) | (isCopy << 1) | type.isNamedDecl())};
+    }
+    
+    // Requires holding _mutex exclusively
+    const std::string* _intern(const std::optional<std::string>& s) {
+        return s ? &*_internedStrings.insert(*s).first : nullptr;
+    }
+    
+    mutable std::shared_mutex _mutex;
+    std::unordered_map<Key, const Entry*, KeyHash> _names;
+    std::deque<Entry> _nameStorage;
+    std::unordered_map<Key, const std::string*, KeyHash> _typeGuards;
+    std::unordered_map<std::string, const std::string*> _headerGuards;
+    std::unordered_set<std::string> _internedStrings;
+};
+
 class TypeNamePrinterImpl {
 public:
     // MARK: Public interface
     static std::optional<std::string> swiftNameInSwift(const Driver *driver, TypeNamePrinter::Type type) {
-        TypeNamePrinterImpl impl(driver,
-                                 type,
-                                 "." /* namespaceSeparator */,
-                                 false /* isCppNameInCpp */,
-                                 false /* isDoccRef */,
-                                 true /* doesTypedefSubstitutionForTemplates */,
-                                 true /* failsOnMissingTypedefForTemplateSubstitution */,
-                                 true /* failsOnInvalidNameForCodeGen */,
-                                 true /* usesBackticksOnSwiftReservedKeywords */,
-                                 false /* isCopy */);
-        return impl._result;
+        return _resultOpt(_lookup(driver, type, TypeNameLanguage::swiftNameInSwift, false /* isCopy */));
     }
     static std::optional<std::string> swiftNameInCpp(const Driver *driver, TypeNamePrinter::Type type) {
-        TypeNamePrinterImpl impl(driver,
-                                 type,
-                                 "::" /* namespaceSeparator */,
-                                 false /* isCppNameInCpp */,
-                                 false /* isDoccRef */,
-                                 true /* doesTypedefSubstitutionForTemplates */,
-                                 true /* failsOnMissingTypedefForTemplateSubstitution */,
-                                 true /* failsOnInvalidNameForCodeGen */,
-                                 false /* usesBackticksOnSwiftReservedKeywords */,
-                                 false /* isCopy */);
-        return impl._result;
+        return _resultOpt(_lookup(driver, type, TypeNameLanguage::swiftNameInCpp, false /* isCopy */));
     }
     static std::optional<std::string> doccRef(const Driver *driver, TypeNamePrinter::Type type) {
-        TypeNamePrinterImpl impl(driver,
-                                 type,
-                                 "/" /* namespaceSeparator */,
-                                 false /* isCppNameInCpp */,
-                                 true /* isDoccRef */,
-                                 true /* doesTypedefSubstitutionForTemplates */,
-                                 true /* failsOnMissingTypedefForTemplateSubstitution */,
-                                 true /* failsOnInvalidNameForCodeGen */,
-                                 false /* usesBackticksOnSwiftReservedKeywords */,
-                                 false /* isCopy */);
-        return impl._result;
+        return _resultOpt(_lookup(driver, type, TypeNameLanguage::doccRef, false /* isCopy */));
     }
     static std::optional<std::string> cppNameInCpp(const Driver *driver, TypeNamePrinter::Type type) {
-        TypeNamePrinterImpl impl(driver,
-                                 type,
-                                 "::" /* namespaceSeparator */,
-                                 true /* isCppNameInCpp */,
-                                 false /* isDoccRef */,
-                                 false /* doesTypedefSubstitutionForTemplates */,
-                                 false /* failsOnMissingTypedefForTemplateSubstitution */,
-                                 true /* failsOnInvalidNameForCodeGen */,
-                                 false /* usesBackticksOnSwiftReservedKeywords */,
-                                 false /* isCopy */);
-        return impl._result;
-    }
-    static std::set<std::string> includePathsForSwiftNameInCpp(const Driver *driver, TypeNamePrinter::Type type) {
-        TypeNamePrinterImpl impl(driver,
-                                 type,
-                                 "::" /* namespaceSeparator */,
-                                 true /* isCppNameInCpp */,
-                                 false /* isDoccRef */,
-                                 true /* doesTypedefSubstitutionForTemplates */,
-                                 true /* failsOnMissingTypedefForTemplateSubstitution */,
-                                 true /* failsOnInvalidNameForCodeGen */,
-                                 false /* usesBackticksOnSwiftReservedKeywords */,
-                                 false /* isCopy */);
-        return impl._includePaths;
+        return _resultOpt(_lookup(driver, type, TypeNameLanguage::cppNameInCpp, false /* isCopy */));
+    }
+    static const std::set<std::string>& includePathsForSwiftNameInCpp(const Driver *driver, TypeNamePrinter::Type type) {
+        return _lookup(driver, type, TypeNameLanguage::includePathsForSwiftNameInCpp, false /* isCopy */).includePaths;
     }
     
     static std::optional<std::string> getFullyQualifiedExprString(const clang::Expr* e, bool forSwift) {
         if (!e) { return std::nullopt; }
         
-        e->dump();
-        std::cout << std::endl;
+        {
+            // Like e->dump(), but into this code gen's log instead of straight to stderr
+            std::string dump;
+            llvm::raw_string_ostream stream(dump);
+            clang::ASTDumper dumper(stream, /*ShowColors*/ false);
+            dumper.Visit(e);
+            stream.flush();
+            CodeGenRunner::log() << dump;
+        }
+        CodeGenRunner::log() << std::endl;
         
         std::stringstream ss;
         
@@ -182,12 +272,12 @@ public:
             ss << *recurse;
         } else {
     #warning todo: change this to __builtin_trap() once we have most of them down
-            std::cout << "WARNING! Unhandled Expr type" << std::endl;
+            CodeGenRunner::log() << "WARNING! Unhandled Expr type" << std::endl;
         }
         
         std::string result = ss.str();
         result = std::regex_replace(result, std::regex(PXR_NS), "pxr");
-        std::cout << result << std::endl << std::endl;
+        CodeGenRunner::log() << result << std::endl << std::endl;
         return result;
     }
 
@@ -199,6 +289,7 @@ private:
     // MARK: Input members
     const Driver* _driver;
     TypeNamePrinter::Type _type;
+    TypeNameLanguage _language;
     std::string _namespaceSeparator;
     bool _isCppNameInCpp;
     bool _isDoccRef;
@@ -208,67 +299,61 @@ private:
     bool _usesBackticksOnSwiftReservedKeywords;
     bool _isCopy;
     
-    struct _InputOnlyComparator {
-        auto inputOnlyTuple(const TypeNamePrinterImpl& x) const {
-            return std::make_tuple(x._driver,
-                                   x._type,
-                                   x._namespaceSeparator,
-                                   x._isCppNameInCpp,
-                                   x._isDoccRef,
-                                   x._doesTypedefSubstitutionForTemplates,
-                                   x._failsOnMissingTypedefForTemplateSubstitution,
-                                   x._failsOnInvalidNameForCodeGen,
-                                   x._usesBackticksOnSwiftReservedKeywords,
-                                   x._isCopy);
-        }
-        
-        bool operator() (const TypeNamePrinterImpl& lhs, const TypeNamePrinterImpl& rhs) const {
-            return inputOnlyTuple(lhs) < inputOnlyTuple(rhs);
-        }
-    };
-    
 private:
     TypeNamePrinterImpl(const Driver* driver,
                         TypeNamePrinter::Type type,
-                        std::string namespaceSeparator,
-                        bool isCppNameInCpp,
-                        bool isDoccRef,
-                        bool doesTypedefSubstitutionForTemplates,
-                        bool failsOnMissingTypedefForTemplateSubstitution,
-                        bool failsOnInvalidNameForCodeGen,
-                        bool usesBackticksOnSwiftReservedKeywords,
+                        TypeNameLanguage language,
                         bool isCopy) :
     _driver(driver),
     _type(type),
-    _namespaceSeparator(namespaceSeparator),
-    _isCppNameInCpp(isCppNameInCpp),
-    _isDoccRef(isDoccRef),
-    _doesTypedefSubstitutionForTemplates(doesTypedefSubstitutionForTemplates),
-    _failsOnMissingTypedefForTemplateSubstitution(failsOnMissingTypedefForTemplateSubstitution),
-    _failsOnInvalidNameForCodeGen(failsOnInvalidNameForCodeGen),
-    _usesBackticksOnSwiftReservedKeywords(usesBackticksOnSwiftReservedKeywords),
+    _language(language),
+    _namespaceSeparator("::"),
+    _isCppNameInCpp(false),
+    _isDoccRef(false),
+    _doesTypedefSubstitutionForTemplates(true),
+    _failsOnMissingTypedefForTemplateSubstitution(true),
+    _failsOnInvalidNameForCodeGen(true),
+    _usesBackticksOnSwiftReservedKeywords(false),
     _isCopy(isCopy)
     {
-        static std::set<TypeNamePrinterImpl, _InputOnlyComparator> _memoized;
-        if (!_memoized.contains(*this)) {
-            this->_run();
-            _memoized.insert(*this);
-        } else {
-            *this = *_memoized.find(*this);
+        switch (language) {
+            case TypeNameLanguage::swiftNameInSwift:
+                _namespaceSeparator = ".";
+                _usesBackticksOnSwiftReservedKeywords = true;
+                break;
+            case TypeNameLanguage::swiftNameInCpp:
+                break;
+            case TypeNameLanguage::doccRef:
+                _namespaceSeparator = "/";
+                _isDoccRef = true;
+                break;
+            case TypeNameLanguage::cppNameInCpp:
+                _isCppNameInCpp = true;
+                _doesTypedefSubstitutionForTemplates = false;
+                _failsOnMissingTypedefForTemplateSubstitution = false;
+                break;
+            case TypeNameLanguage::includePathsForSwiftNameInCpp:
+                _isCppNameInCpp = true;
+                break;
+        }
+    }
+    
+    static const TypeNameCache::Entry& _lookup(const Driver* driver, TypeNamePrinter::Type type, TypeNameLanguage language, bool isCopy) {
+        TypeNameCache& cache = TypeNameCache::shared();
+        if (const TypeNameCache::Entry* entry = cache.findName(driver, type, language, isCopy)) {
+            return *entry;
         }
+        TypeNamePrinterImpl impl(driver, type, language, isCopy);
+        impl._run();
+        return *cache.insertName(driver, type, language, isCopy, impl._result, std::move(impl._includePaths));
+    }
+    
+    static std::optional<std::string> _resultOpt(const TypeNameCache::Entry& entry) {
+        return entry.result ? std::optional<std::string>(*entry.result) : std::nullopt;
     }
     
-    TypeNamePrinterImpl copyWithType(TypeNamePrinter::Type newType) {
-        return TypeNamePrinterImpl(_driver,
-                                   newType,
-                                   _namespaceSeparator,
-                                   _isCppNameInCpp,
-                                   _isDoccRef,
-                                   _doesTypedefSubstitutionForTemplates,
-                                   _failsOnMissingTypedefForTemplateSubstitution,
-                                   _failsOnInvalidNameForCodeGen,
-                                   _usesBackticksOnSwiftReservedKeywords,
-                                   true /* isCopy */);
+    const TypeNameCache::Entry& copyWithType(TypeNamePrinter::Type newType) const {
+        return _lookup(_driver, newType, _language, true /* isCopy */);
     }
     
     bool _isNameComponentValidForCodeGen(const std::string& s) const {
@@ -520,12 +605,12 @@ private:
                     if (arg.getKind() == clang::TemplateArgument::Type) {
                         clang::QualType qualType = arg.getAsType();
                         
-                        TypeNamePrinterImpl recurse = this->copyWithType(qualType);
-                        if (recurse._result == std::nullopt) {
+                        const TypeNameCache::Entry& recurse = this->copyWithType(qualType);
+                        if (!recurse.result) {
                             return;
                         }
-                        _includePaths.merge(recurse._includePaths);
-                        toPushBack += *recurse._result;
+                        _includePaths.insert(recurse.includePaths.begin(), recurse.includePaths.end());
+                        toPushBack += *recurse.result;
                     } else {
                         // This template argument isn't a type, so it could be a template, a value, etc.
                         // Just have llvm print it for us.
@@ -766,12 +851,28 @@ std::optional<std::string> _featureFlagGuard(const Driver* driver, std::optional
 
 // Given this named decl, if I am going to print its type name, what is the feature flag guard I need?
 std::optional<std::string> TypeNamePrinter::getFeatureFlagGuard(const Driver* driver, TypeNamePrinter::Type type, std::string openFileSuffix) {
-    auto includePaths = includePathsForSwiftNameInCpp(driver, type);
-    return _featureFlagGuard(driver, type, std::vector(includePaths.begin(), includePaths.end()), openFileSuffix);
+    FeatureFlagGuardLanguage language = _featureFlagGuardLanguage(openFileSuffix);
+    if (language == FeatureFlagGuardLanguage::none) {
+        return std::nullopt;
+    }
+    
+    TypeNameCache& cache = TypeNameCache::shared();
+    const std::string* guard;
+    if (!cache.findGuard(driver, type, language, guard)) {
+        const std::set<std::string>& includePaths = includePathsForSwiftNameInCpp(driver, type);
+        std::string canonicalSuffix = language == FeatureFlagGuardLanguage::swift ? "swift" : "h";
+        guard = cache.insertGuard(driver, type, language, _featureFlagGuard(driver, type, std::vector(includePaths.begin(), includePaths.end()), canonicalSuffix));
+    }
+    return guard ? std::optional<std::string>(*guard) : std::nullopt;
 }
 
 std::optional<std::string> TypeNamePrinter::getFeatureFlagGuard(const Driver* driver, std::string includedHeader) {
-    return _featureFlagGuard(driver, std::nullopt, {includedHeader}, "h");
+    TypeNameCache& cache = TypeNameCache::shared();
+    const std::string* guard;
+    if (!cache.findGuard(includedHeader, guard)) {
+        guard = cache.insertGuard(includedHeader, _featureFlagGuard(driver, std::nullopt, {includedHeader}, "h"));
+    }
+    return guard ? std::optional<std::string>(*guard) : std::nullopt;
 }
 
 std::optional<std::string> SwiftNameInSwift::getTypeNameOpt(const Driver *driver, TypeNamePrinter::Type type) {
@@ -797,6 +898,6 @@ std::optional<std::string> DoccRef::getTypeNameOpt(const Driver *driver, TypeNam
     return TypeNamePrinterImpl::doccRef(driver, type);
 }
 
-std::set<std::string> TypeNamePrinter::includePathsForSwiftNameInCpp(const Driver *driver, TypeNamePrinter::Type type) {
+const std::set<std::string>& TypeNamePrinter::includePathsForSwiftNameInCpp(const Driver *driver, TypeNamePrinter::Type type) {
     return TypeNamePrinterImpl::includePathsForSwiftNameInCpp(driver, type);
 }
@@ -50,7 +50,7 @@ public:
     struct Type {
         Type(const clang::NamedDecl* namedDecl) : _impl(namedDecl) {
             if (namedDecl == nullptr) {
-                std::cout << "Cannot form TypeNamePrinter:Type from nullptr" << std::endl;
+                std::cerr << "Cannot form TypeNamePrinter:Type from nullptr" << std::endl;
                 __builtin_trap();
             }
         }
@@ -75,6 +75,11 @@ public:
             return std::get<clang::QualType>(_impl);
         }
         
+        // The decl or the QualType's opaque pointer, for hashing
+        const void* getOpaquePtr() const {
+            return isNamedDecl() ? (const void*)getNamedDecl() : getQualType().getAsOpaquePtr();
+        }
+        
         bool operator<(const Type& other) const{
             return _impl < other._impl;
         }
@@ -102,7 +107,7 @@ public:
     TypeNamePrinter& operator=(TypeNamePrinter&&) = delete;
     
 private:
-    static std::set<std::string> includePathsForSwiftNameInCpp(const Driver *driver, TypeNamePrinter::Type type);
+    static const std::set<std::string>& includePathsForSwiftNameInCpp(const Driver *driver, TypeNamePrinter::Type type);
     
     TypeNamePrinter(TypeNamePrinter::Type type, std::function<void()> onDtorIfUsedTypeName)
     : _type(type), _onDtorIfUsedTypeName(onDtorIfUsedTypeName) {}
@@ -277,9 +282,14 @@ protected:
         return _codeGenRunner;
     }
     // Writes a line into the currently open file, during `writeFooFile`
-    void writeLine(const std::string& line) {
+    void writeLine(std::string_view line) {
         _writer->addLine(line);
     }
+    // Formats a line straight into the currently open file, during `writeFooFile`
+    template <typename... Args>
+    void writeFormattedLine(std::format_string<Args...> format, Args&&... args) {
+        _writer->addFormattedLine(format, std::forward<Args>(args)...);
+    }
     // Writes lines into the currently open file, during `writeFooFile`
     void writeLines(const std::vector<std::string>& lines) {
         _writer->addLines(lines);
@@ -328,7 +338,7 @@ public:
         return TypeNamePrinter(type, [this, type]() {
             std::optional<std::string> guard = _featureFlagGuard(type, _writer->getOpenFileSuffix());
             if (guard && _typeNamePrinterGuardBlockerCounter == 0) {
-                const_cast<Derived*>(static_cast<const Derived*>(this))->writeLine("#endif // " + *guard);
+                const_cast<Derived*>(static_cast<const Derived*>(this))->writeFormattedLine("#endif // {}", *guard);
             }
         });
     }
@@ -433,7 +443,7 @@ private:
             }
             writeLine("#include \"" + f + "\"");
             if (guard) {
-                writeLine("#endif // " + *guard);
+                writeFormattedLine("#endif // {}", *guard);
             }
         }
         writeLine("");
@@ -545,13 +555,22 @@ private:
     void derivedCtorFinished() {
         const FileSystemInfo& fileSystemInfo = _codeGenRunner->getFileSystemInfo();
         _writer = std::make_unique<FileWriterHelper>(fileSystemInfo.getGeneratedCodeDirectory(), fileNamePrefix());
+        _writer->setBuffersOutput(_codeGenRunner->buffersOutput());
+        _writer->setManifest(_codeGenRunner->getGeneratedFileManifest());
+        const Telemetry* telemetry = _codeGenRunner->getDriver()->getTelemetry();
         
-        Data data = preprocess();
-        data = specialCaseFiltering(data);
-        data = extraSpecialCaseFiltering(data);
-        std::sort(data.begin(), data.end(), ASTHelpers::DeclComparator());
-        constDeduplicate(data);
+        Data data;
+        {
+            Telemetry::Measurement measurement(telemetry, fileNamePrefix(), "preprocess");
+            data = preprocess();
+            data = specialCaseFiltering(data);
+            data = extraSpecialCaseFiltering(data);
+            std::sort(data.begin(), data.end(), ASTHelpers::DeclComparator());
+            constDeduplicate(data);
+            measurement.setCounters({0, data.size()});
+        }
         
+        Telemetry::Measurement measurement(telemetry, fileNamePrefix(), "write");
         _isWritingFile = true;
         // For each of the possible `writeFooFile` methods,
         // we only want to do the preamble if the Derived class
@@ -625,6 +644,12 @@ public:
         result->derivedCtorFinished();
         return result;
     }
+    
+    // Writes the files a code gen kept in memory because its runner buffers output
+    template <typename T>
+    static void writeBufferedFiles(T* codeGen) {
+        codeGen->_writer->writeBufferedFiles();
+    }
 };
 
 #endif /* CodeGenBase_h */
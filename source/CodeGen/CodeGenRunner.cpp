@@ -32,33 +32,199 @@
 #include "CodeGen/ComparableCodeGen.h"
 #include "CodeGen/SendableCodeGen.h"
 #include "CodeGen/APINotesCodeGen.h"
+#include "Util/GeneratedFileManifest.h"
+#include "Util/ThreadPool.h"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+    // Set while a code gen runs on a thread pool, so its logs are buffered with its files
+    thread_local std::ostream* currentCodeGenLog = nullptr;
+}
 
 // MARK: Entry
 
 CodeGenRunner::~CodeGenRunner() {}
 
 CodeGenRunner::CodeGenRunner(const Driver* driver) :
-_driver(driver) {
+_driver(driver),
+_buffersOutput(driver->isParallelCodeGenEnabled()),
+_generatedFileManifest(std::make_unique<GeneratedFileManifest>(driver->getFileSystemInfo()->getGeneratedCodeManifestPath())) {
+    
+    // Code gens must be added after the code gens they follow
+    _addCodeGenIfRequested(_referenceTypeConformanceCodeGen, "ReferenceTypeConformance");
+    _addCodeGenIfRequested(_equatableCodeGen, "Equatable");
+    _addCodeGenIfRequested(_enumsCodeGen, "Enums");
+    _addCodeGenIfRequested(_staticTokensCodeGen, "StaticTokens");
+    _addCodeGenIfRequested(_tfNoticeProtocolCodeGen, "TfNoticeProtocol");
+    _addCodeGenIfRequested(_customStringConvertibleCodeGen, "CustomStringConvertible");
+    _addCodeGenIfRequested(_swiftSubclassCxxCodeGen, "SwiftSubclassCxx");
+    _addCodeGenIfRequested(_sdfValueTypeNamesMembersCodeGen, "SdfValueTypeNamesMembers");
+    _addCodeGenIfRequested(_schemaGetPrimCodeGen, "SchemaGetPrim");
+    _addCodeGenIfRequested(_hashableCodeGen, "Hashable");
+    _addCodeGenIfRequested(_comparableCodeGen, "Comparable");
+    _addCodeGenIfRequested(_sendableCodeGen, "Sendable");
+    _addCodeGenIfRequested(_apiNotesCodeGen, "APINotes");
+    
+    if (_buffersOutput) {
+        _runInParallel();
+    } else {
+        _runSequentially();
+    }
+    _jobs.clear();
+    
+    if (!_generatedFileManifest->write()) {
+        std::cerr << "Warning! Couldn't write " << driver->getFileSystemInfo()->getGeneratedCodeManifestPath().string() << std::endl;
+    }
+}
+
+template <typename T>
+void CodeGenRunner::_addCodeGenIfRequested(std::unique_ptr<T>& codeGen, const std::string& name) {
+    const std::set<std::string>* requested = _driver->getRequestedCodeGens();
+    if (requested && !requested->contains(name)) {
+        return;
+    }
+    std::unique_ptr<CodeGenJob> job = std::make_unique<CodeGenJob>();
+    job->name = name;
+    job->make = [this, &codeGen]() {
+        codeGen = CodeGenFactory::makeCodeGen<T>(this);
+    };
+    job->writeBufferedFiles = [&codeGen]() {
+        CodeGenFactory::writeBufferedFiles(codeGen.get());
+    };
+    _jobs.push_back(std::move(job));
+}
+
+void CodeGenRunner::_runSequentially() {
+    for (const auto& job : _jobs) {
+        job->make();
+    }
+}
+
+void CodeGenRunner::_runInParallel() {
+    // Code gens look decls up by name, and lazily deserializing them isn't thread-safe
+    getASTAnalysisRunner().ensureASTIsFullyDeserialized();
+    
+    // A code gen's wave is one more than the latest wave of any code gen it follows
+    std::map<std::string, uint64_t> waveIndices;
+    std::vector<std::vector<CodeGenJob*>> waves;
+    for (const auto& job : _jobs) {
+        const CodeGenRequirements& requirements = _getCodeGenRequirements().at(job->name);
+        std::vector<std::string> predecessors = requirements.codeGens;
+        predecessors.insert(predecessors.end(), requirements.runsAfter.begin(), requirements.runsAfter.end());
+        
+        uint64_t waveIndex = 0;
+        for (const std::string& predecessor : predecessors) {
+            const auto& it = waveIndices.find(predecessor);
+            if (it != waveIndices.end()) {
+                waveIndex = std::max(waveIndex, it->second + 1);
+            } else if (std::any_of(_jobs.begin(), _jobs.end(), [&predecessor](const auto& x) { return x->name == predecessor; })) {
+                std::cerr << "Error! Code gen " << job->name << " was added before " << predecessor << std::endl;
+                __builtin_trap();
+            }
+        }
+        
+        waveIndices.insert({job->name, waveIndex});
+        if (waves.size() <= waveIndex) {
+            waves.resize(waveIndex + 1);
+        }
+        waves[waveIndex].push_back(job.get());
+    }
+    
+    ThreadPool threadPool(ThreadPool::defaultThreadCount());
+    for (const auto& wave : waves) {
+        for (CodeGenJob* job : wave) {
+            threadPool.enqueue([job]() {
+                currentCodeGenLog = &job->log;
+                job->make();
+                currentCodeGenLog = nullptr;
+            });
+        }
+        threadPool.waitUntilIdle();
+    }
     
-    _referenceTypeConformanceCodeGen = CodeGenFactory::makeCodeGen<ReferenceTypeConformanceCodeGen>(this);
-    _equatableCodeGen = CodeGenFactory::makeCodeGen<EquatableCodeGen>(this);
-    _enumsCodeGen = CodeGenFactory::makeCodeGen<EnumsCodeGen>(this);
-    _staticTokensCodeGen = CodeGenFactory::makeCodeGen<StaticTokensCodeGen>(this);
-    _tfNoticeProtocolCodeGen = CodeGenFactory::makeCodeGen<TfNoticeProtocolCodeGen>(this);
-    _customStringConvertibleCodeGen = CodeGenFactory::makeCodeGen<CustomStringConvertibleCodeGen>(this);
-    _swiftSubclassCxxCodeGen = CodeGenFactory::makeCodeGen<SwiftSubclassCxxCodeGen>(this);
-    _sdfValueTypeNamesMembersCodeGen = CodeGenFactory::makeCodeGen<SdfValueTypeNamesMembersCodeGen>(this);
-    _schemaGetPrimCodeGen = CodeGenFactory::makeCodeGen<SchemaGetPrimCodeGen>(this);
-    _hashableCodeGen = CodeGenFactory::makeCodeGen<HashableCodeGen>(this);
-    _comparableCodeGen = CodeGenFactory::makeCodeGen<ComparableCodeGen>(this);
-    _sendableCodeGen = CodeGenFactory::makeCodeGen<SendableCodeGen>(this);
-    _apiNotesCodeGen = CodeGenFactory::makeCodeGen<APINotesCodeGen>(this);
+    // Code gens finish in any order, but their output is committed in the order they were added
+    for (const auto& job : _jobs) {
+        std::cout << job->log.str();
+        job->writeBufferedFiles();
+    }
+}
+
+// MARK: Pass selection
+const std::map<std::string, CodeGenRunner::CodeGenRequirements>& CodeGenRunner::_getCodeGenRequirements() {
+    // CodeGenBase reads Import and Typedef to print type names, so every code gen needs them.
+    // Keep this in sync with the passes each code gen reads from.
+    // ReferenceTypeConformance runs before every other code gen (see DOC.md)
+    static const std::map<std::string, CodeGenRequirements> result = {
+        {"ReferenceTypeConformance", {{}, {}, {}}},
+        {"Equatable", {{"Equatable"}, {}, {"ReferenceTypeConformance"}}},
+        {"Enums", {{"FindEnums"}, {}, {"ReferenceTypeConformance"}}},
+        {"StaticTokens", {{"FindStaticTokens"}, {}, {"ReferenceTypeConformance"}}},
+        {"TfNoticeProtocol", {{"FindTfNoticeSubclasses"}, {}, {"ReferenceTypeConformance"}}},
+        {"CustomStringConvertible", {{"CustomStringConvertible", "FindEnums"}, {"Enums"}, {"ReferenceTypeConformance"}}},
+        {"SwiftSubclassCxx", {{"SwiftSubclassCxx"}, {}, {"ReferenceTypeConformance"}}},
+        {"SdfValueTypeNamesMembers", {{"SdfValueTypeNamesMembers"}, {}, {"ReferenceTypeConformance"}}},
+        {"SchemaGetPrim", {{"FindSchemas"}, {}, {"ReferenceTypeConformance"}}},
+        {"Hashable", {{"Hashable"}, {}, {"ReferenceTypeConformance"}}},
+        {"Comparable", {{"Comparable"}, {}, {"ReferenceTypeConformance"}}},
+        {"Sendable", {{"Sendable"}, {}, {"ReferenceTypeConformance"}}},
+        {"APINotes", {{"APINotes", "PublicInheritance"}, {}, {"ReferenceTypeConformance"}}},
+    };
+    return result;
+}
+
+std::set<std::string> CodeGenRunner::getCodeGensNeededFor(const std::set<std::string>& codeGens) {
+    std::set<std::string> result;
+    std::vector<std::string> worklist(codeGens.begin(), codeGens.end());
+    while (!worklist.empty()) {
+        std::string name = worklist.back();
+        worklist.pop_back();
+        
+        const auto& it = _getCodeGenRequirements().find(name);
+        if (it == _getCodeGenRequirements().end()) {
+            std::cerr << "Error! No code gen named " << name << std::endl;
+            __builtin_trap();
+        }
+        if (result.insert(name).second) {
+            worklist.insert(worklist.end(), it->second.codeGens.begin(), it->second.codeGens.end());
+        }
+    }
+    return result;
+}
+
+std::set<std::string> CodeGenRunner::getAnalysisPassesNeededFor(const std::set<std::string>& codeGens) {
+    std::set<std::string> result;
+    if (!codeGens.empty()) {
+        result = {"Import", "Typedef"};
+    }
+    for (const std::string& name : codeGens) {
+        const auto& it = _getCodeGenRequirements().find(name);
+        if (it == _getCodeGenRequirements().end()) {
+            std::cerr << "Error! No code gen named " << name << std::endl;
+            __builtin_trap();
+        }
+        result.insert(it->second.analysisPasses.begin(), it->second.analysisPasses.end());
+    }
+    return result;
 }
 
 const Driver* CodeGenRunner::getDriver() const {
     return _driver;
 }
 
+// MARK: Output
+std::ostream& CodeGenRunner::log() {
+    return currentCodeGenLog ? *currentCodeGenLog : std::cout;
+}
+
+bool CodeGenRunner::buffersOutput() const {
+    return _buffersOutput;
+}
+
+GeneratedFileManifest* CodeGenRunner::getGeneratedFileManifest() const {
+    return _generatedFileManifest.get();
+}
+
 // MARK: Accessors
 const FileSystemInfo& CodeGenRunner::getFileSystemInfo() const {
     return getASTAnalysisRunner().getFileSystemInfo();
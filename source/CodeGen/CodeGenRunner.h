@@ -23,6 +23,12 @@
 
 #include "Driver/Driver.h"
 #include "AnalysisPass/ASTAnalysisRunner.h"
+#include <functional>
+#include <ostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
 
 class ReferenceTypeConformanceCodeGen;
 class EquatableCodeGen;
@@ -37,8 +43,12 @@ class HashableCodeGen;
 class ComparableCodeGen;
 class SendableCodeGen;
 class APINotesCodeGen;
+class GeneratedFileManifest;
 
-// Owns and coordinates running different code gen passes
+// Owns and coordinates running different code gen passes. By default code gens run sequentially.
+// With `--parallel-codegen`, code gens run in waves on a thread pool, where each wave only
+// follows code gens from earlier waves, and their files and logs are written afterwards
+// in the order the code gens were added
 class CodeGenRunner {
 public:
     // MARK: Entry
@@ -53,9 +63,49 @@ public:
     const ReferenceTypeConformanceCodeGen* getReferenceTypeConformanceCodeGen() const;
     const EnumsCodeGen* getEnumsCodeGen() const;
     
+    // MARK: Pass selection
+    // The named code gens and the code gens they read from. Code gens are named
+    // by their class name without `CodeGen`
+    static std::set<std::string> getCodeGensNeededFor(const std::set<std::string>& codeGens);
+    // The analysis passes that the named code gens read from, not counting their dependencies
+    static std::set<std::string> getAnalysisPassesNeededFor(const std::set<std::string>& codeGens);
+    
+    // MARK: Output
+    // Code gens log through this instead of std::cout, so that logs
+    // from code gens running in parallel don't interleave
+    static std::ostream& log();
+    // Whether code gens keep their files in memory until every code gen has finished
+    bool buffersOutput() const;
+    // Shared by every code gen's FileWriterHelper, and saved once every code gen has finished
+    GeneratedFileManifest* getGeneratedFileManifest() const;
+    
+private:
+    struct CodeGenRequirements {
+        std::vector<std::string> analysisPasses;
+        std::vector<std::string> codeGens;
+        // Code gens that have to finish first if they're running, but aren't otherwise needed
+        std::vector<std::string> runsAfter;
+    };
+    static const std::map<std::string, CodeGenRequirements>& _getCodeGenRequirements();
+    
+    struct CodeGenJob {
+        std::string name;
+        std::function<void()> make;
+        std::function<void()> writeBufferedFiles;
+        std::ostringstream log;
+    };
+    
+    template <typename T>
+    void _addCodeGenIfRequested(std::unique_ptr<T>& codeGen, const std::string& name);
+    void _runSequentially();
+    void _runInParallel();
+    
 private:
     // MARK: Fields
     const Driver* _driver;
+    std::vector<std::unique_ptr<CodeGenJob>> _jobs;
+    bool _buffersOutput;
+    std::unique_ptr<GeneratedFileManifest> _generatedFileManifest;
     
     std::unique_ptr<ReferenceTypeConformanceCodeGen> _referenceTypeConformanceCodeGen;
     std::unique_ptr<EquatableCodeGen> _equatableCodeGen;
@@ -105,7 +105,8 @@ void ReferenceTypeConformanceCodeGen::writeHeaderFile(const ReferenceTypeConform
         // TfRefPtr<TfRefBase> is disallowed
         
         if (!isTfRefBaseSubclass(tagDecl) && !isTfWeakBaseSubclass(tagDecl) && !isTfSingletonImmortalSpecialization(tagDecl)) {
-            std::cout << ASTHelpers::getAsString(tagDecl) << std::endl;
+            // Not through CodeGenRunner::log(), which is only written out once every code gen finishes
+            std::cerr << "Error! Unexpected reference type " << ASTHelpers::getAsString(tagDecl) << std::endl;
             __builtin_trap();
         }
         
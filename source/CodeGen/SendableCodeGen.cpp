@@ -36,7 +36,7 @@ SendableCodeGen::Data SendableCodeGen::preprocess() {
     for (const auto& it : getSendableAnalysisPass()->getData()) {
         i += 1;
         if (i % 10000 == 0) {
-            std::cout << "SendableCodeGen::preprocess(): " << i << " of " << getSendableAnalysisPass()->getData().size() << std::endl;
+            CodeGenRunner::log() << "SendableCodeGen::preprocess(): " << i << " of " << getSendableAnalysisPass()->getData().size() << std::endl;
         }
         
         if (importAnalysisPass->find(it.first) == importAnalysisPass->end() || !importAnalysisPass->find(it.first)->second.isImportedSomehow()) {
@@ -51,7 +51,7 @@ SendableCodeGen::Data SendableCodeGen::preprocess() {
             result.push_back(itFirst);
         }
     }
-    std::cout << "SendableCodeGen::preprocess(): Done (" << result.size() << " types returned)" << std::endl;
+    CodeGenRunner::log() << "SendableCodeGen::preprocess(): Done (" << result.size() << " types returned)" << std::endl;
     
     return result;
 }
@@ -152,7 +152,7 @@ SendableCodeGen::Data SendableCodeGen::extraSpecialCaseFiltering(const Data& dat
         result.push_back(it);
     }
     
-    std::cout << "SendableCodeGen::extraSpecialCaseFiltering: " << data.size() << " -> " << result.size() << std::endl;
+    CodeGenRunner::log() << "SendableCodeGen::extraSpecialCaseFiltering: " << data.size() << " -> " << result.size() << std::endl;
     return result;
 }
 
@@ -46,7 +46,7 @@ std::string externConstName(std::string swiftNameInCpp) {
     } else if (swiftNameInCpp.ends_with("_StaticTokenType")) {
         suffix = "_StaticTokenType";
     } else {
-        std::cout << "Error! Unexpected static token type name '" << swiftNameInCpp << std::endl;
+        std::cerr << "Error! Unexpected static token type name '" << swiftNameInCpp << std::endl;
         __builtin_trap();
     }
     
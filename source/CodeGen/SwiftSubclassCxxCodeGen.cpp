@@ -140,7 +140,7 @@ struct TypesHelper {
         clang::QualType orig = q;
         q = ASTHelpers::removingRefConst(q);
         if (orig == q) { return orig; }
-        return f->getASTContext().getPointerType(q.withConst());
+        return ASTHelpers::getPointerType(f->getASTContext(), q.withConst());
     }
     
     
@@ -212,7 +212,7 @@ public:
         q = removingValueTypeIndirectionIfPossible(q, codeGen);
         // Swift allocates an UnsafeMutablePointer to the value, regardless of its kind of value type indirection
         q.removeLocalConst();
-        q = method->getASTContext().getPointerType(q);
+        q = ASTHelpers::getPointerType(method->getASTContext(), q);
         return q;
     }
     
@@ -25,18 +25,76 @@
 #include "AnalysisPass/ASTAnalysisRunner.h"
 #include "CodeGen/CodeGenRunner.h"
 #include "Util/Graph.h"
+#include "Util/Telemetry.h"
+#include <algorithm>
+#include <string_view>
 
-Driver::Driver(int argc, const char** argv) {
+// Splits the comma-separated list after `prefix` in `arg` into `result`.
+// Returns false if `arg` doesn't start with `prefix`
+static bool parseListArgument(std::string_view arg, std::string_view prefix, std::optional<std::set<std::string>>& result) {
+    if (!arg.starts_with(prefix)) {
+        return false;
+    }
+    if (!result) {
+        result = std::set<std::string>();
+    }
+    arg.remove_prefix(prefix.size());
+    while (!arg.empty()) {
+        uint64_t comma = std::min(arg.find(','), arg.size());
+        if (comma > 0) {
+            result->insert(std::string(arg.substr(0, comma)));
+        }
+        arg.remove_prefix(std::min(comma + 1, arg.size()));
+    }
+    return true;
+}
+
+Driver::Driver(int argc, const char** argv) :
+    _isIncrementalAnalysisEnabled(false),
+    _isShardedASTBuildEnabled(false),
+    _isParallelCodeGenEnabled(false)
+{
     testDirectedGraph();
     
+    for (int i = 1; i < argc; i++) {
+        if (std::string_view(argv[i]) == "--incremental") {
+            _isIncrementalAnalysisEnabled = true;
+        }
+        if (std::string_view(argv[i]) == "--sharded-ast") {
+            _isShardedASTBuildEnabled = true;
+        }
+        if (std::string_view(argv[i]) == "--parallel-codegen") {
+            _isParallelCodeGenEnabled = true;
+        }
+        parseListArgument(argv[i], "--codegen=", _requestedCodeGens);
+        parseListArgument(argv[i], "--analysis=", _requestedAnalysisPasses);
+    }
+    
+    // Asking for some outputs means not running anything else
+    if (_requestedCodeGens || _requestedAnalysisPasses) {
+        _requestedCodeGens = CodeGenRunner::getCodeGensNeededFor(_requestedCodeGens.value_or(std::set<std::string>()));
+        std::set<std::string> analysisPasses = CodeGenRunner::getAnalysisPassesNeededFor(*_requestedCodeGens);
+        if (_requestedAnalysisPasses) {
+            analysisPasses.insert(_requestedAnalysisPasses->begin(), _requestedAnalysisPasses->end());
+        }
+        _requestedAnalysisPasses = analysisPasses;
+    }
+    
+    _telemetry = std::make_unique<Telemetry>();
     _fileSystemInfo = std::make_unique<FileSystemInfo>(this);
     _cmakeParser = std::make_unique<CMakeParser>(this);
-    _clangToolHelper = std::make_unique<ClangToolHelper>(this, argc, argv);
+    {
+        Telemetry::Measurement measurement(_telemetry.get(), "ClangToolHelper", "load");
+        _clangToolHelper = std::make_unique<ClangToolHelper>(this, argc, argv);
+    }
     if (!_clangToolHelper->operator bool()) {
         __builtin_trap();
     }
     _astAnalysisRunner = std::make_unique<ASTAnalysisRunner>(this);
     _codeGenRunner = std::make_unique<CodeGenRunner>(this);
+    
+    _telemetry->writeJSON(_fileSystemInfo->getTelemetryReportPath());
+    _telemetry->printSummary();
 }
 
 Driver::~Driver() {
@@ -60,4 +118,22 @@ const ASTAnalysisRunner* Driver::getASTAnalysisRunner() const {
 const CodeGenRunner* Driver::getCodeGenRunner() const {
     return _codeGenRunner.get();
 }
+const Telemetry* Driver::getTelemetry() const {
+    return _telemetry.get();
+}
+bool Driver::isIncrementalAnalysisEnabled() const {
+    return _isIncrementalAnalysisEnabled;
+}
+bool Driver::isShardedASTBuildEnabled() const {
+    return _isShardedASTBuildEnabled;
+}
+bool Driver::isParallelCodeGenEnabled() const {
+    return _isParallelCodeGenEnabled;
+}
+const std::set<std::string>* Driver::getRequestedCodeGens() const {
+    return _requestedCodeGens ? &*_requestedCodeGens : nullptr;
+}
+const std::set<std::string>* Driver::getRequestedAnalysisPasses() const {
+    return _requestedAnalysisPasses ? &*_requestedAnalysisPasses : nullptr;
+}
 
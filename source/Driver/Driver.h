@@ -22,12 +22,16 @@
 #define Driver_h
 
 #include <memory>
+#include <optional>
+#include <set>
+#include <string>
 
 struct FileSystemInfo;
 class CMakeParser;
 class ClangToolHelper;
 class ASTAnalysisRunner;
 class CodeGenRunner;
+class Telemetry;
 
 // Driver is the overall coordinator for the project. It gets passed around
 // as needed, and owns and runs different phases of the project.
@@ -42,14 +46,39 @@ public:
     const ClangToolHelper* getClangToolHelper() const;
     const ASTAnalysisRunner* getASTAnalysisRunner() const;
     const CodeGenRunner* getCodeGenRunner() const;
+    const Telemetry* getTelemetry() const;
+    
+    // Passing `--incremental` keeps analysis results across rebuilds of the serialized AST,
+    // and only recomputes results whose inputs changed (see ASTAnalysisIncrementalRecord)
+    bool isIncrementalAnalysisEnabled() const;
+    
+    // Passing `--sharded-ast` builds one AST per OpenUSD library in parallel,
+    // instead of one AST for all of OpenUSD (see ClangToolHelper)
+    bool isShardedASTBuildEnabled() const;
+    
+    // Passing `--parallel-codegen` runs independent code gens on a thread pool,
+    // and writes their files once they've all finished (see CodeGenRunner)
+    bool isParallelCodeGenEnabled() const;
+    
+    // Passing `--codegen=Enums,StaticTokens` and/or `--analysis=Sendable` only runs
+    // the named code gens and analysis passes, and everything they need. Names are class names
+    // without the `CodeGen`/`AnalysisPass` suffix. These return nullptr when everything runs
+    const std::set<std::string>* getRequestedCodeGens() const;
+    const std::set<std::string>* getRequestedAnalysisPasses() const;
     
 private:
     // MARK: Fields
+    std::unique_ptr<Telemetry> _telemetry;
     std::unique_ptr<FileSystemInfo> _fileSystemInfo;
     std::unique_ptr<CMakeParser> _cmakeParser;
     std::unique_ptr<ClangToolHelper> _clangToolHelper;
     std::unique_ptr<ASTAnalysisRunner> _astAnalysisRunner;
     std::unique_ptr<CodeGenRunner> _codeGenRunner;
+    bool _isIncrementalAnalysisEnabled;
+    bool _isShardedASTBuildEnabled;
+    bool _isParallelCodeGenEnabled;
+    std::optional<std::set<std::string>> _requestedCodeGens;
+    std::optional<std::set<std::string>> _requestedAnalysisPasses;
 
 };
 
@@ -19,10 +19,24 @@
 //===----------------------------------------------------------------------===//
 
 #include "Driver/Driver.h"
+#include "Util/CMakeParser.h"
+#include "Util/Graph.h"
+#include "Util/TestDataLoader.h"
 #include <iostream>
 #include <chrono>
+#include <string_view>
 
 int main(int argc, const char **argv) {
+    if (argc > 1 && std::string_view(argv[1]) == "--benchmark") {
+        benchmarkDirectedGraph();
+        TestDataLoader::benchmarkReader(std::filesystem::path(AST_ANSWERER_REPO_PATH) / "resources");
+        // `--benchmark <path to OpenUSD>` also benchmarks tokenizing its CMake files
+        if (argc > 2) {
+            CMakeParser::benchmarkTokenizer(argv[2]);
+        }
+        return 0;
+    }
+    
     const auto start{std::chrono::steady_clock::now()};
     
     {
@@ -0,0 +1,144 @@
+//===----------------------------------------------------------------------===//
+// This source file is part of github.com/apple/SwiftUsd-ast-answerer
+//
+// Copyright © 2025 Apple Inc. and the SwiftUsd-ast-answerer project authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//===----------------------------------------------------------------------===//
+
+#include "Util/BinaryAnalysisCache.h"
+#include <cstring>
+#include <fstream>
+
+/* static */
+bool BinaryAnalysisCache::write(const std::filesystem::path& path, uint64_t astFingerprint, SourceStamp sourceStamp, ValueFormat valueFormat, const std::vector<std::pair<uint64_t, std::string>>& records) {
+    std::vector<FileRecord> fileRecords;
+    fileRecords.reserve(records.size());
+    std::string stringTable;
+    for (const auto& [key, value] : records) {
+        if (stringTable.size() + value.size() > UINT32_MAX) {
+            return false;
+        }
+        fileRecords.push_back({key, (uint32_t) stringTable.size(), (uint32_t) value.size()});
+        stringTable += value;
+    }
+    
+    FileHeader header;
+    std::memcpy(header.magic, _magic, sizeof(_magic));
+    header.version = _version;
+    header.recordCount = (uint32_t) fileRecords.size();
+    header.astFingerprint = astFingerprint;
+    header.sourceStamp = sourceStamp;
+    header.valueFormat = (uint32_t) valueFormat;
+    header.padding = 0;
+    header.stringTableSize = stringTable.size();
+    
+    // Write to a temporary file and rename it into place,
+    // so a crash can't leave behind a truncated cache
+    std::filesystem::create_directories(path.parent_path());
+    std::filesystem::path tempPath = path;
+    tempPath += ".tmp";
+    {
+        std::ofstream stream(tempPath, std::ios::binary | std::ios::trunc);
+        stream.write((const char*) &header, sizeof(header));
+        stream.write((const char*) fileRecords.data(), fileRecords.size() * sizeof(FileRecord));
+        stream.write(stringTable.data(), stringTable.size());
+        if (!stream) {
+            return false;
+        }
+    }
+    
+    std::error_code errorCode;
+    std::filesystem::rename(tempPath, path, errorCode);
+    return !errorCode;
+}
+
+/* static */
+std::unique_ptr<BinaryAnalysisCache> BinaryAnalysisCache::load(const std::filesystem::path& path, uint64_t astFingerprint, SourceStamp sourceStamp, ValueFormat valueFormat) {
+    if (!std::filesystem::exists(path)) {
+        return nullptr;
+    }
+    
+    // MemoryBuffer maps the file rather than reading it, when it's large enough to be worthwhile
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> buffer = llvm::MemoryBuffer::getFile(path.string(),
+                                                                                           /*IsText*/ false,
+                                                                                           /*RequiresNullTerminator*/ false);
+    if (!buffer) {
+        return nullptr;
+    }
+    
+    uint64_t bufferSize = (*buffer)->getBufferSize();
+    if (bufferSize < sizeof(FileHeader)) {
+        return nullptr;
+    }
+    FileHeader header;
+    std::memcpy(&header, (*buffer)->getBufferStart(), sizeof(header));
+    if (std::memcmp(header.magic, _magic, sizeof(_magic)) != 0 ||
+        header.version != _version ||
+        header.astFingerprint != astFingerprint ||
+        header.sourceStamp != sourceStamp ||
+        header.valueFormat != (uint32_t) valueFormat ||
+        bufferSize != sizeof(FileHeader) + (uint64_t) header.recordCount * sizeof(FileRecord) + header.stringTableSize) {
+        return nullptr;
+    }
+    
+    // Check every record up front, so operator[] never has to
+    const char* recordStart = (*buffer)->getBufferStart() + sizeof(FileHeader);
+    for (uint64_t i = 0; i < header.recordCount; i++) {
+        FileRecord fileRecord;
+        std::memcpy(&fileRecord, recordStart + i * sizeof(FileRecord), sizeof(fileRecord));
+        if ((uint64_t) fileRecord.valueOffset + fileRecord.valueLength > header.stringTableSize) {
+            return nullptr;
+        }
+    }
+    
+    return std::unique_ptr<BinaryAnalysisCache>(new BinaryAnalysisCache(std::move(*buffer)));
+}
+
+/* static */
+BinaryAnalysisCache::SourceStamp BinaryAnalysisCache::stampFile(const std::filesystem::path& path) {
+    std::error_code errorCode;
+    uint64_t size = std::filesystem::file_size(path, errorCode);
+    if (errorCode) {
+        return {0, 0};
+    }
+    std::filesystem::file_time_type modificationTime = std::filesystem::last_write_time(path, errorCode);
+    if (errorCode) {
+        return {0, 0};
+    }
+    // Don't let an empty file look like a missing one
+    return {size, (int64_t) modificationTime.time_since_epoch().count() | 1};
+}
+
+BinaryAnalysisCache::BinaryAnalysisCache(std::unique_ptr<llvm::MemoryBuffer> buffer) :
+    _buffer(std::move(buffer))
+{
+    // Fix up pointers into the mapping. FileHeader and FileRecord are both
+    // 8-byte aligned, and MemoryBuffer's storage is page or malloc aligned
+    const char* start = _buffer->getBufferStart();
+    const FileHeader* header = (const FileHeader*) start;
+    _recordCount = header->recordCount;
+    _records = (const FileRecord*) (start + sizeof(FileHeader));
+    _stringTable = start + sizeof(FileHeader) + _recordCount * sizeof(FileRecord);
+}
+
+uint64_t BinaryAnalysisCache::size() const {
+    return _recordCount;
+}
+
+BinaryAnalysisCache::Record BinaryAnalysisCache::operator[](uint64_t i) const {
+    const FileRecord& fileRecord = _records[i];
+    return {fileRecord.key, std::string_view(_stringTable + fileRecord.valueOffset, fileRecord.valueLength)};
+}
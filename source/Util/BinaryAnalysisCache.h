@@ -0,0 +1,102 @@
+//===----------------------------------------------------------------------===//
+// This source file is part of github.com/apple/SwiftUsd-ast-answerer
+//
+// Copyright © 2025 Apple Inc. and the SwiftUsd-ast-answerer project authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//===----------------------------------------------------------------------===//
+
+#ifndef BinaryAnalysisCache_h
+#define BinaryAnalysisCache_h
+
+#include <llvm/Support/MemoryBuffer.h>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A binary file of (key, value) records, used to cache analysis results between runs
+// without re-parsing text. The file is a header, an array of fixed-width records,
+// and a string table holding every value. Loading maps the file into memory,
+// and values are views into the mapping, so nothing is copied or parsed up front.
+//
+// Keys are only meaningful for a particular serialized AST, so every cache records
+// the fingerprint of the AST it was written for, and is ignored if that fingerprint changes.
+// A cache of a file that's meant to be edited or deleted by hand also records
+// that file's size and modification time (see stampFile()), and is ignored if either changes
+class BinaryAnalysisCache {
+public:
+    struct Record {
+        uint64_t key;
+        std::string_view value;
+    };
+    
+    // How values are encoded, so a cache isn't read back with a different encoding
+    enum class ValueFormat : uint32_t {
+        text = 1,
+        binary = 2,
+    };
+    
+    // Identifies a version of a file without reading it. All zeros if it doesn't exist
+    struct SourceStamp {
+        uint64_t size;
+        int64_t modificationTime;
+        
+        bool exists() const { return size != 0 || modificationTime != 0; }
+        bool operator==(const SourceStamp&) const = default;
+    };
+    
+    // Returns false if the file couldn't be written
+    static bool write(const std::filesystem::path& path, uint64_t astFingerprint, SourceStamp sourceStamp, ValueFormat valueFormat, const std::vector<std::pair<uint64_t, std::string>>& records);
+    // Returns nullptr if the file doesn't exist, is malformed, or was written for a different AST, source stamp, or value format
+    static std::unique_ptr<BinaryAnalysisCache> load(const std::filesystem::path& path, uint64_t astFingerprint, SourceStamp sourceStamp, ValueFormat valueFormat);
+    
+    static SourceStamp stampFile(const std::filesystem::path& path);
+    
+    uint64_t size() const;
+    Record operator[](uint64_t i) const;
+    
+private:
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t recordCount;
+        uint64_t astFingerprint;
+        SourceStamp sourceStamp;
+        uint32_t valueFormat;
+        uint32_t padding;
+        uint64_t stringTableSize;
+    };
+    
+    struct FileRecord {
+        uint64_t key;
+        uint32_t valueOffset;
+        uint32_t valueLength;
+    };
+    
+    static constexpr char _magic[8] = {'A', 'S', 'T', 'A', 'C', 'A', 'C', 'H'};
+    static constexpr uint32_t _version = 3;
+    
+    BinaryAnalysisCache(std::unique_ptr<llvm::MemoryBuffer> buffer);
+    
+    std::unique_ptr<llvm::MemoryBuffer> _buffer;
+    const FileRecord* _records;
+    const char* _stringTable;
+    uint64_t _recordCount;
+};
+
+#endif /* BinaryAnalysisCache_h */
@@ -21,7 +21,11 @@
 #include "Util/CMakeParser.h"
 #include "Util/TestDataLoader.h"
 #include "Util/FileSystemInfo.h"
+#include "Util/Telemetry.h"
+#include "Util/ThreadPool.h"
 
+#include <llvm/Support/xxhash.h>
+#include <chrono>
 #include <iostream>
 #include <fstream>
 #include <regex>
@@ -41,7 +45,10 @@
 CMakeParser::CMakeParser(const Driver* driver) :
 _driver(driver) {
     std::cout << "CMakeParser starting..." << std::endl;
+    loadManifest();
     process(driver->getFileSystemInfo()->usdSourceRepoPath);
+    writeManifest();
+    buildUsdFileIndex();
     test();
     serialize();
 }
@@ -89,6 +96,54 @@ std::vector<std::filesystem::path> CMakeParser::getListOfPublicHeaders() const {
     return result;
 }
 
+std::vector<std::pair<std::string, std::vector<std::filesystem::path>>> CMakeParser::getSourceFilesByPxrLibrary() const {
+    std::vector<std::pair<std::string, std::vector<std::filesystem::path>>> result;
+    for (const auto& lib : _pxrLibraries) {
+        // Workaround: swiftUsd shouldn't be exposed to analysis or code gen
+        if (lib.libraryName == "swiftUsd") {
+            continue;
+        }
+        
+        result.push_back({lib.libraryName, lib.sourceFiles});
+    }
+    return result;
+}
+
+const CMakeParser::UsdFileInfo* CMakeParser::getUsdFileInfo(std::string_view path) const {
+    auto it = _usdFileIndex.find(path);
+    return it == _usdFileIndex.end() ? nullptr : &it->second;
+}
+
+void CMakeParser::buildUsdFileIndex() {
+    std::string usdSourceRepoPath = _driver->getFileSystemInfo()->usdSourceRepoPath.string();
+    auto add = [&](const PxrLibrary& lib, const std::filesystem::path& p, bool isPublic) {
+        std::string path = p.string();
+        std::string includePath = path.starts_with(usdSourceRepoPath) ? path.substr(usdSourceRepoPath.size() + 1) : "";
+        _usdFileIndex.try_emplace(path, UsdFileInfo{lib.libraryName, isPublic, includePath});
+    };
+    
+    for (const auto& lib : _pxrLibraries) {
+        // Workaround: swiftUsd shouldn't be exposed to analysis or code gen
+        if (lib.libraryName == "swiftUsd") {
+            continue;
+        }
+        
+        // Public headers first, so they win over a source file with the same path
+        for (const auto& p : lib.publicHeaders) {
+            add(lib, p, true);
+        }
+    }
+    for (const auto& lib : _pxrLibraries) {
+        if (lib.libraryName == "swiftUsd") {
+            continue;
+        }
+        
+        for (const auto& p : lib.sourceFiles) {
+            add(lib, p, false);
+        }
+    }
+}
+
 std::vector<std::string> CMakeParser::getNamesOfPxrLibraries() const {
     std::vector<std::string> result;
     for (const auto& lib : _pxrLibraries) {
@@ -166,36 +221,223 @@ void CMakeParser::serialize() const {
     stream.close();
 }
 
-void CMakeParser::process(const std::filesystem::path &dir) {
+void CMakeParser::process(const std::filesystem::path &root) {
+    // Every CMakeLists.txt is interpreted independently, so interpret each level of
+    // add_subdirectory() at once on a thread pool, and then assemble the libraries
+    // in the same depth-first order as walking the directories one at a time
+    std::map<std::filesystem::path, InterpretedCMakeLists> interpretedByDir;
+    // Only files that are still part of the build carry over to the next run
+    std::map<std::string, ManifestEntry> manifest;
+    uint64_t nReparsed = 0;
+    Telemetry::Measurement measurement(_driver->getTelemetry(), "CMakeParser", "interpret");
+    auto start = std::chrono::steady_clock::now();
+    
+    ThreadPool threadPool(ThreadPool::defaultThreadCount());
+    std::vector<std::filesystem::path> dirs = {root};
+    while (!dirs.empty()) {
+        std::vector<ManifestEntry> entries(dirs.size());
+        std::vector<char> wasReparsed(dirs.size());
+        for (uint64_t i = 0; i < dirs.size(); i++) {
+            threadPool.enqueue([this, &dirs, &entries, &wasReparsed, i]() {
+                bool entryWasReparsed;
+                entries[i] = interpretCMakeLists(dirs[i], &entryWasReparsed);
+                wasReparsed[i] = entryWasReparsed;
+            });
+        }
+        threadPool.waitUntilIdle();
+        
+        std::vector<std::filesystem::path> nextDirs;
+        for (uint64_t i = 0; i < dirs.size(); i++) {
+            nReparsed += wasReparsed[i];
+            for (const auto& subDir : entries[i].interpreted.addedSubdirectories) {
+                nextDirs.push_back(dirs[i] / subDir);
+            }
+            interpretedByDir.insert_or_assign(dirs[i], entries[i].interpreted);
+            manifest.insert_or_assign((dirs[i] / "CMakeLists.txt").string(), std::move(entries[i]));
+        }
+        dirs = std::move(nextDirs);
+    }
+    _manifest = std::move(manifest);
+    measurement.setCacheHit(nReparsed == 0);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "CMakeParser re-parsed " << nReparsed << " of " << interpretedByDir.size() << " CMakeLists.txt files";
+    std::cout << " in " << elapsed.count() << "s" << std::endl;
+    
+    std::function<void(const std::filesystem::path&)> addLibraries = [&](const std::filesystem::path& dir) {
+        const InterpretedCMakeLists& interpreted = interpretedByDir.find(dir)->second;
+        for (const auto& p : interpreted.pxrLibraryArguments) {
+            _pxrLibraries.push_back(PxrLibrary(dir, p));
+        }
+        for (const auto& subDir : interpreted.addedSubdirectories) {
+            addLibraries(dir / subDir);
+        }
+    };
+    addLibraries(root);
+}
+
+CMakeParser::ManifestEntry CMakeParser::interpretCMakeLists(const std::filesystem::path& dir, bool* outWasReparsed) const {
     std::filesystem::path cmakeLists = dir / "CMakeLists.txt";
     if (CMAKEPARSER_CMAKEDRIVER_DEBUGPRINT) {
         std::cout << "CMAKEDRIVER: PROCESSING " << dir.string() << std::endl;
     }
     
-    if (!std::filesystem::exists(cmakeLists)) {
+    std::error_code errorCode;
+    std::filesystem::file_time_type time = std::filesystem::last_write_time(cmakeLists, errorCode);
+    if (errorCode) {
         std::cerr << "Can't process " << cmakeLists << std::endl;
         __builtin_trap();
     }
+    int64_t modificationTime = (int64_t) time.time_since_epoch().count();
+    
+    // Trust the file's modification time, and fall back to its contents
+    // if it was touched without changing
+    const auto& it = _manifest.find(cmakeLists.string());
+    if (it != _manifest.end() && it->second.modificationTime == modificationTime) {
+        *outWasReparsed = false;
+        return it->second;
+    }
+    
     std::stringstream ss;
     ss << std::ifstream(cmakeLists).rdbuf();
     std::string s = ss.str();
+    uint64_t hash = llvm::xxh3_64bits(llvm::StringRef(s));
+    if (it != _manifest.end() && it->second.hash == hash) {
+        *outWasReparsed = false;
+        return ManifestEntry{modificationTime, hash, it->second.interpreted};
+    }
     
-    std::vector<Tokenizer::Token> tokens = Tokenizer::tokenize(s);
-    std::vector<CommandInvocationBuilder::CommandInvocation> commands = CommandInvocationBuilder::build(tokens);
+    // The commands and blocks view the token stream, which views `s`
+    Tokenizer::TokenStream tokenStream = Tokenizer::tokenize(s);
+    std::vector<CommandInvocationBuilder::CommandInvocation> commands = CommandInvocationBuilder::build(tokenStream.tokens);
     BlockBuilder::Block block = BlockBuilder::buildBlock(commands);
     Interpreter interpreter;
     interpreter.interpretBlock(block);
-    for (const auto& p : interpreter.pxrLibraries) {
-        _pxrLibraries.push_back(PxrLibrary(dir, p));
+    
+    *outWasReparsed = true;
+    return ManifestEntry{modificationTime, hash, {interpreter.pxrLibraries, interpreter.addedSubdirectories}};
+}
+
+// The manifest is a version line, and then for each CMakeLists.txt:
+//     cmakeLists <modificationTime> <hash> <path>
+//     pxr_library <argument count>
+//     <argument length> <argument>        (once per argument)
+//     add_subdirectory <length> <subdirectory>
+// with any number of pxr_library and add_subdirectory records.
+// Arguments are length-prefixed because they may contain any character
+static constexpr std::string_view cmakeParserManifestVersion = "CMakeParser manifest 1";
+
+static bool readLengthPrefixed(std::istream& stream, std::string& out) {
+    uint64_t length;
+    if (!(stream >> length) || stream.get() != ' ') {
+        return false;
+    }
+    out.resize(length);
+    return (bool) stream.read(out.data(), length);
+}
+
+void CMakeParser::loadManifest() {
+    std::ifstream stream(_driver->getFileSystemInfo()->getCMakeParserManifestPath());
+    std::string line;
+    if (!std::getline(stream, line) || line != cmakeParserManifestVersion) {
+        // Missing or from a different version, so parse everything
+        return;
+    }
+    
+    std::map<std::string, ManifestEntry> manifest;
+    ManifestEntry* current = nullptr;
+    std::string keyword;
+    while (stream >> keyword) {
+        if (keyword == "cmakeLists") {
+            ManifestEntry entry;
+            std::string path;
+            if (!(stream >> entry.modificationTime >> std::hex >> entry.hash >> std::dec) || stream.get() != ' ' || !std::getline(stream, path)) {
+                break;
+            }
+            current = &manifest.insert_or_assign(path, entry).first->second;
+            
+        } else if (keyword == "pxr_library" && current) {
+            uint64_t nArguments;
+            if (!(stream >> nArguments)) {
+                break;
+            }
+            std::vector<std::string> arguments(nArguments);
+            for (auto& argument : arguments) {
+                if (!readLengthPrefixed(stream, argument)) {
+                    std::cerr << "Warning! Ignoring malformed CMakeParser manifest" << std::endl;
+                    return;
+                }
+            }
+            current->interpreted.pxrLibraryArguments.push_back(std::move(arguments));
+            
+        } else if (keyword == "add_subdirectory" && current) {
+            std::string subDir;
+            if (!readLengthPrefixed(stream, subDir)) {
+                break;
+            }
+            current->interpreted.addedSubdirectories.push_back(std::move(subDir));
+            
+        } else {
+            break;
+        }
+    }
+    
+    if (!stream.eof()) {
+        std::cerr << "Warning! Ignoring malformed CMakeParser manifest" << std::endl;
+        return;
+    }
+    _manifest = std::move(manifest);
+}
+
+void CMakeParser::writeManifest() const {
+    std::filesystem::path path = _driver->getFileSystemInfo()->getCMakeParserManifestPath();
+    std::filesystem::create_directories(path.parent_path());
+    std::filesystem::path tempPath = path;
+    tempPath += ".tmp";
+    {
+        std::ofstream stream(tempPath, std::ios::trunc);
+        stream << cmakeParserManifestVersion << "\n";
+        for (const auto& [cmakeLists, entry] : _manifest) {
+            stream << "cmakeLists " << entry.modificationTime << " " << std::hex << entry.hash << std::dec << " " << cmakeLists << "\n";
+            for (const auto& arguments : entry.interpreted.pxrLibraryArguments) {
+                stream << "pxr_library " << arguments.size() << "\n";
+                for (const auto& argument : arguments) {
+                    stream << argument.size() << " " << argument << "\n";
+                }
+            }
+            for (const auto& subDir : entry.interpreted.addedSubdirectories) {
+                stream << "add_subdirectory " << subDir.size() << " " << subDir << "\n";
+            }
+        }
+        if (!stream) {
+            std::cerr << "Warning! Couldn't write the CMakeParser manifest" << std::endl;
+            return;
+        }
     }
     
-    for (const auto& subDir : interpreter.addedSubdirectories) {
-        process(dir / subDir);
+    std::error_code errorCode;
+    std::filesystem::rename(tempPath, path, errorCode);
+    if (errorCode) {
+        std::cerr << "Warning! Couldn't write the CMakeParser manifest" << std::endl;
     }
 }
 
 void CMakeParser::test() {
     std::cout << "Testing CMakeParser..." << std::endl;
+    std::vector<std::string> tokenizerTests = {
+        "pxr_library(usd\n    PUBLIC_CLASSES stage prim\n)\n",
+        "set(x \"a\\tb\\\"c\\\\d\\nd\") # comment (with parens)\n",
+        "if(${FOO}_BAR AND NOT \"${BAZ}\" STREQUAL \"\")\nendif()\n",
+        "list(APPEND x a\\;b c\\ d [[bracket]] [==[a]]b]=]c]==] [=x)\n",
+        "#[[ bracket\ncomment ]]\nfoo(\"multi\nline\\\nquoted\")\n",
+        "\tfoo( a;b\t(nested) $ENV{HOME} )\n",
+    };
+    for (const auto& tokenizerTest : tokenizerTests) {
+        if (!Tokenizer::matchesReferenceTokenizer(tokenizerTest)) {
+            std::cerr << "Tokenizer doesn't match the reference tokenizer on: " << tokenizerTest << std::endl;
+            __builtin_trap();
+        }
+    }
+    
     std::vector<std::vector<std::string>> lines = TestDataLoader::load(*(_driver->getFileSystemInfo()), "testCMakeParser.txt", TestDataLoader::PxrNsReplacement::dontReplace);
     for (const std::vector<std::string>& line : lines) {
         if (line.size() != 3) {
@@ -272,8 +514,264 @@ void CMakeParser::test() {
     std::cout << "CMakeParser passed" << std::endl;
 }
 
-std::vector<CMakeParser::Tokenizer::Token> CMakeParser::Tokenizer::tokenize(const std::string& s) {
-    std::vector<Token> result;
+// The same DFA as referenceTokenize(), but a token's text is the span of `s` from where the
+// token started up to the current character, so almost no token owns a copy of its text.
+// The exceptions are quoted and unquoted arguments with escape sequences, which are copied
+// into `rewritten` at the first escape sequence and built up from there
+CMakeParser::Tokenizer::TokenStream CMakeParser::Tokenizer::tokenize(std::string_view s) {
+    TokenStream result;
+    std::vector<Token>& tokens = result.tokens;
+    tokens.reserve(s.size() / 4);
+    
+    DFAState::Kind kind = DFAState::none;
+    // Number as useful
+    int n = 0;
+    bool justHadBackslash = false;
+    bool withinLineComment = false;
+    // Where the token being built starts
+    uint64_t start = 0;
+    // Where the ']' '='* that might close a bracket argument starts
+    uint64_t bracketCloseStart = 0;
+    bool isRewritten = false;
+    std::string rewritten;
+    
+    // Appends the token that's s[start, end), or `rewritten` if it had escape sequences
+    auto pushToken = [&](Token::Kind tokenKind, uint64_t end) {
+        if (isRewritten) {
+            tokens.push_back(Token(tokenKind, result.rewrittenText.emplace_back(std::move(rewritten))));
+            rewritten = std::string();
+            isRewritten = false;
+        } else {
+            tokens.push_back(Token(tokenKind, s.substr(start, end - start)));
+        }
+    };
+    
+    uint64_t i = 0;
+    while (i < s.size()) {
+        unsigned char ch = s[i];
+        // By default, advance
+        i += 1;
+        
+        switch (kind) {
+            case DFAState::none:
+                switch (ch) {
+                    case ' ': tokens.push_back(Token(Token::space, s.substr(i - 1, 1))); break;
+                    case '(': tokens.push_back(Token(Token::lparen, s.substr(i - 1, 1))); break;
+                    case ')': tokens.push_back(Token(Token::rparen, s.substr(i - 1, 1))); break;
+                    case '$': tokens.push_back(Token(Token::dollar, s.substr(i - 1, 1))); break;
+                    case '{': tokens.push_back(Token(Token::lbrace, s.substr(i - 1, 1))); break;
+                    case '}': tokens.push_back(Token(Token::rbrace, s.substr(i - 1, 1))); break;
+                    case '\t': tokens.push_back(Token(Token::space, s.substr(i - 1, 1))); break;
+                    
+                    case '\n':
+                        if (withinLineComment) {
+                            // Line comments never have any text, because referenceTokenize()
+                            // only gives them the ']'s it sees, and those are illegal
+                            tokens.push_back(Token(Token::lineComment, std::string_view()));
+                            withinLineComment = false;
+                        }
+                        tokens.push_back(Token(Token::newline, s.substr(i - 1, 1)));
+                        break;
+                    
+                    case '[':
+                        start = i - 1;
+                        kind = DFAState::parsingBracketOpen;
+                        break;
+                    
+                    case ']':
+                        std::cerr << "Bare ']'" << std::endl;
+                        __builtin_trap();
+                    
+                    case '#':
+                        tokens.push_back(Token(Token::pound, s.substr(i - 1, 1)));
+                        withinLineComment = true;
+                        break;
+                    
+                    case '"':
+                        start = i - 1;
+                        kind = DFAState::withinQuotedArgument;
+                        break;
+                    
+                    default:
+                        if (ch == '_' || ('A' <= ch && ch <= 'Z') || ('a' <= ch && ch <= 'z')) {
+                            start = i - 1;
+                            kind = DFAState::parsingIdentifier;
+                        } else {
+                            i -= 1;
+                            start = i;
+                            kind = DFAState::withinUnquotedArgument;
+                        }
+                        break;
+                }
+                break;
+            
+            case DFAState::parsingIdentifier:
+                if (!(ch == '_' || ('A' <= ch && ch <= 'Z') ||
+                      ('a' <= ch && ch <= 'z') || ('0' <= ch && ch <= '9'))) {
+                    // Don't advance so we process this char in `none` state
+                    i -= 1;
+                    pushToken(Token::identifier, i);
+                    kind = DFAState::none;
+                }
+                break;
+            
+            case DFAState::parsingBracketOpen:
+                if (ch == '=') {
+                    n += 1;
+                    
+                } else if (ch == '[') {
+                    pushToken(Token::bracketOpen, i);
+                    start = i;
+                    kind = DFAState::withinBracketArgument;
+                    
+                } else {
+                    // Rollback into unquoted argument, which starts at the '['
+                    i -= 1;
+                    n = 0;
+                    kind = DFAState::withinUnquotedArgument;
+                }
+                break;
+            
+            case DFAState::parsingBracketClose:
+                if (ch == ']' && n == 0) {
+                    // Commit
+                    pushToken(Token::bracketArgument, bracketCloseStart);
+                    tokens.push_back(Token(Token::bracketClose, s.substr(bracketCloseStart, i - bracketCloseStart)));
+                    kind = DFAState::none;
+                    
+                } else if (ch == '=') {
+                    // This might go negative, but that's okay,
+                    // it'll be handled  by the rollback on ] or non-]= character
+                    n -= 1;
+                    
+                } else {
+                    // Rollback, so the partial bracket close is part of the argument
+                    n += (int)(i - 1 - bracketCloseStart) - 1;
+                    kind = DFAState::withinBracketArgument;
+                }
+                break;
+            
+            case DFAState::withinBracketArgument:
+                if (ch == ']') {
+                    // Can't commit until we see ']' in parsingBracketClose
+                    bracketCloseStart = i - 1;
+                    kind = DFAState::parsingBracketClose;
+                }
+                break;
+            
+            case DFAState::withinQuotedArgument: // fallthrough
+            case DFAState::withinUnquotedArgument:
+                if (justHadBackslash) {
+                    justHadBackslash = false;
+                    // Replace the backslash and this character with what they stand for
+                    if (isRewritten) {
+                        rewritten.pop_back();
+                    } else {
+                        rewritten.assign(s.substr(start, i - 2 - start));
+                        isRewritten = true;
+                    }
+                    switch (ch) {
+                        case 't': rewritten.push_back('\t'); break;
+                        case 'r': rewritten.push_back('\r'); break;
+                        case 'n': rewritten.push_back('\n'); break;
+                        default: rewritten.push_back(ch); break;
+                    }
+                    break;
+                }
+                
+                if (kind == DFAState::withinQuotedArgument && ch == '"') {
+                    if (isRewritten) {
+                        rewritten.push_back(ch);
+                    }
+                    pushToken(Token::quotedArgument, i);
+                    kind = DFAState::none;
+                    break;
+                }
+                if (kind == DFAState::withinUnquotedArgument &&
+                    (std::isspace(ch) || ch == '(' || ch == ')' || ch == '#' || ch == '"')) {
+                    i -= 1;
+                    pushToken(Token::unquotedArgument, i);
+                    kind = DFAState::none;
+                    break;
+                }
+                
+                if (ch == '\\') {
+                    justHadBackslash = true;
+                }
+                if (isRewritten) {
+                    rewritten.push_back(ch);
+                }
+                break;
+        }
+    }
+    
+    return result;
+}
+
+bool CMakeParser::Tokenizer::matchesReferenceTokenizer(const std::string& s) {
+    TokenStream tokenStream = tokenize(s);
+    std::vector<std::pair<Token::Kind, std::string>> expected = referenceTokenize(s);
+    if (tokenStream.tokens.size() != expected.size()) {
+        return false;
+    }
+    for (uint64_t i = 0; i < expected.size(); i++) {
+        if (tokenStream.tokens[i].kind != expected[i].first || tokenStream.tokens[i].text != expected[i].second) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// MARK: Benchmark
+
+/* static */
+void CMakeParser::benchmarkTokenizer(const std::filesystem::path& usdSourceRepoPath) {
+    std::vector<std::pair<uint64_t, std::filesystem::path>> cmakeLists;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(usdSourceRepoPath)) {
+        if (entry.is_regular_file() && entry.path().filename() == "CMakeLists.txt") {
+            cmakeLists.push_back({entry.file_size(), entry.path()});
+        }
+    }
+    std::sort(cmakeLists.begin(), cmakeLists.end(), std::greater<>());
+    cmakeLists.resize(std::min<uint64_t>(cmakeLists.size(), 10));
+    
+    auto time = [](const std::string& label, uint64_t nIterations, auto&& f) {
+        const auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < nIterations; i++) {
+            f();
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "    " << label << ": " << (elapsed.count() / nIterations) * 1e6 << "us" << std::endl;
+    };
+    
+    const uint64_t nIterations = 100;
+    for (const auto& [size, path] : cmakeLists) {
+        std::stringstream ss;
+        ss << std::ifstream(path).rdbuf();
+        std::string s = ss.str();
+        
+        std::cout << path.string() << " (" << size << " bytes)" << std::endl;
+        if (!Tokenizer::matchesReferenceTokenizer(s)) {
+            std::cerr << "Tokenizer doesn't match the reference tokenizer on " << path.string() << std::endl;
+            __builtin_trap();
+        }
+        time("referenceTokenize", nIterations, [&]() {
+            std::vector<std::pair<Tokenizer::Token::Kind, std::string>> tokens = Tokenizer::referenceTokenize(s);
+        });
+        time("tokenize", nIterations, [&]() {
+            Tokenizer::TokenStream tokenStream = Tokenizer::tokenize(s);
+        });
+        time("tokenize and build commands", nIterations, [&]() {
+            Tokenizer::TokenStream tokenStream = Tokenizer::tokenize(s);
+            std::vector<CommandInvocationBuilder::CommandInvocation> commands = CommandInvocationBuilder::build(tokenStream.tokens);
+        });
+    }
+}
+
+// MARK: Reference tokenizer
+
+std::vector<std::pair<CMakeParser::Tokenizer::Token::Kind, std::string>> CMakeParser::Tokenizer::referenceTokenize(const std::string& s) {
+    std::vector<std::pair<Token::Kind, std::string>> result;
     DFAState dfaState;
     
     uint64_t i = 0;
@@ -285,17 +783,17 @@ std::vector<CMakeParser::Tokenizer::Token> CMakeParser::Tokenizer::tokenize(cons
         switch (dfaState.kind) {
             case DFAState::none:
                 if (ch == ' ' || ch == '\t')  {
-                    result.push_back(Token(Token::space, ch));
+                    result.push_back({Token::space, std::string(1, ch)});
                     break;
                     
                 } else if (ch == '\n') {
                     if (dfaState.withinLineComment) {
-                        result.push_back(Token(Token::lineComment, dfaState.untokenizedText));
+                        result.push_back({Token::lineComment, dfaState.untokenizedText});
                         dfaState.withinLineComment = false;
                         dfaState.untokenizedText = "";
                     }
                     
-                    result.push_back(Token(Token::newline, ch));
+                    result.push_back({Token::newline, std::string(1, ch)});
                     break;
                     
                 } else if (ch == '_' || ('A' <= ch && ch <= 'Z') || ('a' <= ch && ch <= 'z')) {
@@ -304,11 +802,11 @@ std::vector<CMakeParser::Tokenizer::Token> CMakeParser::Tokenizer::tokenize(cons
                     break;
                     
                 } else if (ch == '(') {
-                    result.push_back(Token(Token::lparen, ch));
+                    result.push_back({Token::lparen, std::string(1, ch)});
                     break;
                     
                 } else if (ch == ')') {
-                    result.push_back(Token(Token::rparen, ch));
+                    result.push_back({Token::rparen, std::string(1, ch)});
                     break;
                     
                 } else if (ch == '[') {
@@ -325,20 +823,20 @@ std::vector<CMakeParser::Tokenizer::Token> CMakeParser::Tokenizer::tokenize(cons
                     }
                                         
                 } else if (ch == '#') {
-                    result.push_back(Token(Token::pound, ch));
+                    result.push_back({Token::pound, std::string(1, ch)});
                     dfaState.withinLineComment = true;
                     break;
                     
                 } else if (ch == '$') {
-                    result.push_back(Token(Token::dollar, ch));
+                    result.push_back({Token::dollar, std::string(1, ch)});
                     break;
                     
                 } else if (ch == '{') {
-                    result.push_back(Token(Token::lbrace, ch));
+                    result.push_back({Token::lbrace, std::string(1, ch)});
                     break;
                     
                 } else if (ch == '}') {
-                    result.push_back(Token(Token::rbrace, ch));
+                    result.push_back({Token::rbrace, std::string(1, ch)});
                     break;
                     
                 } else if (ch == '"') {
@@ -366,7 +864,7 @@ std::vector<CMakeParser::Tokenizer::Token> CMakeParser::Tokenizer::tokenize(cons
                 } else {
                     // Don't advance so we process this char in `none` state
                     i -= 1;
-                    result.push_back(Token(Token::identifier, dfaState.untokenizedText));
+                    result.push_back({Token::identifier, dfaState.untokenizedText});
                     dfaState.untokenizedText = "";
                     dfaState.kind = DFAState::none;
                     break;
@@ -380,7 +878,7 @@ std::vector<CMakeParser::Tokenizer::Token> CMakeParser::Tokenizer::tokenize(cons
                     
                 } else if (ch == '[') {
                     dfaState.untokenizedText.push_back(ch);
-                    result.push_back(Token(Token::bracketOpen, dfaState.untokenizedText));
+                    result.push_back({Token::bracketOpen, dfaState.untokenizedText});
                     dfaState.untokenizedText = "";
                     dfaState.kind = DFAState::withinBracketArgument;
                     break;
@@ -397,8 +895,8 @@ std::vector<CMakeParser::Tokenizer::Token> CMakeParser::Tokenizer::tokenize(cons
                 if (ch == ']' && dfaState.n == 0) {
                     // Commit
                     dfaState.partiallyParsedBracketClose.push_back(ch);
-                    result.push_back(Token(Token::bracketArgument, dfaState.untokenizedText));
-                    result.push_back(Token(Token::bracketClose, dfaState.partiallyParsedBracketClose));
+                    result.push_back({Token::bracketArgument, dfaState.untokenizedText});
+                    result.push_back({Token::bracketClose, dfaState.partiallyParsedBracketClose});
                     dfaState.untokenizedText = "";
                     dfaState.partiallyParsedBracketClose = "";
                     dfaState.kind = DFAState::none;
@@ -470,7 +968,7 @@ std::vector<CMakeParser::Tokenizer::Token> CMakeParser::Tokenizer::tokenize(cons
                     
                 } else if (ch == '"') {
                     dfaState.untokenizedText.push_back(ch);
-                    result.push_back(Token(Token::quotedArgument, dfaState.untokenizedText));
+                    result.push_back({Token::quotedArgument, dfaState.untokenizedText});
                     dfaState.untokenizedText = "";
                     dfaState.kind = DFAState::none;
                     break;
@@ -512,7 +1010,7 @@ std::vector<CMakeParser::Tokenizer::Token> CMakeParser::Tokenizer::tokenize(cons
                 
                 if (std::isspace(ch) || std::string("()#\"").find(ch) != std::string::npos) {
                     i -= 1;
-                    result.push_back(Token(Token::unquotedArgument, dfaState.untokenizedText));
+                    result.push_back({Token::unquotedArgument, dfaState.untokenizedText});
                     dfaState.untokenizedText = "";
                     dfaState.kind = DFAState::none;
                     break;
@@ -532,35 +1030,29 @@ std::vector<CMakeParser::Tokenizer::Token> CMakeParser::Tokenizer::tokenize(cons
     return result;
 }
 
-CMakeParser::Tokenizer::Token::Token(CMakeParser::Tokenizer::Token::Kind kind, const std::string& text) 
+CMakeParser::Tokenizer::Token::Token(CMakeParser::Tokenizer::Token::Kind kind, std::string_view text) 
 : text(text),
 kind(kind)
 {
 }
 
-CMakeParser::Tokenizer::Token::Token(CMakeParser::Tokenizer::Token::Kind kind, unsigned char ch)
-: text(std::string(1, ch)),
-kind(kind)
-{
-}
-
 CMakeParser::Tokenizer::Token::operator std::string() const {
     switch (kind) {
-        case space: return "SPACE '" + text + "'";
-        case newline: return "NEWLINE '" + text + "'";
-        case identifier: return "IDENTIFIER '" + text + "'";
-        case lparen: return "LPAREN '" + text + "'";
-        case rparen: return "RPAREN '" + text + "'";
-        case bracketOpen: return "BRACKETOPEN '" + text + "'";
-        case bracketClose: return "BRACKETCLOSE '" + text + "'";
-        case pound: return "POUND '" + text + "'";
-        case dollar: return "DOLLAR '" + text + "'";
-        case lbrace: return "LBRACE '" + text + "'";
-        case rbrace: return "RBRACE '" + text + "'";
-        case bracketArgument: return "BRACKETARGUMENT '" + text + "'";
-        case quotedArgument: return "QUOTEDARGUMENT '" + text + "'";
-        case unquotedArgument: return "UNQUOTEDARGUMENT '" + text + "'";
-        case lineComment: return "LINECOMMENT '" + text + "'";
+        case space: return "SPACE '" + std::string(text) + "'";
+        case newline: return "NEWLINE '" + std::string(text) + "'";
+        case identifier: return "IDENTIFIER '" + std::string(text) + "'";
+        case lparen: return "LPAREN '" + std::string(text) + "'";
+        case rparen: return "RPAREN '" + std::string(text) + "'";
+        case bracketOpen: return "BRACKETOPEN '" + std::string(text) + "'";
+        case bracketClose: return "BRACKETCLOSE '" + std::string(text) + "'";
+        case pound: return "POUND '" + std::string(text) + "'";
+        case dollar: return "DOLLAR '" + std::string(text) + "'";
+        case lbrace: return "LBRACE '" + std::string(text) + "'";
+        case rbrace: return "RBRACE '" + std::string(text) + "'";
+        case bracketArgument: return "BRACKETARGUMENT '" + std::string(text) + "'";
+        case quotedArgument: return "QUOTEDARGUMENT '" + std::string(text) + "'";
+        case unquotedArgument: return "UNQUOTEDARGUMENT '" + std::string(text) + "'";
+        case lineComment: return "LINECOMMENT '" + std::string(text) + "'";
     }
 }
 
@@ -577,14 +1069,14 @@ CMakeParser::Tokenizer::DFAState::DFAState() :
     kind(CMakeParser::Tokenizer::DFAState::none) {
 }
 
-std::vector<CMakeParser::CommandInvocationBuilder::CommandInvocation> CMakeParser::CommandInvocationBuilder::build(std::vector<CMakeParser::Tokenizer::Token> tokens) {
+std::vector<CMakeParser::CommandInvocationBuilder::CommandInvocation> CMakeParser::CommandInvocationBuilder::build(const std::vector<CMakeParser::Tokenizer::Token>& tokens) {
     std::vector<CommandInvocation> result;
     
     DFAState dfaState;
     
     uint64_t i = 0;
     while (i < tokens.size()) {
-        Tokenizer::Token token = tokens[i];
+        const Tokenizer::Token& token = tokens[i];
         // Advance by default
         i += 1;
         
@@ -729,7 +1221,7 @@ std::vector<CMakeParser::CommandInvocationBuilder::CommandInvocation> CMakeParse
                     case Tokenizer::Token::rparen:
                         dfaState.commandInvocationLparenCount -= 1;
                         if (dfaState.commandInvocationLparenCount < 0) {
-                            result.push_back(CommandInvocation(dfaState.commandInvocationName, dfaState.commandInvocationArguments));
+                            result.push_back(CommandInvocation(dfaState.commandInvocationName, std::move(dfaState.commandInvocationArguments)));
                             dfaState.commandInvocationName = "";
                             dfaState.commandInvocationArguments = {};
                             dfaState.kindStack.pop_back();
@@ -769,9 +1261,9 @@ std::vector<CMakeParser::CommandInvocationBuilder::CommandInvocation> CMakeParse
     return result;
 }
 
-CMakeParser::CommandInvocationBuilder::CommandInvocation::CommandInvocation(const std::string& name, std::vector<Argument> arguments) :
+CMakeParser::CommandInvocationBuilder::CommandInvocation::CommandInvocation(std::string_view name, std::vector<Argument> arguments) :
 _rawName(name),
-arguments(arguments) {
+arguments(std::move(arguments)) {
     lowercaseName = _rawName;
     std::transform(lowercaseName.begin(), lowercaseName.end(), lowercaseName.begin(), [](unsigned char ch){ return std::tolower(ch); });
 }
@@ -783,26 +1275,26 @@ CMakeParser::CommandInvocationBuilder::DFAState::DFAState() :
     kindStack({DFAState::none}) {
 }
 
-CMakeParser::CommandInvocationBuilder::CommandInvocation::Argument::Argument(const std::string &text) : 
+CMakeParser::CommandInvocationBuilder::CommandInvocation::Argument::Argument(std::string_view text) : 
 text(text),
 isUnquoted(false),
 isQuoted(false),
 isBracket(false)
 {}
 
-CMakeParser::CommandInvocationBuilder::CommandInvocation::Argument CMakeParser::CommandInvocationBuilder::CommandInvocation::Argument::quoted(const std::string &text) {
+CMakeParser::CommandInvocationBuilder::CommandInvocation::Argument CMakeParser::CommandInvocationBuilder::CommandInvocation::Argument::quoted(std::string_view text) {
     Argument x(text);
     x.isQuoted = true;
     return x;
 }
 
-CMakeParser::CommandInvocationBuilder::CommandInvocation::Argument CMakeParser::CommandInvocationBuilder::CommandInvocation::Argument::unquoted(const std::string &text) {
+CMakeParser::CommandInvocationBuilder::CommandInvocation::Argument CMakeParser::CommandInvocationBuilder::CommandInvocation::Argument::unquoted(std::string_view text) {
     Argument x(text);
     x.isUnquoted = true;
     return x;
 }
 
-CMakeParser::CommandInvocationBuilder::CommandInvocation::Argument CMakeParser::CommandInvocationBuilder::CommandInvocation::Argument::bracket(const std::string &text) {
+CMakeParser::CommandInvocationBuilder::CommandInvocation::Argument CMakeParser::CommandInvocationBuilder::CommandInvocation::Argument::bracket(std::string_view text) {
     Argument x(text);
     x.isBracket = true;
     return x;
@@ -865,7 +1357,7 @@ CMakeParser::BlockBuilder::Block CMakeParser::BlockBuilder::buildBlock(const std
                 __builtin_trap();
             }
             blockStack.back().blocks.push_back({Block(command)});
-            Block tmp = blockStack.back();
+            Block tmp = std::move(blockStack.back());
             blockStack.pop_back();
             blockStack.back().blocks.push_back(tmp);
             
@@ -878,7 +1370,7 @@ CMakeParser::BlockBuilder::Block CMakeParser::BlockBuilder::buildBlock(const std
                 __builtin_trap();
             }
             blockStack.back().blocks.push_back({Block(command)});
-            Block tmp = blockStack.back();
+            Block tmp = std::move(blockStack.back());
             blockStack.pop_back();
             blockStack.back().blocks.push_back(tmp);
 
@@ -891,7 +1383,7 @@ CMakeParser::BlockBuilder::Block CMakeParser::BlockBuilder::buildBlock(const std
                 __builtin_trap();
             }
             blockStack.back().blocks.push_back({Block(command)});
-            Block tmp = blockStack.back();
+            Block tmp = std::move(blockStack.back());
             blockStack.pop_back();
             blockStack.back().blocks.push_back(tmp);
 
@@ -904,7 +1396,7 @@ CMakeParser::BlockBuilder::Block CMakeParser::BlockBuilder::buildBlock(const std
                 __builtin_trap();
             }
             blockStack.back().blocks.push_back({Block(command)});
-            Block tmp = blockStack.back();
+            Block tmp = std::move(blockStack.back());
             blockStack.pop_back();
             blockStack.back().blocks.push_back(tmp);
 
@@ -917,7 +1409,7 @@ CMakeParser::BlockBuilder::Block CMakeParser::BlockBuilder::buildBlock(const std
                 __builtin_trap();
             }
             blockStack.back().blocks.push_back({Block(command)});
-            Block tmp = blockStack.back();
+            Block tmp = std::move(blockStack.back());
             blockStack.pop_back();
             blockStack.back().blocks.push_back(tmp);
 
@@ -998,86 +1490,117 @@ std::ostream& operator<<(std::ostream& os, const CMakeParser::BlockBuilder::Bloc
     return os << obj.to_string(0);
 }
 
+CMakeParser::Interpreter::VariableTable::VariableTable(std::initializer_list<std::pair<std::string_view, std::string_view>> l) {
+    for (const auto& [name, value] : l) {
+        set(name, std::string(value));
+    }
+}
+
+const CMakeParser::Interpreter::Variable* CMakeParser::Interpreter::VariableTable::find(std::string_view name) const {
+    auto it = ids.find(name);
+    if (it == ids.end()) {
+        return nullptr;
+    }
+    return &values[it->second];
+}
+
+const CMakeParser::Interpreter::Variable& CMakeParser::Interpreter::VariableTable::set(std::string_view name, std::string value) {
+    auto it = ids.find(name);
+    if (it == ids.end()) {
+        it = ids.insert({std::string(name), (uint32_t)values.size()}).first;
+        values.push_back(Variable());
+    }
+    Variable& variable = values[it->second];
+    variable.value = std::move(value);
+    variable.list.reset();
+    return variable;
+}
+
+const CMakeParser::Interpreter::VariableTable& CMakeParser::Interpreter::defaultVariables() {
+    static const VariableTable result = VariableTable({
+        // Compiler features
+        {"CMAKE_Swift_COMPILER_VERSION", "6"},
+        {"CMAKE_CXX_COMPILER_ID", "AppleClang"},
+        {"APPLE", "1"}, // LINUX
+        {"UNIX", "1"}, // LINUX
+        
+        
+        // Usd feature flags
+        {"PXR_BUILD_IMAGING", "yes"},
+        {"PXR_BUILD_USD_IMAGING", "yes"},
+        {"PXR_BUILD_GPU_SUPPORT", "1"},
+        {"PXR_BUILD_EXEC", "1"},
+        {"PXR_ENABLE_MATERIALX_SUPPORT", "yes"},
+        {"PXR_ENABLE_GL_SUPPORT", "1"},
+        {"PXR_ENABLE_METAL_SUPPORT", "1"}, // LINUX
+        {"PXR_ENABLE_VULKAN_SUPPORT", "0"}, // LINUX
+        {"PXR_ENABLE_OPENVDB_SUPPORT", "0"},
+        {"PXR_ENABLE_PTEX_SUPPORT", "0"},
+        {"PXR_APPLE_EMBEDDED", "1"}, // LINUX
+        {"PXR_BUILD_USD_VALIDATION", "1"},
+        
+        // Usd plugins
+        {"PXR_BUILD_ALEMBIC_PLUGIN", "0"},
+        {"PXR_BUILD_DRACO_PLUGIN", "0"},
+        {"PXR_BUILD_EMBREE_PLUGIN", "0"},
+        {"PXR_BUILD_OPENCOLORIO_PLUGIN", "0"},
+        {"PXR_BUILD_PRMAN_PLUGIN", "0"},
+        
+        // Usd tests
+        {"PXR_BUILD_TESTS", "0"},
+        {"PXR_BUILD_ANIMX_TESTS", "0"},
+        {"PXR_BUILD_MAYAPY_TESTS", "0"},
+        
+        // Usd artifacts
+        {"PXR_BUILD_DOCUMENTATION", "0"},
+        
+        // Usd misc
+        {"_PXR_CXX_FLAGS", "0"},
+        {"PXR_HEADLESS_TEST_MODE", "0"},
+        {"PXR_VALIDATE_GENERATED_CODE", "0"},
+        
+        // CMake
+        {"CMAKE_CXX_FLAGS", "0"},
+        {"CMAKE_DL_LIBS", "0"},
+        {"PROJECT_SOURCE_DIR", "0"},
+        
+        // Boost
+        {"Boost_PYTHON_LIBRARY", "0"},
+        {"Boost_INCLUDE_DIRS", "0"},
+        
+        // OpenEXR
+        {"OPENEXR_INCLUDE_DIRS", "0"},
+        {"OPENEXR_LIBRARIES", "0"},
+        
+        // OpenSubdiv
+        {"OPENSUBDIV_INCLUDE_DIR", "0"},
+        {"OPENSUBDIV_LIBRARIES", "0"},
+        {"OPENSUBDIV_OSDCPU_LIBRARY", "0"},
+        
+        // Python
+        {"PYTHON_EXECUTABLE", "0"},
+        {"PYTHON_INCLUDE_DIRS", "0"},
+        {"PYTHON_INCLUDE_PATH", "0"},
+        {"PYTHON_LIBRARIES", "0"},
+
+        // TBB
+        {"TBB_tbb_LIBRARY", "0"},
+        {"TBB_INCLUDE_DIRS", "0"},
+        
+        // Misc
+        {"APPKIT_LIBRARY", "0"},
+        {"M_LIB", "0"},
+        {"OPENGL_gl_LIBRARY", "0"},
+        {"RENDERMAN_VERSION_MAJOR", "0"},
+        {"VULKAN_LIBS", "0"}, // LINUX
+        {"WINLIBS", "0"},
+        {"X11_LIBRARIES", "0"}, // LINUX
+    });
+    return result;
+}
+
 CMakeParser::Interpreter::Interpreter() :
-variables({
-    // Compiler features
-    {"CMAKE_Swift_COMPILER_VERSION", "6"},
-    {"CMAKE_CXX_COMPILER_ID", "AppleClang"},
-    {"APPLE", "1"}, // LINUX
-    {"UNIX", "1"}, // LINUX
-    
-    
-    // Usd feature flags
-    {"PXR_BUILD_IMAGING", "yes"},
-    {"PXR_BUILD_USD_IMAGING", "yes"},
-    {"PXR_BUILD_GPU_SUPPORT", "1"},
-    {"PXR_BUILD_EXEC", "1"},
-    {"PXR_ENABLE_MATERIALX_SUPPORT", "yes"},
-    {"PXR_ENABLE_GL_SUPPORT", "1"},
-    {"PXR_ENABLE_METAL_SUPPORT", "1"}, // LINUX
-    {"PXR_ENABLE_VULKAN_SUPPORT", "0"}, // LINUX
-    {"PXR_ENABLE_OPENVDB_SUPPORT", "0"},
-    {"PXR_ENABLE_PTEX_SUPPORT", "0"},
-    {"PXR_APPLE_EMBEDDED", "1"}, // LINUX
-    {"PXR_BUILD_USD_VALIDATION", "1"},
-    
-    // Usd plugins
-    {"PXR_BUILD_ALEMBIC_PLUGIN", "0"},
-    {"PXR_BUILD_DRACO_PLUGIN", "0"},
-    {"PXR_BUILD_EMBREE_PLUGIN", "0"},
-    {"PXR_BUILD_OPENCOLORIO_PLUGIN", "0"},
-    {"PXR_BUILD_PRMAN_PLUGIN", "0"},
-    
-    // Usd tests
-    {"PXR_BUILD_TESTS", "0"},
-    {"PXR_BUILD_ANIMX_TESTS", "0"},
-    {"PXR_BUILD_MAYAPY_TESTS", "0"},
-    
-    // Usd artifacts
-    {"PXR_BUILD_DOCUMENTATION", "0"},
-    
-    // Usd misc
-    {"_PXR_CXX_FLAGS", "0"},
-    {"PXR_HEADLESS_TEST_MODE", "0"},
-    {"PXR_VALIDATE_GENERATED_CODE", "0"},
-    
-    // CMake
-    {"CMAKE_CXX_FLAGS", "0"},
-    {"CMAKE_DL_LIBS", "0"},
-    {"PROJECT_SOURCE_DIR", "0"},
-            
-    // Boost
-    {"Boost_PYTHON_LIBRARY", "0"},
-    {"Boost_INCLUDE_DIRS", "0"},
-    
-    // OpenEXR
-    {"OPENEXR_INCLUDE_DIRS", "0"},
-    {"OPENEXR_LIBRARIES", "0"},
-    
-    // OpenSubdiv
-    {"OPENSUBDIV_INCLUDE_DIR", "0"},
-    {"OPENSUBDIV_LIBRARIES", "0"},
-    {"OPENSUBDIV_OSDCPU_LIBRARY", "0"},
-    
-    // Python
-    {"PYTHON_EXECUTABLE", "0"},
-    {"PYTHON_INCLUDE_DIRS", "0"},
-    {"PYTHON_INCLUDE_PATH", "0"},
-    {"PYTHON_LIBRARIES", "0"},
-
-    // TBB
-    {"TBB_tbb_LIBRARY", "0"},
-    {"TBB_INCLUDE_DIRS", "0"},
-    
-    // Misc
-    {"APPKIT_LIBRARY", "0"},
-    {"M_LIB", "0"},
-    {"OPENGL_gl_LIBRARY", "0"},
-    {"RENDERMAN_VERSION_MAJOR", "0"},
-    {"VULKAN_LIBS", "0"}, // LINUX
-    {"WINLIBS", "0"},
-    {"X11_LIBRARIES", "0"}, // LINUX
-})
+variables(defaultVariables())
 {}
 
 std::string CMakeParser::Interpreter::interpretBlock(const CMakeParser::BlockBuilder::Block &block) {
@@ -1100,7 +1623,7 @@ std::string CMakeParser::Interpreter::interpretBlock(const CMakeParser::BlockBui
             int instructionIndex = 0;
             
             while (true) {
-                BlockBuilder::Block predicateBlock = block.blocks[instructionIndex];
+                const BlockBuilder::Block& predicateBlock = block.blocks[instructionIndex];
                 
                 bool shouldDoPredicate = false;
                 
@@ -1109,8 +1632,7 @@ std::string CMakeParser::Interpreter::interpretBlock(const CMakeParser::BlockBui
                 } else if (predicateBlock.command->lowercaseName == "endif") {
                     break; // while loop
                 } else {
-                    std::vector<CommandInvocationBuilder::CommandInvocation::Argument> predicateArguments = predicateBlock.command->arguments;
-                    shouldDoPredicate = evaluateBooleanExpression(variableExpandArguments(predicateArguments));
+                    shouldDoPredicate = evaluateCondition(predicateBlock, variableExpandArguments(predicateBlock.command->arguments));
                 }
                 
                 int nextControlFlow = findControlFlowPointAfter(instructionIndex, block);
@@ -1131,7 +1653,7 @@ std::string CMakeParser::Interpreter::interpretBlock(const CMakeParser::BlockBui
             
         case CMakeParser::BlockBuilder::Block::foreachBlock:
         {
-            BlockBuilder::Block foreachBlock = block.blocks[0];
+            const BlockBuilder::Block& foreachBlock = block.blocks[0];
             if (foreachBlock.command->lowercaseName != "foreach") {
                 std::cerr << "Illegal foreach block 0 " << block << std::endl;
                 __builtin_trap();
@@ -1153,7 +1675,7 @@ std::string CMakeParser::Interpreter::interpretBlock(const CMakeParser::BlockBui
             
             std::string blockResult;
             for (const auto& item : itemsValue) {
-                variables[loopVar] = item;
+                variables.set(loopVar, item);
                 
                 for (int instructionIndex = 1; instructionIndex < block.blocks.size() - 1; instructionIndex += 1) {
                     blockResult = interpretBlock(block.blocks[instructionIndex]);
@@ -1269,7 +1791,7 @@ std::string CMakeParser::Interpreter::interpretCommand(const CMakeParser::Comman
         std::vector<std::string> restArgs = args;
         restArgs.erase(restArgs.begin());
         std::string value = semicolonJoin(restArgs);
-        variables[varName] = value;
+        variables.set(varName, value);
         if (CMAKEPARSER_INTERPRETER_DEBUGPRINT) {
             std::cout << "Set '" << varName << "' to '" << value << "'" << std::endl;
         }
@@ -1288,14 +1810,13 @@ std::string CMakeParser::Interpreter::interpretCommand(const CMakeParser::Comman
             restArguments.erase(restArguments.begin());
             restArguments.erase(restArguments.begin());
             std::string value = semicolonJoin(restArguments);
-            auto it = variables.find(varName);
-            if (it == variables.end()) {
-                variables[varName] = value;
-            } else {
-                variables[varName] = it->second + ";" + value;
+            const Variable* variable = variables.find(varName);
+            if (variable) {
+                value = variable->value + ";" + value;
             }
+            const Variable& appended = variables.set(varName, std::move(value));
             if (CMAKEPARSER_INTERPRETER_DEBUGPRINT) {
-                std::cout << "list append '" << varName << "' to '" << variables.find(varName)->second << "'" << std::endl;
+                std::cout << "list append '" << varName << "' to '" << appended.value << "'" << std::endl;
             }
             return "";
         }
@@ -1355,7 +1876,7 @@ std::vector<std::string> CMakeParser::Interpreter::variableExpandArguments(const
                 unquotedBuffer = "";
                 result.insert(result.end(), expanded.begin(), expanded.end());
             }
-            result.push_back(argument.text);
+            result.push_back(std::string(argument.text));
             
         } else if (argument.isQuoted) {
             if (unquotedBuffer != "") {
@@ -1363,8 +1884,7 @@ std::vector<std::string> CMakeParser::Interpreter::variableExpandArguments(const
                 unquotedBuffer = "";
                 result.insert(result.end(), expanded.begin(), expanded.end());
             }
-            std::string toExpand = argument.text;
-            toExpand = toExpand.substr(1, toExpand.size() - 2);
+            std::string_view toExpand = argument.text.substr(1, argument.text.size() - 2);
             std::vector<std::string> expanded = variableExpandIfNeeded(toExpand);
             result.insert(result.end(), expanded.begin(), expanded.end());
 
@@ -1397,7 +1917,7 @@ std::vector<std::string> CMakeParser::Interpreter::variableExpandArguments(const
     return result;
 }
 
-std::vector<std::string> CMakeParser::Interpreter::variableExpandIfNeeded(const std::string& s) const {
+std::vector<std::string> CMakeParser::Interpreter::variableExpandIfNeeded(std::string_view s) const {
     if (CMAKEPARSER_INTERPRETER_DEBUGPRINT) {
         std::cout << "VariableExpandIfNeeded '" << s << "'" << std::endl;
     }
@@ -1407,6 +1927,27 @@ std::vector<std::string> CMakeParser::Interpreter::variableExpandIfNeeded(const
         return {"8"};
     }
     
+    // Most arguments don't reference variables, so they don't need to be rewritten
+    if (s.find_first_of("$}\\") == std::string_view::npos) {
+        return semicolonSplit(s);
+    }
+    
+    // Many arguments are a single variable reference, and that variable's list
+    // only needs to be split the first time it's used
+    if (s.size() > 3 && s.starts_with("${") && s.back() == '}' &&
+        s.find_first_of("${}\\", 2) == s.size() - 1) {
+        const Variable* variable = variables.find(s.substr(2, s.size() - 3));
+        if (variable) {
+            if (CMAKEPARSER_INTERPRETER_DEBUGPRINT) {
+                std::cout << "VariableExpandIfNeeded '" << s << "': '" << variable->value << "'" << std::endl;
+            }
+            if (!variable->list) {
+                variable->list = semicolonSplit(variable->value);
+            }
+            return *variable->list;
+        }
+    }
+    
     std::vector<std::string> expansionStack = {""};
     uint64_t i = 0;
     while (i < s.size()) {
@@ -1469,21 +2010,22 @@ std::vector<std::string> CMakeParser::Interpreter::variableExpandIfNeeded(const
     return semicolonSplit(expansionStack.front());
 }
 
-std::string CMakeParser::Interpreter::varLookup(const std::string &s) const {
-    const auto& it = variables.find(s);
-    if (it == variables.end()) {
+const std::string& CMakeParser::Interpreter::varLookup(std::string_view s) const {
+    static const std::string notFound;
+    const Variable* variable = variables.find(s);
+    if (!variable) {
         if (CMAKEPARSER_INTERPRETER_DEBUGPRINT_VARLOOKUP_NOTFOUND) {
             std::cout << "VARLOOKUP '" << s << "': ";
             std::cout << "'' (not found)" << std::endl;
         }
-        return "";
+        return notFound;
     }
     
     if (CMAKEPARSER_INTERPRETER_DEBUGPRINT) {
         std::cout << "VARLOOKUP '" << s << "': ";
-        std::cout << "'" << it->second << "'" << std::endl;
+        std::cout << "'" << variable->value << "'" << std::endl;
     }
-    return it->second;
+    return variable->value;
 }
 
 std::string CMakeParser::Interpreter::semicolonJoin(const std::vector<std::string>& l) {
@@ -1497,7 +2039,19 @@ std::string CMakeParser::Interpreter::semicolonJoin(const std::vector<std::strin
     return ss.str();
 }
 
-std::vector<std::string> CMakeParser::Interpreter::semicolonSplit(const std::string &s) {
+std::vector<std::string> CMakeParser::Interpreter::semicolonSplit(std::string_view s) {
+    if (s.find('\\') == std::string_view::npos) {
+        // Without escapes, every element is a span of `s`
+        std::vector<std::string> result;
+        uint64_t start = 0;
+        for (uint64_t end = s.find(';'); end != std::string_view::npos; end = s.find(';', start)) {
+            result.push_back(std::string(s.substr(start, end - start)));
+            start = end + 1;
+        }
+        result.push_back(std::string(s.substr(start)));
+        return result;
+    }
+    
     std::vector<std::string> result = {""};
     
     uint64_t i = 0;
@@ -1702,50 +2256,15 @@ bool CMakeParser::Interpreter::evaluateOperation(const std::string& leftOp, cons
     }
 }
 
-std::vector<std::string> CMakeParser::Interpreter::substituteBooleanValue(bool v, const std::vector<std::string>& exprs, int i, int j) const {
-    if (CMAKEPARSER_INTERPRETER_DEBUGPRINT) {
-        std::cout << "Substitute boolean value " << v << " [";
-        for (const auto& x : exprs) {
-            std::cout << x << ", ";
-        }
-        std::cout << "] " << i << " " << j << " => ";
-    }
-    
-    std::string stringified = v ? "TRUE" : "FALSE";
-    std::vector<std::string> result;
-    result.insert(result.end(), exprs.begin(), exprs.begin() + i);
-    result.push_back(stringified);
-    result.insert(result.end(), exprs.begin() + j, exprs.end());
-    
-    if (CMAKEPARSER_INTERPRETER_DEBUGPRINT) {
-        std::cout << "[";
-        for (const auto& x : result) {
-            std::cout << x << ", ";
-        }
-        std::cout << "]" << std::endl;
-    }
-    
-    return result;
-}
-
-bool CMakeParser::Interpreter::evaluateBooleanExpression(const std::vector<std::string>& exprs) const {
-    if (CMAKEPARSER_INTERPRETER_DEBUGPRINT) {
-        std::cout << "Evaluate boolean expr [";
-        for (const auto& x : exprs) {
-            std::cout << x << ", ";
-        }
-        std::cout << "]" << std::endl;
-    }
-    
+// Highest to lowest precedence. `true` indicates unary,
+// `false` indicates binary
+static const std::vector<std::pair<bool, std::vector<std::string_view>>>& conditionOperatorClasses() {
     // Parentheses
     // Unary tests like EXISTS, COMMAND, DEFINED
     // Binary tests like EQUAL, LESS, LESS_EQUAL
     // Unary NOT
     // Binary AND, OR, left-to-right, no short-circiting
-    
-    // Highest to lowest precedence. `true` indicates unary,
-    // `false` indicates binary
-    std::vector<std::pair<bool, std::vector<std::string>>> operatorClasses = {
+    static const std::vector<std::pair<bool, std::vector<std::string_view>>> result = {
         {true, {
             "COMMAND", "POLICY", "TARGET", "TEST", "DEFINED",
             "EXISTS", "IS_READABLE", "IS_WRITABLE", "IS_EXECUTABLE",
@@ -1761,13 +2280,83 @@ bool CMakeParser::Interpreter::evaluateBooleanExpression(const std::vector<std::
         {true, {"NOT"}},
         {false, {"AND", "OR"}},
     };
+    return result;
+}
+
+bool CMakeParser::Interpreter::evaluateCondition(const BlockBuilder::Block& predicateBlock, const std::vector<std::string>& exprs) {
+    if (CMAKEPARSER_INTERPRETER_DEBUGPRINT) {
+        std::cout << "Evaluate boolean expr [";
+        for (const auto& x : exprs) {
+            std::cout << x << ", ";
+        }
+        std::cout << "]" << std::endl;
+    }
     
+    // Parsing only looks at which arguments are parentheses or operators,
+    // so the tree from last time is still good if those haven't moved
+    std::string shape = conditionShape(exprs);
+    auto it = conditions.find(&predicateBlock);
+    if (it == conditions.end() || it->second.shape != shape) {
+        Condition condition;
+        condition.shape = std::move(shape);
+        std::vector<int> elements;
+        for (int i = 0; i < exprs.size(); i++) {
+            elements.push_back((int)condition.nodes.size());
+            condition.nodes.push_back({.kind = Condition::Node::argument, .argumentIndex = i});
+        }
+        condition.root = parseCondition(condition, elements, exprs);
+        it = conditions.insert_or_assign(&predicateBlock, std::move(condition)).first;
+    }
+    
+    return evaluateConditionNode(it->second, it->second.root, exprs);
+}
+
+std::string CMakeParser::Interpreter::conditionShape(const std::vector<std::string>& exprs) {
+    std::string result;
+    result.reserve(exprs.size());
+    for (const auto& x : exprs) {
+        char c = '.';
+        if (x == "(" || x == ")") {
+            c = x[0];
+        } else {
+            char keyword = 'A';
+            for (const auto& operatorClass : conditionOperatorClasses()) {
+                for (const auto& op : operatorClass.second) {
+                    if (x == op) {
+                        c = keyword;
+                    }
+                    keyword += 1;
+                }
+            }
+        }
+        result.push_back(c);
+    }
+    return result;
+}
+
+// The same rewrites evaluating the expression used to do, first parenthesized
+// groups and then each class of operators, but substituting nodes instead of values.
+// `elements` are indices into condition.nodes, and only argument nodes can match
+// a parenthesis or an operator
+int CMakeParser::Interpreter::parseCondition(Condition& condition, const std::vector<int>& elements, const std::vector<std::string>& exprs) {
+    auto text = [&](int i) -> std::string_view {
+        const Condition::Node& node = condition.nodes[elements[i]];
+        return node.kind == Condition::Node::argument ? std::string_view(exprs[node.argumentIndex]) : std::string_view();
+    };
+    // Replaces elements [i, j) with `node`, and recurses
+    auto substitute = [&](Condition::Node node, int i, int j) {
+        std::vector<int> newElements(elements.begin(), elements.begin() + i);
+        newElements.push_back((int)condition.nodes.size());
+        condition.nodes.push_back(node);
+        newElements.insert(newElements.end(), elements.begin() + j, elements.end());
+        return parseCondition(condition, newElements, exprs);
+    };
     
     // Look for parentheses
     int lparenCount = 0;
     int lparenFirstLocation = -1;
-    for (int i = 0; i < exprs.size(); i++) {
-        std::string curToken = exprs[i];
+    for (int i = 0; i < elements.size(); i++) {
+        std::string_view curToken = text(i);
         if (curToken == "(") {
             if (lparenCount == 0) {
                 lparenFirstLocation = i;
@@ -1777,20 +2366,12 @@ bool CMakeParser::Interpreter::evaluateBooleanExpression(const std::vector<std::
         } else if (curToken == ")") {
             lparenCount -= 1;
             // The first time the parentheses are balanced,
-            // evaluate that subexpression, substitute into the original expression,
+            // parse that subexpression, substitute into the original expression,
             // and recurse
             if (lparenCount == 0) {
-                std::vector<std::string> toRecurse = std::vector<std::string>(exprs.begin() + lparenFirstLocation + 1, exprs.begin() + i);
-                if (CMAKEPARSER_INTERPRETER_DEBUGPRINT) {
-                    std::cout << "Paren recurse: [";
-                    for (const auto& x : toRecurse) {
-                        std::cout << x << ", ";
-                    }
-                    std::cout << "]" << std::endl;
-                }
-                bool recurseResult = evaluateBooleanExpression(toRecurse);
-                std::vector<std::string> newExprs = substituteBooleanValue(recurseResult, exprs, lparenFirstLocation, i + 1);
-                return evaluateBooleanExpression(newExprs);
+                std::vector<int> toRecurse(elements.begin() + lparenFirstLocation + 1, elements.begin() + i);
+                int group = parseCondition(condition, toRecurse, exprs);
+                return substitute({.kind = Condition::Node::group, .right = group}, lparenFirstLocation, i + 1);
             }
         }
     }
@@ -1806,19 +2387,18 @@ bool CMakeParser::Interpreter::evaluateBooleanExpression(const std::vector<std::
     // Operators
     
     // For each class of operators...
-    for (const auto& operatorClass : operatorClasses) {
+    for (const auto& operatorClass : conditionOperatorClasses()) {
         bool isUnary = operatorClass.first;
-        const std::vector<std::string>& operators = operatorClass.second;
         
         // Move forwards through the expression...
-        for (int i = 0; i < exprs.size(); i++) {
+        for (int i = 0; i < elements.size(); i++) {
             // Looking for any operator that matches that part of the expression
-            for (const auto& op : operators) {
-                if (exprs[i] != op) {
+            for (const auto& op : operatorClass.second) {
+                if (text(i) != op) {
                     continue;
                 }
                 // Found a potential match
-                if (i + 1 >= exprs.size()) {
+                if (i + 1 >= elements.size()) {
                     // Can't be, because this operator requires
                     // a right operand
                     continue;
@@ -1830,19 +2410,18 @@ bool CMakeParser::Interpreter::evaluateBooleanExpression(const std::vector<std::
                 }
                 
                 // Definitely a match
-                std::string leftOp = isUnary ? "" : exprs[i - 1];
-                std::string rightOp = exprs[i + 1];
-                if (CMAKEPARSER_INTERPRETER_DEBUGPRINT) {
-                    std::cout << "Op recurse: " << leftOp << " " << op << " " << rightOp << std::endl;
-                }
-                bool opResult = evaluateOperation(leftOp, op, rightOp);
-                std::vector<std::string> newExprs = substituteBooleanValue(opResult, exprs, isUnary ? i : i - 1, i + 2);
-                return evaluateBooleanExpression(newExprs);
+                Condition::Node node = {
+                    .kind = Condition::Node::operation,
+                    .op = op,
+                    .left = isUnary ? -1 : elements[i - 1],
+                    .right = elements[i + 1],
+                };
+                return substitute(node, isUnary ? i : i - 1, i + 2);
             }
         }
     }
-        
-    if (exprs.size() != 1) {
+    
+    if (elements.size() != 1) {
         std::cerr << "Illegal boolean expression! [";
         for (const auto& x : exprs) {
             std::cerr << x << ", ";
@@ -1851,7 +2430,41 @@ bool CMakeParser::Interpreter::evaluateBooleanExpression(const std::vector<std::
         __builtin_trap();
     }
     
-    return evaluateSingleString(exprs[0]);
+    return elements[0];
+}
+
+bool CMakeParser::Interpreter::evaluateConditionNode(const Condition& condition, int node, const std::vector<std::string>& exprs) const {
+    const Condition::Node& n = condition.nodes[node];
+    switch (n.kind) {
+        case Condition::Node::argument:
+            return evaluateSingleString(exprs[n.argumentIndex]);
+            
+        case Condition::Node::group:
+            return evaluateConditionNode(condition, n.right, exprs);
+            
+        case Condition::Node::operation:
+        {
+            std::string leftOp = conditionOperand(condition, n.left, exprs);
+            std::string rightOp = conditionOperand(condition, n.right, exprs);
+            if (CMAKEPARSER_INTERPRETER_DEBUGPRINT) {
+                std::cout << "Op recurse: " << leftOp << " " << n.op << " " << rightOp << std::endl;
+            }
+            return evaluateOperation(leftOp, std::string(n.op), rightOp);
+        }
+    }
+}
+
+// Arguments are operands as they are, and anything already evaluated
+// is an operand as "TRUE" or "FALSE"
+std::string CMakeParser::Interpreter::conditionOperand(const Condition& condition, int node, const std::vector<std::string>& exprs) const {
+    if (node == -1) {
+        return "";
+    }
+    const Condition::Node& n = condition.nodes[node];
+    if (n.kind == Condition::Node::argument) {
+        return exprs[n.argumentIndex];
+    }
+    return evaluateConditionNode(condition, node, exprs) ? "TRUE" : "FALSE";
 }
 
 bool CMakeParser::Interpreter::evaluateSingleString(const std::string& x) const {
@@ -1873,8 +2486,8 @@ bool CMakeParser::Interpreter::evaluateSingleString(const std::string& x) const
     }
     
     // Variables, strings
-    const auto& it = variables.find(x);
-    if (it != variables.end() && !isFalseConstant(it->second)) {
+    const Variable* variable = variables.find(x);
+    if (variable && !isFalseConstant(variable->value)) {
         if (CMAKEPARSER_INTERPRETER_DEBUGPRINT) {
             std::cout << "TRUE" << std::endl;
         }
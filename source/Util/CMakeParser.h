@@ -22,8 +22,12 @@
 #define CMakeParser_h
 
 #include "Driver/Driver.h"
+#include <deque>
 #include <filesystem>
 #include <map>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
 
 // This is not a good CMake parser, and it definitely has lots of holes.
 // It's purpose built for the way Pixar uses CMake in OpenUSD, 
@@ -35,24 +39,64 @@ public:
     
     std::vector<std::filesystem::path> getListOfSourceFiles() const;
     std::vector<std::filesystem::path> getListOfPublicHeaders() const;
+    // Each library's name and source files, for building one AST per library
+    std::vector<std::pair<std::string, std::vector<std::filesystem::path>>> getSourceFilesByPxrLibrary() const;
     std::vector<std::string> getNamesOfPxrLibraries() const;
     std::vector<std::filesystem::path> getRelativePathsOfPxrLibraries() const;
     std::vector<std::filesystem::path> getPublicRelativeHeadersInLibrary(const std::filesystem::path& dir) const;
+    
+    // What CMake says about a public header or source file of an OpenUSD library
+    struct UsdFileInfo {
+        std::string libraryName;
+        // Listed in PUBLIC_HEADERS or PUBLIC_CLASSES, so Swift can include it
+        bool isPublic;
+        // Relative to the OpenUSD source repo, e.g. `pxr/usd/usd/stage.h`
+        std::string includePath;
+    };
+    // Hashed lookup by absolute path. Returns nullptr for files that aren't part of a library
+    const UsdFileInfo* getUsdFileInfo(std::string_view path) const;
+    
+    // Times tokenizing the largest CMakeLists.txt files in an OpenUSD checkout,
+    // and checks that the tokens match the reference tokenizer's
+    static void benchmarkTokenizer(const std::filesystem::path& usdSourceRepoPath);
         
 private:
     struct PxrLibrary;
+    // Lets _usdFileIndex be searched with a string_view
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view s) const { return std::hash<std::string_view>()(s); }
+    };
+    // What interpreting a single CMakeLists.txt produced. Each file is interpreted
+    // on its own, so this only depends on the file's contents
+    struct InterpretedCMakeLists {
+        std::vector<std::vector<std::string>> pxrLibraryArguments;
+        std::vector<std::string> addedSubdirectories;
+    };
+    struct ManifestEntry {
+        int64_t modificationTime;
+        uint64_t hash;
+        InterpretedCMakeLists interpreted;
+    };
+    
     const Driver* _driver;
     std::vector<PxrLibrary> _pxrLibraries;
+    std::unordered_map<std::string, UsdFileInfo, StringHash, std::equal_to<>> _usdFileIndex;
+    // Keyed by the path of each CMakeLists.txt, loaded from and written back to
+    // FileSystemInfo::getCMakeParserManifestPath(), so unchanged files aren't re-parsed
+    std::map<std::string, ManifestEntry> _manifest;
         
     void process(const std::filesystem::path& dir);
+    // Safe to call from multiple threads, as long as _manifest isn't being modified
+    ManifestEntry interpretCMakeLists(const std::filesystem::path& dir, bool* outWasReparsed) const;
+    void loadManifest();
+    void writeManifest() const;
+    void buildUsdFileIndex();
     void test();
     void serialize() const;
     
 private:
     struct Tokenizer {
-        struct Token;
-        static std::vector<Token> tokenize(const std::string& s);
-        
         struct Token {
             enum Kind {
                 space, // '[ \t]+'
@@ -72,15 +116,28 @@ private:
                 lineComment // # text
             };
             
-            Token(Kind kind, const std::string& text);
-            Token(Kind kind, unsigned char ch);
+            Token(Kind kind, std::string_view text);
             
             operator std::string() const;
             
-            std::string text;
+            std::string_view text;
             Kind kind;
         };
         
+        struct TokenStream {
+            std::vector<Token> tokens;
+            // Arguments with escape sequences can't view the tokenized text,
+            // so they view their unescaped text here instead
+            std::deque<std::string> rewrittenText;
+        };
+        
+        // The tokens view `s`, so it must outlive the returned TokenStream
+        static TokenStream tokenize(std::string_view s);
+        // The original tokenizer, which copies the text of every token.
+        // Kept so test() and benchmarkTokenizer() can check tokenize() against it
+        static std::vector<std::pair<Token::Kind, std::string>> referenceTokenize(const std::string& s);
+        static bool matchesReferenceTokenizer(const std::string& s);
+        
         struct DFAState {
             DFAState();
             
@@ -106,28 +163,29 @@ private:
     
     struct CommandInvocationBuilder {
         struct CommandInvocation;
-        static std::vector<CommandInvocation> build(std::vector<Tokenizer::Token> tokens);
+        static std::vector<CommandInvocation> build(const std::vector<Tokenizer::Token>& tokens);
         
         struct CommandInvocation {
             struct Argument;
-            CommandInvocation(const std::string& name, std::vector<Argument> arguments);
+            CommandInvocation(std::string_view name, std::vector<Argument> arguments);
             
+            // Views into the TokenStream the command was built from
             struct Argument {
-                std::string text;
+                std::string_view text;
                 bool isUnquoted;
                 bool isQuoted;
                 bool isBracket;
                 
-                static Argument quoted(const std::string& text);
-                static Argument unquoted(const std::string& text);
-                static Argument bracket(const std::string& text);
+                static Argument quoted(std::string_view text);
+                static Argument unquoted(std::string_view text);
+                static Argument bracket(std::string_view text);
                 
             private:
-                Argument(const std::string& text);
+                Argument(std::string_view text);
             };
             
             std::string lowercaseName;
-            std::string _rawName;
+            std::string_view _rawName;
             std::vector<Argument> arguments;
             
             operator std::string() const;
@@ -145,7 +203,7 @@ private:
             };
             
             bool justHadComment;
-            std::string commandInvocationName;
+            std::string_view commandInvocationName;
             std::vector<CommandInvocation::Argument> commandInvocationArguments;
             int commandInvocationLparenCount;
                         
@@ -181,31 +239,76 @@ private:
     struct Interpreter {
         Interpreter();
         
-        std::map<std::string, std::string> variables;
+        struct Variable {
+            std::string value;
+            // semicolonSplit(value), split the first time the variable is expanded as a list
+            mutable std::optional<std::vector<std::string>> list;
+        };
+        // Variable names are interned to dense ids the first time they're seen,
+        // so values live in a vector and each lookup only hashes the name.
+        // Functions and macros are skipped, so there's only ever one scope
+        struct VariableTable {
+            VariableTable() = default;
+            VariableTable(std::initializer_list<std::pair<std::string_view, std::string_view>> l);
+            
+            std::unordered_map<std::string, uint32_t, StringHash, std::equal_to<>> ids;
+            std::vector<Variable> values;
+            
+            const Variable* find(std::string_view name) const;
+            const Variable& set(std::string_view name, std::string value);
+        };
+        // An if() or elseif() condition, parsed into a tree once per predicate block.
+        // Leaves are indices into the expanded arguments, so the tree can be reused
+        // as long as the arguments expand to the same shape of parentheses and operators
+        struct Condition {
+            struct Node {
+                enum Kind { argument, group, operation };
+                Kind kind;
+                // argument: index into the expanded arguments
+                int argumentIndex = -1;
+                // operation
+                std::string_view op;
+                // operation: -1 for unary operators
+                int left = -1;
+                // group: the grouped node, operation: the right operand
+                int right = -1;
+            };
+            std::string shape;
+            std::vector<Node> nodes;
+            int root;
+        };
+        
+        VariableTable variables;
+        std::unordered_map<const BlockBuilder::Block*, Condition> conditions;
         std::vector<std::string> addedSubdirectories;
         std::vector<std::vector<std::string>> pxrLibraries;
         
         std::string interpretBlock(const BlockBuilder::Block& block);
         std::string interpretCommand(const CommandInvocationBuilder::CommandInvocation& command);
         std::vector<std::string> variableExpandArguments(const std::vector<CommandInvocationBuilder::CommandInvocation::Argument>& arguments) const;
-        std::vector<std::string> variableExpandIfNeeded(const std::string& s) const;
-        std::string varLookup(const std::string& s) const;
+        std::vector<std::string> variableExpandIfNeeded(std::string_view s) const;
+        const std::string& varLookup(std::string_view s) const;
         
         static std::string semicolonJoin(const std::vector<std::string>& l);
-        static std::vector<std::string> semicolonSplit(const std::string& s);
+        static std::vector<std::string> semicolonSplit(std::string_view s);
         
         bool isTrueConstant(const std::string& s) const;
         bool isFalseConstant(const std::string& s) const;
         
         int findControlFlowPointAfter(int pos, const BlockBuilder::Block& inBlock) const;
-        bool evaluateBooleanExpression(const std::vector<std::string>& exprs) const;
-        std::vector<std::string> substituteBooleanValue(bool v, const std::vector<std::string>& exprs, int i, int j) const;
+        bool evaluateCondition(const BlockBuilder::Block& predicateBlock, const std::vector<std::string>& exprs);
+        static std::string conditionShape(const std::vector<std::string>& exprs);
+        static int parseCondition(Condition& condition, const std::vector<int>& elements, const std::vector<std::string>& exprs);
+        bool evaluateConditionNode(const Condition& condition, int node, const std::vector<std::string>& exprs) const;
+        std::string conditionOperand(const Condition& condition, int node, const std::vector<std::string>& exprs) const;
         bool evaluateSingleString(const std::string& x) const;
         bool evaluateOperation(const std::string& leftOp, const std::string& op, const std::string& rightOp) const;
         
         bool parseRealNumber(const std::string& s, double* f) const;
         std::vector<int> parseVersion(const std::string& s) const;
         
+        // Every CMakeLists.txt starts with the same variables, so they're only interned once
+        static const VariableTable& defaultVariables();
     };
     
     struct PxrLibrary {
@@ -20,6 +20,7 @@
 
 #include "Util/ClangToolHelper.h"
 #include "Util/FileSystemInfo.h"
+#include "Util/ThreadPool.h"
 #include <fstream>
 #include <regex>
 #include <chrono>
@@ -29,6 +30,8 @@
 #include <iterator>
 #include <unistd.h>
 #include "clang/tooling/JSONCompilationDatabase.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/xxhash.h"
 
 
 
@@ -38,9 +41,16 @@ static llvm::cl::extrahelp commonHelp(clang::tooling::CommonOptionsParser::HelpM
 ClangToolHelper::ClangToolHelper(const Driver* driver, int argc, const char **argv) :
 _driver(driver),
 _isValid(true),
+_serializedASTFingerprint(0),
 _astUnits() {
     
-    std::unique_ptr<clang::ASTUnit> temp = loadAST();
+    if (_driver->isShardedASTBuildEnabled()) {
+        _isValid = loadOrBuildShardedAST();
+        return;
+    }
+    
+    std::filesystem::path path = _driver->getFileSystemInfo()->getSerializedASTPath();
+    std::unique_ptr<clang::ASTUnit> temp = loadAST(path);
     if (!temp) {
         temp = buildAndSaveAST();
         // Workaround: getAsString() for TagDecls that point at class lambdas
@@ -48,10 +58,11 @@ _astUnits() {
         // but absolute paths when ASTUnits are loaded from disk (e.g. loadAST()).
         // To have deserialization not break if you run this twice in a row without
         // clearing the serializedAnalysis, we always load from disk after building the AST. 
-        temp = loadAST();
+        temp = loadAST(path);
     }
     if (temp) {
         _astUnits.push_back(std::move(temp));
+        _serializedASTFingerprint = getFileFingerprint(path);
     } else {
         _isValid = false;
     }
@@ -62,13 +73,16 @@ ClangToolHelper::operator bool() const {
 }
 
 std::unique_ptr<clang::ASTUnit> ClangToolHelper::buildAST() {
+    return buildAST(_driver->getFileSystemInfo()->writeSourceFileListIntoFile(), {});
+}
+
+std::unique_ptr<clang::ASTUnit> ClangToolHelper::buildAST(const std::filesystem::path& path, const std::vector<std::string>& extraArguments) {
     // Just fake a compilation database, because the ClangTool insists on it
     std::string errorMessage;
     auto compilationDatabase = clang::tooling::FixedCompilationDatabase(".", {});
     
     
     const FileSystemInfo* fileSystemInfo = _driver->getFileSystemInfo();
-    std::filesystem::path path = fileSystemInfo->writeSourceFileListIntoFile();
     
     clang::tooling::ClangTool clangTool = clang::tooling::ClangTool(compilationDatabase,
                                                                     {path.string()});
@@ -88,6 +102,7 @@ std::unique_ptr<clang::ASTUnit> ClangToolHelper::buildAST() {
         // We need this because TfSingleton specializations might only be found in .cpp files, but we need
         // to see those to know if a type can safely be imported as immortal
         result.push_back("-ferror-limit=0");
+        result.insert(result.end(), extraArguments.begin(), extraArguments.end());
         return result;
     });
     
@@ -109,17 +124,19 @@ std::unique_ptr<clang::ASTUnit> ClangToolHelper::buildAST() {
     
     return std::move(units.front());
 }
-std::unique_ptr<clang::ASTUnit> ClangToolHelper::loadAST() {
-    std::filesystem::path path = _driver->getFileSystemInfo()->getSerializedASTPath();
+std::unique_ptr<clang::ASTUnit> ClangToolHelper::loadAST(const std::filesystem::path& path) {
     if (!std::filesystem::exists(path)) {
         return nullptr;
     }
     
     clang::CompilerInstance ci;
     ci.createDiagnostics();
+    // Don't create a Sema. Nothing here needs one, and with a Sema the ASTReader
+    // deserializes every decl with a given name as soon as it reads that identifier,
+    // instead of waiting until something asks for them
     std::unique_ptr<clang::ASTUnit> result = clang::ASTUnit::LoadFromASTFile(path, // Filename
                                                                              ci.getPCHContainerReader(), // PCHContainerRdr
-                                                                             clang::ASTUnit::LoadEverything, // ToLoad
+                                                                             clang::ASTUnit::LoadASTOnly, // ToLoad
                                                                              &ci.getDiagnostics(), // Diags
                                                                              ci.getFileSystemOpts(), // FileSystemOpts
                                                                              ci.getHeaderSearchOptsPtr(), // HSOpts
@@ -149,11 +166,97 @@ std::unique_ptr<clang::ASTUnit> ClangToolHelper::buildAndSaveAST() {
     return result;
 }
 
+bool ClangToolHelper::loadOrBuildShardedAST() {
+    // Every library's source files become their own AST, built on top of a PCH
+    // of all the public headers. That PCH is also the primary unit that passes traverse
+    const FileSystemInfo* fileSystemInfo = _driver->getFileSystemInfo();
+    std::filesystem::path prefixPath = fileSystemInfo->getSerializedShardPrefixASTPath();
+    std::vector<std::pair<std::string, std::filesystem::path>> shardInputs = fileSystemInfo->writeShardSourceFileListsIntoFiles();
+    
+    if (!std::filesystem::exists(prefixPath)) {
+        std::unique_ptr<clang::ASTUnit> prefix = buildAST(fileSystemInfo->writeShardPrefixIntoFile(), {});
+        if (!prefix) {
+            return false;
+        }
+        // Shards built against an older prefix can't be loaded anymore
+        for (const auto& it : shardInputs) {
+            std::filesystem::remove(fileSystemInfo->getSerializedShardASTPath(it.first));
+        }
+        prefix->Save(prefixPath.string());
+    }
+    
+    std::vector<std::string> shardArguments = {"-include-pch", prefixPath.string()};
+    std::vector<std::unique_ptr<clang::ASTUnit>> shards(shardInputs.size());
+    
+    {
+        ThreadPool threadPool(ThreadPool::defaultThreadCount());
+        for (uint64_t i = 0; i < shardInputs.size(); i++) {
+            std::filesystem::path shardPath = fileSystemInfo->getSerializedShardASTPath(shardInputs[i].first);
+            if (std::filesystem::exists(shardPath)) {
+                continue;
+            }
+            threadPool.enqueue([this, i, shardPath, &shardInputs, &shardArguments]() {
+                std::unique_ptr<clang::ASTUnit> shard = buildAST(shardInputs[i].second, shardArguments);
+                if (!shard) {
+                    std::cerr << "Error! Couldn't build AST shard for " << shardInputs[i].first << std::endl;
+                    __builtin_trap();
+                }
+                shard->Save(shardPath.string());
+            });
+        }
+        threadPool.waitUntilIdle();
+        
+        // Same workaround as the unsharded AST, always load what was just built from disk
+        for (uint64_t i = 0; i < shardInputs.size(); i++) {
+            threadPool.enqueue([this, i, &shardInputs, &shards]() {
+                shards[i] = loadAST(_driver->getFileSystemInfo()->getSerializedShardASTPath(shardInputs[i].first));
+            });
+        }
+        threadPool.waitUntilIdle();
+    }
+    
+    std::unique_ptr<clang::ASTUnit> prefix = loadAST(prefixPath);
+    if (!prefix) {
+        return false;
+    }
+    _astUnits.push_back(std::move(prefix));
+    _serializedASTFingerprint = getFileFingerprint(prefixPath);
+    
+    for (uint64_t i = 0; i < shardInputs.size(); i++) {
+        if (!shards[i]) {
+            std::cerr << "Error! Couldn't load AST shard for " << shardInputs[i].first << std::endl;
+            return false;
+        }
+        _astUnits.push_back(std::move(shards[i]));
+        _serializedASTFingerprint = _serializedASTFingerprint * 31 + getFileFingerprint(fileSystemInfo->getSerializedShardASTPath(shardInputs[i].first));
+    }
+    return true;
+}
+
+/* static */
+uint64_t ClangToolHelper::getFileFingerprint(const std::filesystem::path& path) {
+    // Hash the contents rather than trusting size and modification time, because
+    // a rebuilt AST can easily keep both while every DeclID in it moves.
+    // The file was just loaded, so this reads it back from the page cache
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> buffer = llvm::MemoryBuffer::getFile(path.string(),
+                                                                                           /*IsText*/ false,
+                                                                                           /*RequiresNullTerminator*/ false);
+    if (!buffer) {
+        std::cerr << "Error! Couldn't read " << path.string() << " to fingerprint it" << std::endl;
+        __builtin_trap();
+    }
+    return llvm::xxh3_64bits((*buffer)->getBuffer());
+}
+
 
 const std::vector<std::unique_ptr<clang::ASTUnit>>& ClangToolHelper::getASTUnits() const {
     return _astUnits;
 }
 
+uint64_t ClangToolHelper::getSerializedASTFingerprint() const {
+    return _serializedASTFingerprint;
+}
+
 void ClangToolHelper::addSystemIncludeArguments(clang::tooling::ClangTool& tool) const {
     tool.appendArgumentsAdjuster([=, this](const clang::tooling::CommandLineArguments& baseArgs, llvm::StringRef filename) {
         std::vector<std::string> result = baseArgs;
@@ -40,19 +40,30 @@ public:
         
     explicit operator bool() const;
     
+    // With `--sharded-ast`, the first unit holds the public headers and the rest
+    // are per-library shards (see ASTShardIndex). Otherwise, there's exactly one unit
     const std::vector<std::unique_ptr<clang::ASTUnit>>& getASTUnits() const;
     
+    // Identifies the serialized AST that was loaded. Anything keyed by IDs from
+    // the serialized AST (like DeclIDs) is only valid while this doesn't change
+    uint64_t getSerializedASTFingerprint() const;
 
 private:
     std::unique_ptr<clang::ASTUnit> buildAndSaveAST();
-    std::unique_ptr<clang::ASTUnit> loadAST();
+    std::unique_ptr<clang::ASTUnit> loadAST(const std::filesystem::path& path);
     std::unique_ptr<clang::ASTUnit> buildAST();
+    std::unique_ptr<clang::ASTUnit> buildAST(const std::filesystem::path& path, const std::vector<std::string>& extraArguments);
+    
+    // `--sharded-ast`: the public headers are the first unit, followed by one unit per library
+    bool loadOrBuildShardedAST();
+    static uint64_t getFileFingerprint(const std::filesystem::path& path);
     
     void addSystemIncludeArguments(clang::tooling::ClangTool& tool) const;
     
 private:
     const Driver* _driver;
     bool _isValid;
+    uint64_t _serializedASTFingerprint;
     std::vector<std::unique_ptr<clang::ASTUnit>> _astUnits;
 };
 
@@ -22,6 +22,7 @@
 #include <iostream>
 #include <regex>
 #include <fstream>
+#include <sstream>
 
 #include "Util/FileSystemInfo.h"
 #include "Util/CMakeParser.h"
@@ -84,18 +85,58 @@ std::filesystem::path FileSystemInfo::getSerializedASTPath() const {
     return getClangDirectory() / "serializedAST";
 }
 
+std::filesystem::path FileSystemInfo::getSerializedShardPrefixASTPath() const {
+    return getShardedASTDirectory() / "Prefix.ast";
+}
+
+std::filesystem::path FileSystemInfo::getSerializedShardASTPath(const std::string& libraryName) const {
+    return getShardedASTDirectory() / (libraryName + ".ast");
+}
+
+std::filesystem::path FileSystemInfo::getSerializedNamedDeclIndexPath() const {
+    return getClangDirectory() / "serializedASTNamedDecls.bin";
+}
+
+std::filesystem::path FileSystemInfo::getSerializedTypeIndexPath() const {
+    return getClangDirectory() / "serializedASTTypes.bin";
+}
+
 std::filesystem::path FileSystemInfo::getSerializedAnalysisPath(const std::string& fileName) const {
     return getOutputFileDirectory() / "analysis" / fileName;
 }
 
+std::filesystem::path FileSystemInfo::getSerializedAnalysisCachePath(const std::string& fileName) const {
+    return getSerializedAnalysisPath(fileName).replace_extension(".bin");
+}
+
+std::filesystem::path FileSystemInfo::getSerializedAnalysisIncrementalRecordPath(const std::string& fileName) const {
+    return getSerializedAnalysisPath(fileName).replace_extension(".incremental.txt");
+}
+
 std::filesystem::path FileSystemInfo::getGeneratedCodeDirectory() const {
     return getOutputFileDirectory() / "codeGen";
 }
 
+std::filesystem::path FileSystemInfo::getGeneratedCodeManifestPath() const {
+    return getOutputFileDirectory() / "codeGenManifest.txt";
+}
+
+std::filesystem::path FileSystemInfo::getCMakeParserManifestPath() const {
+    return getOutputFileDirectory() / "cmakeParserManifest.txt";
+}
+
+std::filesystem::path FileSystemInfo::getTelemetryReportPath() const {
+    return getOutputFileDirectory() / "telemetry.json";
+}
+
 std::filesystem::path FileSystemInfo::getClangDirectory() const {
     return getOutputFileDirectory() / "clang";
 }
 
+std::filesystem::path FileSystemInfo::getShardedASTDirectory() const {
+    return getClangDirectory() / "shards";
+}
+
 std::filesystem::path FileSystemInfo::getClangInputFile() const {
     return getClangDirectory() / "Input.h";
 }
@@ -131,10 +172,38 @@ std::filesystem::path FileSystemInfo::writeSourceFileListIntoFile() const {
     
     std::filesystem::path result = getClangInputFile();
     std::cout << "Writing source files into " << result.string() << std::endl;
+    writeIncludesIntoFile(result, getListOfSourceFiles());
+    return result;
+}
+
+std::filesystem::path FileSystemInfo::writeShardPrefixIntoFile() const {
+    // Every shard starts with all the public headers, in the same order as
+    // writeSourceFileListIntoFile(), so they're only parsed once for the PCH
+    std::filesystem::path result = getShardedASTDirectory() / "Prefix.h";
+    std::filesystem::create_directories(result.parent_path());
+    writeIncludesIntoFile(result, getListOfPublicHeaders());
+    return result;
+}
+
+std::vector<std::pair<std::string, std::filesystem::path>> FileSystemInfo::writeShardSourceFileListsIntoFiles() const {
+    std::vector<std::pair<std::string, std::filesystem::path>> result;
+    std::filesystem::create_directories(getShardedASTDirectory());
     
-    std::ofstream outfile(result);
+    for (const auto& it : _driver->getCMakeParser()->getSourceFilesByPxrLibrary()) {
+        if (it.second.empty()) {
+            continue;
+        }
+        std::filesystem::path path = getShardedASTDirectory() / (it.first + ".h");
+        writeIncludesIntoFile(path, it.second);
+        result.push_back({it.first, path});
+    }
+    return result;
+}
+
+void FileSystemInfo::writeIncludesIntoFile(const std::filesystem::path& file, const std::vector<std::filesystem::path>& paths) const {
+    std::stringstream outfile;
     
-    for (const std::filesystem::path& path : getListOfSourceFiles()) {
+    for (const std::filesystem::path& path : paths) {
         std::string relativePath = path.string();
         
         // Use `+ 1` to include trim leading slash
@@ -148,8 +217,18 @@ std::filesystem::path FileSystemInfo::writeSourceFileListIntoFile() const {
         
         outfile << "#include \"" << relativePath << "\"" << std::endl;
     }
-    outfile.close();
-    return result;
+    
+    // Leave unchanged files alone, because serialized ASTs remember
+    // the modification times of their inputs
+    std::ifstream existingFile(file);
+    std::stringstream existing;
+    existing << existingFile.rdbuf();
+    if (existingFile && existing.str() == outfile.str()) {
+        return;
+    }
+    existingFile.close();
+    
+    std::ofstream(file) << outfile.str();
 }
 
 std::vector<std::filesystem::path> FileSystemInfo::getListOfSourceFiles() const {
@@ -161,3 +240,14 @@ std::vector<std::filesystem::path> FileSystemInfo::getListOfPublicHeaders() cons
     const CMakeParser* cmakeParser = _driver->getCMakeParser();
     return cmakeParser->getListOfPublicHeaders();
 }
+
+std::string FileSystemInfo::makePathRelativeForUsd(const std::string& p) const {
+    for (const std::filesystem::path* prefix : {&usdSourceRepoPath, &usdInstalledHeaderPath}) {
+        const std::string& prefixString = prefix->native();
+        if (p.starts_with(prefixString)) {
+            return p.substr(prefixString.size() + 1);
+        }
+    }
+    
+    return "";
+}
@@ -50,21 +50,45 @@ public:
     
     // MARK: Queries
     std::vector<std::filesystem::path> getListOfPublicHeaders() const;
+    // Strips the OpenUSD source repo or installed header directory, e.g. to `pxr/usd/usd/stage.h`.
+    // Returns the empty string for paths outside of OpenUSD
+    std::string makePathRelativeForUsd(const std::string& p) const;
 
     // MARK: Serialization
     std::filesystem::path getOutputFileDirectory() const;
     std::filesystem::path getSerializedASTPath() const;
+    // With `--sharded-ast`, the public headers are the prefix of every per-library shard
+    std::filesystem::path getSerializedShardPrefixASTPath() const;
+    std::filesystem::path getSerializedShardASTPath(const std::string& libraryName) const;
+    // FindNamedDecls' name -> DeclID tables, which are only valid for one serialized AST
+    std::filesystem::path getSerializedNamedDeclIndexPath() const;
+    std::filesystem::path getSerializedTypeIndexPath() const;
     std::filesystem::path getSerializedAnalysisPath(const std::string& fileName) const;
+    // Binary cache that sits next to the text file from getSerializedAnalysisPath()
+    std::filesystem::path getSerializedAnalysisCachePath(const std::string& fileName) const;
+    // What each result in the text file was computed from, for `--incremental` runs
+    std::filesystem::path getSerializedAnalysisIncrementalRecordPath(const std::string& fileName) const;
     std::filesystem::path getGeneratedCodeDirectory() const;
+    // Hashes of the generated files from the last run (see GeneratedFileManifest)
+    std::filesystem::path getGeneratedCodeManifestPath() const;
+    // What each CMakeLists.txt in OpenUSD interpreted to on the last run (see CMakeParser)
+    std::filesystem::path getCMakeParserManifestPath() const;
+    // Per-pass timings from the last run (see Telemetry)
+    std::filesystem::path getTelemetryReportPath() const;
     
 private:
     std::filesystem::path getClangDirectory() const;
+    std::filesystem::path getShardedASTDirectory() const;
     std::filesystem::path getClangInputFile() const;
     std::filesystem::path getCustomClangIncludeDirectory() const;
         
 private:
     // MARK: Operations
     std::filesystem::path writeSourceFileListIntoFile() const;
+    std::filesystem::path writeShardPrefixIntoFile() const;
+    // Pairs of library names and the file that includes that library's source files
+    std::vector<std::pair<std::string, std::filesystem::path>> writeShardSourceFileListsIntoFiles() const;
+    void writeIncludesIntoFile(const std::filesystem::path& file, const std::vector<std::filesystem::path>& paths) const;
     std::vector<std::filesystem::path> getListOfSourceFiles() const;
     
     friend class ClangToolHelper;
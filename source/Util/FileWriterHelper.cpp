@@ -19,13 +19,16 @@
 //===----------------------------------------------------------------------===//
 
 #include "FileWriterHelper.h"
+#include "Util/GeneratedFileManifest.h"
 #include <algorithm>
 #include <iostream>
 
 FileWriterHelper::FileWriterHelper(const std::string& fileName) :
 _fileName(fileName),
 _openFileSuffix(""),
-_writesPrologue(true)
+_writesPrologue(true),
+_buffersOutput(false),
+_manifest(nullptr)
 {}
 
 FileWriterHelper::FileWriterHelper(const std::filesystem::path& directory, 
@@ -33,7 +36,9 @@ FileWriterHelper::FileWriterHelper(const std::filesystem::path& directory,
 _fileName(fileName),
 _openFileSuffix(""),
 _directory(directory),
-_writesPrologue(true)
+_writesPrologue(true),
+_buffersOutput(false),
+_manifest(nullptr)
 {}
 
 FileWriterHelper::~FileWriterHelper() {
@@ -41,6 +46,10 @@ FileWriterHelper::~FileWriterHelper() {
         std::cerr << "Error! Dtor while file is open" << std::endl;
         __builtin_trap();
     }
+    if (!_bufferedFiles.empty()) {
+        std::cerr << "Error! Dtor with buffered files that were never written" << std::endl;
+        __builtin_trap();
+    }
 }
 
 void FileWriterHelper::setDirectory(const std::filesystem::path &directory) {
@@ -84,19 +93,10 @@ void FileWriterHelper::openDocCFile() {
     _openFile("md");
 }
 
-void FileWriterHelper::addLine(const std::string &line) {
-    if (!hasOpenFile()) {
-        std::cerr << "Error! File is closed (addLine)" << std::endl;
-        __builtin_trap();
-    }
-    
-    // Deduplicate platform guarding
-     if (__lines.size() && "#endif // " + line == __lines.back()) {
-         __lines.pop_back();
-         return;
-     }
-    
-    __lines.push_back(line);
+void FileWriterHelper::addLine(std::string_view line) {
+    _beginLine();
+    _buffer.append(line);
+    _endLine();
 }
 
 void FileWriterHelper::addLines(const std::vector<std::string> &lines) {
@@ -111,15 +111,17 @@ void FileWriterHelper::closeFile() {
         __builtin_trap();
     }
     addLines(_getEpilogue());
+    _lineStarts.clear();
     
-    for (const std::string& line : __lines) {
-        _stream << line << std::endl;
+    std::filesystem::path path = _directory / _fileNameWithSuffix();
+    if (_buffersOutput) {
+        _bufferedFiles.push_back({path, std::move(_buffer)});
+    } else {
+        bool didWrite = _writeFileIfChanged(path, _buffer);
+        std::cout << "Closed " << path.string();
+        std::cout << (didWrite ? " for writing." : " without changes.") << std::endl;
     }
-    __lines.clear();
-    
-    _stream.close();
-    std::cout << "Closed " << (_directory / _fileNameWithSuffix()).string();
-    std::cout << " for writing." << std::endl;
+    _buffer.clear();
         
     _openFileSuffix = "";
 }
@@ -141,6 +143,32 @@ void FileWriterHelper::setWritesPrologue(bool newValue) {
     _writesPrologue = newValue;
 }
 
+bool FileWriterHelper::getBuffersOutput() const {
+    return _buffersOutput;
+}
+
+void FileWriterHelper::setBuffersOutput(bool newValue) {
+    if (hasOpenFile()) {
+        std::cerr << "Error! File is open (setBuffersOutput)" << std::endl;
+        __builtin_trap();
+    }
+    _buffersOutput = newValue;
+}
+
+void FileWriterHelper::writeBufferedFiles() {
+    for (const auto& [path, contents] : _bufferedFiles) {
+        std::cout << "Opening " << path.string() << " for writing..." << std::endl;
+        bool didWrite = _writeFileIfChanged(path, contents);
+        std::cout << "Closed " << path.string();
+        std::cout << (didWrite ? " for writing." : " without changes.") << std::endl;
+    }
+    _bufferedFiles.clear();
+}
+
+void FileWriterHelper::setManifest(GeneratedFileManifest* manifest) {
+    _manifest = manifest;
+}
+
 std::vector<std::string> FileWriterHelper::_getPrologue() const {
     std::vector<std::string> result = {
         "//===----------------------------------------------------------------------===//",
@@ -220,10 +248,10 @@ void FileWriterHelper::_openFile(const std::string& suffix) {
     }
     _openFileSuffix = suffix;
     
-    std::cout << "Opening " << (_directory / _fileNameWithSuffix()).string();
-    std::cout << " for writing..." << std::endl;
-    std::filesystem::create_directories(_directory);
-    _stream.open(_directory / _fileNameWithSuffix());
+    if (!_buffersOutput) {
+        std::cout << "Opening " << (_directory / _fileNameWithSuffix()).string();
+        std::cout << " for writing..." << std::endl;
+    }
     
     if (_writesPrologue) {
         addLines(_getPrologue());
@@ -233,3 +261,88 @@ void FileWriterHelper::_openFile(const std::string& suffix) {
 std::string FileWriterHelper::_fileNameWithSuffix() const {
     return _fileName + "." + _openFileSuffix;
 }
+
+void FileWriterHelper::_beginLine() {
+    if (!hasOpenFile()) {
+        std::cerr << "Error! File is closed (addLine)" << std::endl;
+        __builtin_trap();
+    }
+    _lineStarts.push_back(_buffer.size());
+}
+
+void FileWriterHelper::_endLine() {
+    // If this line is `guard` and the previous line is `#endif // guard`,
+    // the two cancel out and the guard carries on. Lines are compared in
+    // the buffer, since they're only ever written into it
+    static constexpr std::string_view endifPrefix = "#endif // ";
+    uint64_t lineStart = _lineStarts.back();
+    uint64_t lineLength = _buffer.size() - lineStart;
+    if (_lineStarts.size() >= 2) {
+        uint64_t previousLineStart = _lineStarts[_lineStarts.size() - 2];
+        // The previous line's length, not counting its newline
+        uint64_t previousLineLength = lineStart - previousLineStart - 1;
+        if (previousLineLength == endifPrefix.size() + lineLength &&
+            _buffer.equals(previousLineStart, endifPrefix) &&
+            _buffer.equals(previousLineStart + endifPrefix.size(), lineStart, lineLength)) {
+            _buffer.truncate(previousLineStart);
+            _lineStarts.resize(_lineStarts.size() - 2);
+            return;
+        }
+    }
+    _buffer.push_back('\n');
+}
+
+bool FileWriterHelper::_writeFileIfChanged(const std::filesystem::path& path, const OutputBuffer& contents) {
+    uint64_t hash = contents.hash();
+    
+    std::error_code errorCode;
+    uint64_t existingSize = std::filesystem::file_size(path, errorCode);
+    bool isUnchanged = false;
+    if (!errorCode && existingSize == contents.size()) {
+        if (_manifest && _manifest->isUpToDate(path, hash, contents.size())) {
+            isUnchanged = true;
+        } else {
+            // No manifest entry, or the file was touched since, so compare the contents themselves
+            std::ifstream stream(path, std::ios::binary);
+            std::string existingChunk;
+            isUnchanged = true;
+            contents.forEachChunk([&stream, &existingChunk, &isUnchanged](std::string_view chunk) {
+                if (!isUnchanged) {
+                    return;
+                }
+                existingChunk.resize(chunk.size());
+                stream.read(existingChunk.data(), existingChunk.size());
+                isUnchanged = stream && existingChunk == chunk;
+            });
+        }
+    }
+    
+    if (!isUnchanged) {
+        // Write to a temporary file and rename it into place, so
+        // readers never see a partially written file
+        std::filesystem::create_directories(path.parent_path());
+        std::filesystem::path tempPath = path;
+        tempPath += ".tmp";
+        {
+            std::ofstream stream(tempPath, std::ios::binary | std::ios::trunc);
+            contents.forEachChunk([&stream](std::string_view chunk) {
+                stream.write(chunk.data(), chunk.size());
+            });
+            stream.flush();
+            if (!stream) {
+                std::cerr << "Error! Couldn't write " << tempPath.string() << std::endl;
+                __builtin_trap();
+            }
+        }
+        std::filesystem::rename(tempPath, path, errorCode);
+        if (errorCode) {
+            std::cerr << "Error! Couldn't rename " << tempPath.string() << " to " << path.string() << ": " << errorCode.message() << std::endl;
+            __builtin_trap();
+        }
+    }
+    
+    if (_manifest) {
+        _manifest->record(path, hash, contents.size());
+    }
+    return !isUnchanged;
+}
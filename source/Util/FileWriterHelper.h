@@ -21,13 +21,20 @@
 #ifndef FileWriterHelper_h
 #define FileWriterHelper_h
 
+#include "Util/OutputBuffer.h"
 #include <vector>
 #include <string>
+#include <string_view>
 #include <filesystem>
+#include <format>
 #include <fstream>
+#include <iterator>
 #include <sstream>
 
-// Helper class for writing files. Automatically generates prelude and epilogues based on the file type. 
+class GeneratedFileManifest;
+
+// Helper class for writing files. Automatically generates prelude and epilogues based on the file type.
+// Files whose contents didn't change are left untouched, and changed files are replaced atomically
 class FileWriterHelper {
 public:
     FileWriterHelper(const std::string& fileName);
@@ -48,8 +55,15 @@ public:
     void openDocCFile();
     
     
-    void addLine(const std::string& line);
+    void addLine(std::string_view line);
     void addLines(const std::vector<std::string>& lines);
+    // Formats the line straight into the file, without building a temporary string
+    template <typename... Args>
+    void addFormattedLine(std::format_string<Args...> format, Args&&... args) {
+        _beginLine();
+        std::format_to(std::back_inserter(_buffer), format, std::forward<Args>(args)...);
+        _endLine();
+    }
     void closeFile();
     
     bool hasOpenFile() const;
@@ -58,9 +72,24 @@ public:
     bool getWritesPrologue() const;
     void setWritesPrologue(bool newValue);
     
+    // When buffering output, closed files are kept in memory until writeBufferedFiles()
+    bool getBuffersOutput() const;
+    void setBuffersOutput(bool newValue);
+    // Writes every buffered file to disk, in the order they were closed
+    void writeBufferedFiles();
+    
+    // Remembers the hash of every file written, so unchanged files can be skipped without reading them
+    void setManifest(GeneratedFileManifest* manifest);
+    
 private:
     void _openFile(const std::string& suffix);
     std::string _fileNameWithSuffix() const;
+    // Returns false if the file already had these contents
+    bool _writeFileIfChanged(const std::filesystem::path& path, const OutputBuffer& contents);
+    
+    void _beginLine();
+    // Deduplicates platform guarding
+    void _endLine();
     
     std::vector<std::string> _getPrologue() const;
     std::vector<std::string> _getEpilogue() const;
@@ -70,10 +99,14 @@ private:
     std::filesystem::path _directory;
     std::string _headerFileName;
     std::string _headerGuardToken;
-    std::ofstream _stream;
     bool _writesPrologue;
+    bool _buffersOutput;
+    std::vector<std::pair<std::filesystem::path, OutputBuffer>> _bufferedFiles;
+    GeneratedFileManifest* _manifest;
     
-    std::vector<std::string> __lines;
+    // The open file's contents so far, and where each line starts in it
+    OutputBuffer _buffer;
+    std::vector<uint64_t> _lineStarts;
 };
 
 #endif /* FileWriterHelper_h */
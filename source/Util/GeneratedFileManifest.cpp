@@ -0,0 +1,91 @@
+//===----------------------------------------------------------------------===//
+// This source file is part of github.com/apple/SwiftUsd-ast-answerer
+//
+// Copyright © 2025 Apple Inc. and the SwiftUsd-ast-answerer project authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//===----------------------------------------------------------------------===//
+
+#include "Util/GeneratedFileManifest.h"
+#include <fstream>
+#include <sstream>
+
+GeneratedFileManifest::GeneratedFileManifest(const std::filesystem::path& path) :
+    _path(path)
+{
+    // Each line is `hash size modificationTime path`. Malformed lines are ignored,
+    // which only means those files get compared against their contents
+    std::ifstream stream(path);
+    std::string line;
+    while (std::getline(stream, line)) {
+        std::istringstream lineStream(line);
+        Entry entry;
+        std::string filePath;
+        lineStream >> std::hex >> entry.hash >> std::dec >> entry.size >> entry.modificationTime;
+        lineStream.ignore(1);
+        std::getline(lineStream, filePath);
+        if (lineStream.fail() || filePath.empty()) {
+            continue;
+        }
+        _entries.insert_or_assign(filePath, entry);
+    }
+}
+
+bool GeneratedFileManifest::isUpToDate(const std::filesystem::path& path, uint64_t hash, uint64_t size) const {
+    int64_t modificationTime = _modificationTime(path);
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto& it = _entries.find(path.string());
+    return modificationTime != -1 &&
+           it != _entries.end() &&
+           it->second.hash == hash &&
+           it->second.size == size &&
+           it->second.modificationTime == modificationTime;
+}
+
+void GeneratedFileManifest::record(const std::filesystem::path& path, uint64_t hash, uint64_t size) {
+    int64_t modificationTime = _modificationTime(path);
+    std::lock_guard<std::mutex> lock(_mutex);
+    _entries.insert_or_assign(path.string(), Entry{hash, size, modificationTime});
+}
+
+bool GeneratedFileManifest::write() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    
+    // Write to a temporary file and rename it into place,
+    // so a crash can't leave behind a truncated manifest
+    std::filesystem::create_directories(_path.parent_path());
+    std::filesystem::path tempPath = _path;
+    tempPath += ".tmp";
+    {
+        std::ofstream stream(tempPath, std::ios::trunc);
+        for (const auto& [filePath, entry] : _entries) {
+            stream << std::hex << entry.hash << std::dec << " " << entry.size << " " << entry.modificationTime << " " << filePath << "\n";
+        }
+        if (!stream) {
+            return false;
+        }
+    }
+    
+    std::error_code errorCode;
+    std::filesystem::rename(tempPath, _path, errorCode);
+    return !errorCode;
+}
+
+/* static */
+int64_t GeneratedFileManifest::_modificationTime(const std::filesystem::path& path) {
+    std::error_code errorCode;
+    std::filesystem::file_time_type time = std::filesystem::last_write_time(path, errorCode);
+    return errorCode ? -1 : (int64_t) time.time_since_epoch().count();
+}
@@ -0,0 +1,63 @@
+//===----------------------------------------------------------------------===//
+// This source file is part of github.com/apple/SwiftUsd-ast-answerer
+//
+// Copyright © 2025 Apple Inc. and the SwiftUsd-ast-answerer project authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//===----------------------------------------------------------------------===//
+
+#ifndef GeneratedFileManifest_h
+#define GeneratedFileManifest_h
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+
+// Content hashes of the files code gens wrote on previous runs, kept under AstAnswererOutputs.
+// FileWriterHelper uses it to leave files whose contents didn't change untouched, because
+// bumping their modification times makes the downstream SwiftUsd build recompile them.
+// A file is only trusted to be unchanged if its size and modification time still match
+// what was recorded; otherwise FileWriterHelper compares against the file's contents
+class GeneratedFileManifest {
+public:
+    // Loads the manifest at `path`, if there is one
+    GeneratedFileManifest(const std::filesystem::path& path);
+    
+    // True if the file at `path` is known to hold contents with this hash
+    bool isUpToDate(const std::filesystem::path& path, uint64_t hash, uint64_t size) const;
+    // Records the file at `path` as holding contents with this hash, as of its current modification time
+    void record(const std::filesystem::path& path, uint64_t hash, uint64_t size);
+    
+    // Returns false if the manifest couldn't be written
+    bool write() const;
+    
+private:
+    struct Entry {
+        uint64_t hash;
+        uint64_t size;
+        int64_t modificationTime;
+    };
+    
+    static int64_t _modificationTime(const std::filesystem::path& path);
+    
+    std::filesystem::path _path;
+    mutable std::mutex _mutex;
+    // Sorted so the manifest is written in a stable order
+    std::map<std::string, Entry> _entries;
+};
+
+#endif /* GeneratedFileManifest_h */
@@ -22,6 +22,9 @@
 #include <random>
 #include <algorithm>
 #include <iostream>
+#include <chrono>
+#include <functional>
+#include <pthread.h>
 
 #define N_TRIALS_PER_TEST 100
 
@@ -89,6 +92,7 @@ void testNeighbors();
 void testGetAllNodes();
 void testFindStronglyConnectedComponents();
 void testHandcraftedNodeInMultipleSCCs();
+void testLongChain();
 
 void testStart(const std::string& s) {
     std::cout << "Testing " + s + "..." << std::endl;
@@ -107,6 +111,7 @@ void testDirectedGraph() {
     testGetAllNodes();
     testFindStronglyConnectedComponents();
     testHandcraftedNodeInMultipleSCCs();
+    testLongChain();
     
     testEnd("directed graph");
 }
@@ -493,3 +498,229 @@ void testHandcraftedNodeInMultipleSCCs() {
         }
     }    
 }
+
+// A chain deep enough to overflow the stack if findStronglyConnectedComponents recursed
+void testLongChain() {
+    const int length = 1000000;
+    DirectedGraph<int> directedGraph;
+    for (int i = 0; i + 1 < length; i++) {
+        directedGraph.addEdge(i, i + 1);
+    }
+    
+    std::vector<std::unique_ptr<std::set<int>>> outSCCs;
+    std::map<int, std::set<int>*> outToSCCMapping;
+    DirectedGraph<std::set<int>*> outDirectedGraph;
+    directedGraph.findStronglyConnectedComponents(outSCCs, outToSCCMapping, outDirectedGraph);
+    
+    assertTrue(outSCCs.size() == length, "long chain SCC count");
+    // Sinks come first
+    assertTrue(*outSCCs.front()->begin() == length - 1, "long chain first SCC");
+    assertTrue(*outSCCs.back()->begin() == 0, "long chain last SCC");
+    assertTrue(outDirectedGraph.hasEdge(outToSCCMapping[0], outToSCCMapping[1]), "long chain SCC hasEdge");
+    
+    // Closing the chain makes it one SCC
+    directedGraph.addEdge(length - 1, 0);
+    directedGraph.findStronglyConnectedComponents(outSCCs, outToSCCMapping, outDirectedGraph);
+    assertTrue(outSCCs.size() == 1, "long cycle SCC count");
+    assertTrue(outDirectedGraph.neighbors(outSCCs.front().get()).empty(), "long cycle SCC neighbors");
+}
+
+// MARK: Benchmark
+
+namespace {
+// The std::map/std::set adjacency list and recursive Tarjan that DirectedGraph
+// used to be, kept so the benchmark can time the two against each other
+template <typename T>
+class ReferenceDirectedGraph {
+public:
+    void addNode(T t) {
+        if (_toImplData.find(t) != _toImplData.end()) {
+            return;
+        }
+        uint64_t key = _implData.size();
+        _implData[key] = {};
+        _toImplData[t] = key;
+        _fromImplData[key] = t;
+    }
+    
+    void addEdge(const T& t, const T& u) {
+        addNode(t);
+        addNode(u);
+        
+        uint64_t tKey = _toImplData[t];
+        uint64_t uKey = _toImplData[u];
+        _implData[tKey].insert(uKey);
+    }
+    
+    bool hasEdge(const T& t, const T& u) {
+        if (_toImplData.find(t) == _toImplData.end() || _toImplData.find(u) == _toImplData.end()) {
+            return false;
+        }
+        return _implData[_toImplData[t]].contains(_toImplData[u]);
+    }
+    
+    void findStronglyConnectedComponents(std::vector<std::unique_ptr<std::set<T>>>& outSCCs,
+                                         std::map<T, std::set<T>*>& outToSCCMapping,
+                                         ReferenceDirectedGraph<std::set<T>*>& outDirectedGraph) const {
+        std::map<uint64_t, uint64_t> startIndex;
+        std::map<uint64_t, uint64_t> lowIndex;
+        std::vector<uint64_t> stack;
+        std::set<uint64_t> isOnStack;
+        
+        std::function<void(uint64_t)> process = [&](uint64_t n){
+            uint64_t thisStartIndex = startIndex.size();
+            startIndex[n] = thisStartIndex;
+            lowIndex[n] = thisStartIndex;
+            stack.push_back(n);
+            isOnStack.insert(n);
+            
+            for (uint64_t m : _implData.find(n)->second) {
+                if (!startIndex.contains(m)) {
+                    process(m);
+                    lowIndex[n] = std::min(lowIndex[n], lowIndex[m]);
+                    
+                } else if (isOnStack.contains(m)) {
+                    lowIndex[n] = std::min(lowIndex[n], lowIndex[m]);
+                }
+            }
+            
+            if (lowIndex[n] == startIndex[n]) {
+                outSCCs.push_back(std::make_unique<std::set<T>>());
+                uint64_t poppedNode;
+                do {
+                    poppedNode = stack.back();
+                    stack.pop_back();
+                    isOnStack.erase(poppedNode);
+                    
+                    const T& userNode = _fromImplData.find(poppedNode)->second;
+                    outSCCs.back()->insert(userNode);
+                    outToSCCMapping[userNode] = outSCCs.back().get();
+                    
+                } while (poppedNode != n);
+                
+                outDirectedGraph.addNode(outSCCs.back().get());
+            }
+        };
+        
+        for (const auto& it : _implData) {
+            if (!startIndex.contains(it.first)) {
+                process(it.first);
+            }
+        }
+        
+        for (const auto& it : _implData) {
+            for (uint64_t m : it.second) {
+                std::set<T>* nSCC = outToSCCMapping[_fromImplData.find(it.first)->second];
+                std::set<T>* mSCC = outToSCCMapping[_fromImplData.find(m)->second];
+                if (nSCC != mSCC) {
+                    outDirectedGraph.addEdge(nSCC, mSCC);
+                }
+            }
+        }
+    }
+    
+private:
+    std::map<uint64_t, std::set<uint64_t>> _implData;
+    std::map<T, uint64_t> _toImplData;
+    std::map<uint64_t, T> _fromImplData;
+};
+
+// The reference Tarjan recurses once per node on the DFS path, which can be
+// most of the graph, so it gets a thread with a stack big enough for that
+void runWithLargeStack(std::function<void()> f) {
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, size_t(1) << 31);
+    pthread_t thread;
+    auto trampoline = [](void* arg) -> void* {
+        (*static_cast<std::function<void()>*>(arg))();
+        return nullptr;
+    };
+    if (pthread_create(&thread, &attr, trampoline, &f) != 0) {
+        std::cerr << "Couldn't start the reference benchmark thread" << std::endl;
+        __builtin_trap();
+    }
+    pthread_join(thread, nullptr);
+    pthread_attr_destroy(&attr);
+}
+} // namespace
+
+// Times building, compacting, and finding the SCCs of random graphs shaped like
+// the Sendable dependency graph: many small cycles, and a few edges per node
+void benchmarkDirectedGraph() {
+    std::mt19937 gen(0);
+    
+    for (uint32_t nNodes : {100000, 1000000}) {
+        const uint32_t edgesPerNode = 4;
+        std::uniform_int_distribution<uint32_t> dist(0, nNodes - 1);
+        std::vector<std::pair<uint32_t, uint32_t>> edges;
+        edges.reserve((uint64_t)nNodes * edgesPerNode);
+        for (uint32_t i = 0; i < nNodes; i++) {
+            // Mostly edges to lower nodes, so the graph is mostly a DAG
+            for (uint32_t j = 0; j + 1 < edgesPerNode; j++) {
+                edges.push_back({i, dist(gen) % (i + 1)});
+            }
+            edges.push_back({i, dist(gen)});
+        }
+        
+        auto node = [](uint32_t i) { return reinterpret_cast<const void*>((uintptr_t)i + 1); };
+        auto time = [](const std::string& label, auto&& f) {
+            const auto start = std::chrono::steady_clock::now();
+            f();
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            std::cout << "    " << label << ": " << elapsed.count() << "s" << std::endl;
+        };
+        
+        std::cout << "DirectedGraph with " << nNodes << " nodes and " << edges.size() << " edges" << std::endl;
+        std::cout << "  DirectedGraph (CSR, iterative Tarjan)" << std::endl;
+        DirectedGraph<const void*> graph;
+        time("addEdge", [&]() {
+            for (const auto& [from, to] : edges) {
+                graph.addEdge(node(from), node(to));
+            }
+        });
+        time("first query", [&]() {
+            graph.hasEdge(node(0), node(1));
+        });
+        
+        std::vector<std::unique_ptr<std::set<const void*>>> outSCCs;
+        std::map<const void*, std::set<const void*>*> outToSCCMapping;
+        DirectedGraph<std::set<const void*>*> outDirectedGraph;
+        time("findStronglyConnectedComponents", [&]() {
+            graph.findStronglyConnectedComponents(outSCCs, outToSCCMapping, outDirectedGraph);
+        });
+        time("condensation neighbors", [&]() {
+            uint64_t nEdges = 0;
+            for (const auto& scc : outSCCs) {
+                outDirectedGraph.forEachNeighbor(scc.get(), [&nEdges](std::set<const void*>*) { nEdges++; });
+            }
+            std::cout << "    " << outSCCs.size() << " SCCs, " << nEdges << " condensation edges" << std::endl;
+        });
+        
+        std::cout << "  Reference (std::map/std::set, recursive Tarjan)" << std::endl;
+        runWithLargeStack([&]() {
+            ReferenceDirectedGraph<const void*> referenceGraph;
+            time("addEdge", [&]() {
+                for (const auto& [from, to] : edges) {
+                    referenceGraph.addEdge(node(from), node(to));
+                }
+            });
+            time("first query", [&]() {
+                referenceGraph.hasEdge(node(0), node(1));
+            });
+            
+            std::vector<std::unique_ptr<std::set<const void*>>> referenceSCCs;
+            std::map<const void*, std::set<const void*>*> referenceToSCCMapping;
+            ReferenceDirectedGraph<std::set<const void*>*> referenceDirectedGraph;
+            time("findStronglyConnectedComponents", [&]() {
+                referenceGraph.findStronglyConnectedComponents(referenceSCCs, referenceToSCCMapping, referenceDirectedGraph);
+            });
+            
+            // Both must produce the same partition in the same sinks-first order
+            assertTrue(referenceSCCs.size() == outSCCs.size(), "benchmark SCC count");
+            for (size_t i = 0; i < outSCCs.size(); i++) {
+                assertTrue(*referenceSCCs[i] == *outSCCs[i], "benchmark SCC contents");
+            }
+        });
+    }
+}
@@ -36,13 +36,21 @@
 // In phase 2, we walk the graph to produce the strongly connected components.
 // That's also building up the new graph, one strongly connected component at a time.
 
-// So, we use an adjacency list implementation, which is fast at adding nodes
-// but slow at removing nodes
+// The full USD type graph has millions of edges, so nodes get compact uint32_t ids
+// and edges are stored in compressed sparse row form: the neighbors of node n are
+// _edges[_edgeOffsets[n]] through _edges[_edgeOffsets[n + 1]], sorted and deduplicated.
+// addEdge() only appends to _pendingEdges, and the first query after adding edges
+// merges them into the CSR arrays. Queries are const but not thread-safe.
 
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
 #include <map>
+#include <memory>
 #include <set>
+#include <unordered_map>
+#include <utility>
 #include <vector>
-#include <algorithm>
 
 
 template <typename T>
@@ -50,152 +58,252 @@ class DirectedGraph {
 public:
     DirectedGraph() {}
     
-    uint64_t nodeCount() { return _implData.size(); }
+    uint64_t nodeCount() const { return _nodes.size(); }
     
-    bool isNode(const T& t) { return _toImplData.find(t) != _toImplData.end(); }
+    bool isNode(const T& t) const { return _toNodeID.find(t) != _toNodeID.end(); }
+    
+    void reserve(uint64_t nodeCount, uint64_t edgeCount) {
+        _toNodeID.reserve(nodeCount);
+        _nodes.reserve(nodeCount);
+        _pendingEdges.reserve(edgeCount);
+    }
     
     void addNode(T t) {
-        if (isNode(t)) {
-            return;
-        }
-        uint64_t key = _implData.size();
-        _implData[key] = {};
-        _toImplData[t] = key;
-        _fromImplData[key] = t;
+        _addNode(t);
     }
     
     void addEdge(const T& t, const T& u) {
-        addNode(t);
-        addNode(u);
-        
-        uint64_t tKey = _toImplData[t];
-        uint64_t uKey = _toImplData[u];
-        _implData[tKey].insert(uKey);
+        NodeID tID = _addNode(t);
+        NodeID uID = _addNode(u);
+        _pendingEdges.push_back({tID, uID});
     }
     
-    bool hasEdge(const T& t, const T& u) {
-        if (!isNode(t) || !isNode(u)) {
+    bool hasEdge(const T& t, const T& u) const {
+        auto tIt = _toNodeID.find(t);
+        auto uIt = _toNodeID.find(u);
+        if (tIt == _toNodeID.end() || uIt == _toNodeID.end()) {
             return false;
         }
-        uint64_t tKey = _toImplData[t];
-        uint64_t uKey = _toImplData[u];
-        return _implData[tKey].contains(uKey);
+        _compact();
+        return std::binary_search(_edgesBegin(tIt->second), _edgesEnd(tIt->second), uIt->second);
     }
     
-    std::set<T> neighbors(const T& t) {
-        if (!isNode(t)) {
-            return {};
-        }
-        uint64_t tKey = _toImplData[t];
+    std::set<T> neighbors(const T& t) const {
         std::set<T> result;
-        for (uint64_t uKey : _implData[tKey]) {
-            result.insert(_fromImplData[uKey]);
-        }
+        forEachNeighbor(t, [&result](const T& u) { result.insert(u); });
         return result;
     }
     
-    std::vector<T> getAllNodes() {
-        std::vector<T> result;
-        for (const auto& it : _toImplData) {
-            result.push_back(it.first);
+    // Calls f(u) for every edge from t to u, without allocating
+    template <typename F>
+    void forEachNeighbor(const T& t, F&& f) const {
+        auto it = _toNodeID.find(t);
+        if (it == _toNodeID.end()) {
+            return;
         }
-        return result;
+        _compact();
+        for (const NodeID* u = _edgesBegin(it->second); u != _edgesEnd(it->second); u++) {
+            f(_nodes[*u]);
+        }
+    }
+    
+    // In the order the nodes were added
+    std::vector<T> getAllNodes() const {
+        return _nodes;
     }
     
     void clear() {
-        _implData = {};
-        _toImplData = {};
-        _fromImplData = {};
+        _toNodeID = {};
+        _nodes = {};
+        _pendingEdges = {};
+        _edgeOffsets = {};
+        _edges = {};
     }
     
     void findStronglyConnectedComponents(std::vector<std::unique_ptr<std::set<T>>>& outSCCs,
                                          std::map<T, std::set<T>*>& outToSCCMapping,
                                          DirectedGraph<std::set<T>*>& outDirectedGraph
                                          ) const {
-        // Use Tarjan's algorithm for finding strongly connected components
+        // Use Tarjan's algorithm for finding strongly connected components,
+        // with an explicit stack so that long dependency chains can't overflow the call stack
         
         outSCCs.clear();
         outToSCCMapping.clear();
         outDirectedGraph.clear();
+        _compact();
         
-        std::map<uint64_t, uint64_t> startIndex; // The "time" when we started processing a given node
-        std::map<uint64_t, uint64_t> lowIndex; // The lowest time reachable from a given node to a node on the stack
-        std::vector<uint64_t> stack;
-        std::set<uint64_t> isOnStack;
-                
-        std::function<void(uint64_t)> process = [&](uint64_t n){
-            // Start bookkeeping for n
-            uint64_t thisStartIndex = startIndex.size();
-            startIndex[n] = thisStartIndex;
-            lowIndex[n] = thisStartIndex;
+        constexpr NodeID unvisited = UINT32_MAX;
+        NodeID nNodes = (NodeID)_nodes.size();
+        std::vector<NodeID> startIndex(nNodes, unvisited); // The "time" when we started processing a given node
+        std::vector<NodeID> lowIndex(nNodes); // The lowest time reachable from a given node to a node on the stack
+        std::vector<NodeID> sccIndex(nNodes); // Which SCC a node ended up in, once it's off the stack
+        std::vector<bool> isOnStack(nNodes);
+        std::vector<NodeID> stack;
+        
+        // A node being processed, and the next of its edges to look at
+        struct Frame {
+            NodeID n;
+            uint64_t nextEdge;
+        };
+        std::vector<Frame> callStack;
+        NodeID nextStartIndex = 0;
+        
+        auto startProcessing = [&](NodeID n) {
+            startIndex[n] = nextStartIndex;
+            lowIndex[n] = nextStartIndex;
+            nextStartIndex++;
             stack.push_back(n);
-            isOnStack.insert(n);
-            
-            for (uint64_t m : _implData.find(n)->second) {
-                // Depth-first search. Since there's an edge from n to m,
-                // m will be on the stack when it finishes,
-                // so min our low index
-                if (!startIndex.contains(m)) {
-                    process(m);
-                    lowIndex[n] = std::min(lowIndex[n], lowIndex[m]);
-                    
-                } else if (isOnStack.contains(m)) {
-                    lowIndex[n] = std::min(lowIndex[n], lowIndex[m]);
-                }
+            isOnStack[n] = true;
+            callStack.push_back({n, _edgeOffsets[n]});
+        };
+        
+        for (NodeID root = 0; root < nNodes; root++) {
+            if (startIndex[root] != unvisited) {
+                continue;
             }
+            startProcessing(root);
             
-            if (lowIndex[n] == startIndex[n]) {
-                // We're the start of a new SCC
-                outSCCs.push_back(std::make_unique<std::set<T>>());
-                uint64_t poppedNode;
-                do {
-                    // Pop down the stack until getting to ourselves,
-                    // adding to the SCC
-                    poppedNode = stack.back();
-                    stack.pop_back();
-                    isOnStack.erase(poppedNode);
-                    
-                    const T& userNode = _fromImplData.find(poppedNode)->second;
-                    outSCCs.back()->insert(userNode);
-                    outToSCCMapping[userNode] = outSCCs.back().get();
+            while (!callStack.empty()) {
+                Frame& frame = callStack.back();
+                NodeID n = frame.n;
+                
+                if (frame.nextEdge < _edgeOffsets[n + 1]) {
+                    // Depth-first search. Since there's an edge from n to m,
+                    // m will be on the stack when it finishes,
+                    // so min our low index
+                    NodeID m = _edges[frame.nextEdge];
+                    frame.nextEdge++;
+                    if (startIndex[m] == unvisited) {
+                        startProcessing(m);
+                    } else if (isOnStack[m]) {
+                        lowIndex[n] = std::min(lowIndex[n], startIndex[m]);
+                    }
+                    continue;
+                }
+                
+                if (lowIndex[n] == startIndex[n]) {
+                    // We're the start of a new SCC
+                    outSCCs.push_back(std::make_unique<std::set<T>>());
+                    NodeID poppedNode;
+                    do {
+                        // Pop down the stack until getting to ourselves,
+                        // adding to the SCC
+                        poppedNode = stack.back();
+                        stack.pop_back();
+                        isOnStack[poppedNode] = false;
+                        sccIndex[poppedNode] = (NodeID)(outSCCs.size() - 1);
+                        
+                        const T& userNode = _nodes[poppedNode];
+                        outSCCs.back()->insert(userNode);
+                        outToSCCMapping[userNode] = outSCCs.back().get();
+                        
+                    } while (poppedNode != n);
                     
-                } while (poppedNode != n);
+                    // outDirectedGraph's node ids are the same as the SCC indices
+                    outDirectedGraph.addNode(outSCCs.back().get());
+                }
                 
-                outDirectedGraph.addNode(outSCCs.back().get());
-            }
-        };
-        
-        // Process all the nodes
-        for (const auto& it : _implData) {
-            if (!startIndex.contains(it.first)) {
-                process(it.first);
+                // Return to the node that found us
+                callStack.pop_back();
+                if (!callStack.empty()) {
+                    NodeID parent = callStack.back().n;
+                    lowIndex[parent] = std::min(lowIndex[parent], lowIndex[n]);
+                }
             }
         }
         
-        // Add external edges between the SCCs
-        for (const auto& it : _implData) {
-            uint64_t n = it.first;
-            for (uint64_t m : it.second) {
-                std::set<T>* nSCC = outToSCCMapping[_fromImplData.find(n)->second];
-                std::set<T>* mSCC = outToSCCMapping[_fromImplData.find(m)->second];
-                if (nSCC != mSCC) {
-                    outDirectedGraph.addEdge(nSCC, mSCC);
+        // Add external edges between the SCCs, which get deduplicated
+        // when outDirectedGraph is next queried
+        for (NodeID n = 0; n < nNodes; n++) {
+            for (const NodeID* m = _edgesBegin(n); m != _edgesEnd(n); m++) {
+                if (sccIndex[n] != sccIndex[*m]) {
+                    outDirectedGraph._pendingEdges.push_back({sccIndex[n], sccIndex[*m]});
                 }
             }
         }
     }
     
 private:
-    // Nodes are uint64_t, and they have directed edges stored in the edge set
-    std::map<uint64_t, std::set<uint64_t>> _implData;
-    
-    // The interface hides the uint64_t backing, so
-    // we want to efficiently map between the backing
-    // and the user's node type
-    std::map<T, uint64_t> _toImplData;
-    std::map<uint64_t, T> _fromImplData;
+    template <typename U>
+    friend class DirectedGraph;
+    
+    using NodeID = uint32_t;
+    
+    std::unordered_map<T, NodeID> _toNodeID;
+    std::vector<T> _nodes;
+    
+    // Edges that haven't been merged into the CSR arrays yet
+    mutable std::vector<std::pair<NodeID, NodeID>> _pendingEdges;
+    // Has _nodes.size() + 1 entries once compacted
+    mutable std::vector<uint64_t> _edgeOffsets;
+    mutable std::vector<NodeID> _edges;
+    
+    NodeID _addNode(const T& t) {
+        auto [it, inserted] = _toNodeID.try_emplace(t, (NodeID)_nodes.size());
+        if (inserted) {
+            if (_nodes.size() >= UINT32_MAX) {
+                std::cerr << "Error! DirectedGraph is full" << std::endl;
+                __builtin_trap();
+            }
+            _nodes.push_back(t);
+        }
+        return it->second;
+    }
+    
+    const NodeID* _edgesBegin(NodeID n) const { return _edges.data() + _edgeOffsets[n]; }
+    const NodeID* _edgesEnd(NodeID n) const { return _edges.data() + _edgeOffsets[n + 1]; }
+    
+    // Merges _pendingEdges into the CSR arrays with a counting sort by source node
+    void _compact() const {
+        if (_pendingEdges.empty() && _edgeOffsets.size() == _nodes.size() + 1) {
+            return;
+        }
+        uint64_t nNodes = _nodes.size();
+        
+        std::vector<uint64_t> offsets(nNodes + 1, 0);
+        for (uint64_t n = 0; n + 1 < _edgeOffsets.size(); n++) {
+            offsets[n + 1] += _edgeOffsets[n + 1] - _edgeOffsets[n];
+        }
+        for (const auto& [from, to] : _pendingEdges) {
+            offsets[from + 1]++;
+        }
+        for (uint64_t n = 0; n < nNodes; n++) {
+            offsets[n + 1] += offsets[n];
+        }
+        
+        std::vector<NodeID> edges(offsets[nNodes]);
+        std::vector<uint64_t> insertionPoints(offsets.begin(), offsets.end() - 1);
+        for (uint64_t n = 0; n + 1 < _edgeOffsets.size(); n++) {
+            for (uint64_t i = _edgeOffsets[n]; i < _edgeOffsets[n + 1]; i++) {
+                edges[insertionPoints[n]++] = _edges[i];
+            }
+        }
+        for (const auto& [from, to] : _pendingEdges) {
+            edges[insertionPoints[from]++] = to;
+        }
+        
+        // Sort and deduplicate each row, sliding rows down over removed duplicates
+        uint64_t writeIndex = 0;
+        for (uint64_t n = 0; n < nNodes; n++) {
+            auto rowBegin = edges.begin() + offsets[n];
+            auto rowEnd = edges.begin() + offsets[n + 1];
+            std::sort(rowBegin, rowEnd);
+            rowEnd = std::unique(rowBegin, rowEnd);
+            offsets[n] = writeIndex;
+            writeIndex = std::move(rowBegin, rowEnd, edges.begin() + writeIndex) - edges.begin();
+        }
+        offsets[nNodes] = writeIndex;
+        edges.resize(writeIndex);
+        edges.shrink_to_fit();
+        
+        _edgeOffsets = std::move(offsets);
+        _edges = std::move(edges);
+        _pendingEdges = {};
+    }
 };
 
 void testDirectedGraph();
+void benchmarkDirectedGraph();
+
 
 #endif /* ast_answerer_Graph_h */
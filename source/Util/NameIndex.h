@@ -0,0 +1,191 @@
+//===----------------------------------------------------------------------===//
+// This source file is part of github.com/apple/SwiftUsd-ast-answerer
+//
+// Copyright © 2025 Apple Inc. and the SwiftUsd-ast-answerer project authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//===----------------------------------------------------------------------===//
+
+#ifndef NameIndex_h
+#define NameIndex_h
+
+#include <llvm/Support/xxhash.h>
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// A map from fully-qualified C++ names to values, for FindNamedDecls' hundreds of thousands
+// of names. Names are interned back to back in one arena with every occurrence of PXR_NS
+// replaced by a single byte, and looked up through an open-addressing hash table that
+// stores each name's hash, so most probes never compare strings.
+template <typename T>
+class NameIndex {
+public:
+    NameIndex() : _arena(), _entries(), _slots(_minimumSlotCount, _emptySlot) {}
+
+    uint64_t size() const {
+        return _entries.size();
+    }
+
+    void reserve(uint64_t n) {
+        _entries.reserve(n);
+        uint64_t slotCount = _slots.size();
+        while (slotCount < n * 2) {
+            slotCount *= 2;
+        }
+        if (slotCount != _slots.size()) {
+            _rehash(slotCount);
+        }
+    }
+
+    // Returns nullptr if the name isn't in the index
+    const T* find(std::string_view name) const {
+        std::string_view compressed = _compress(name);
+        uint64_t slot = _findSlot(compressed, _hash(compressed));
+        return _slots[slot] == _emptySlot ? nullptr : &_entries[_slots[slot]].value;
+    }
+    T* find(std::string_view name) {
+        return const_cast<T*>(static_cast<const NameIndex*>(this)->find(name));
+    }
+
+    void insert_or_assign(std::string_view name, const T& value) {
+        std::string_view compressed = _compress(name);
+        uint64_t hash = _hash(compressed);
+        uint64_t slot = _findSlot(compressed, hash);
+        if (_slots[slot] != _emptySlot) {
+            _entries[_slots[slot]].value = value;
+            return;
+        }
+
+        if (_arena.size() + compressed.size() > UINT32_MAX || _entries.size() >= UINT32_MAX) {
+            std::cerr << "Error! NameIndex is full" << std::endl;
+            __builtin_trap();
+        }
+        _slots[slot] = (uint32_t)_entries.size();
+        _entries.push_back({hash, (uint32_t)_arena.size(), (uint32_t)compressed.size(), value});
+        _arena.append(compressed);
+
+        // Keep the load factor at most 1/2
+        if (_entries.size() * 2 > _slots.size()) {
+            _rehash(_slots.size() * 2);
+        }
+    }
+
+    // Calls f(name, value) for every entry, in insertion order
+    template <typename F>
+    void forEach(F&& f) const {
+        for (const Entry& entry : _entries) {
+            f(_decompress(_compressedName(entry)), entry.value);
+        }
+    }
+
+    // Entries sorted by name, for output that should be stable between runs
+    std::vector<std::pair<std::string, T>> sortedEntries() const {
+        std::vector<std::pair<std::string, T>> result;
+        result.reserve(_entries.size());
+        forEach([&result](std::string name, const T& value) {
+            result.push_back({std::move(name), value});
+        });
+        std::sort(result.begin(), result.end(), [](const auto& l, const auto& r) { return l.first < r.first; });
+        return result;
+    }
+
+private:
+    struct Entry {
+        uint64_t hash;
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        T value;
+    };
+
+    static constexpr uint32_t _emptySlot = UINT32_MAX;
+    static constexpr uint64_t _minimumSlotCount = 16;
+    static constexpr char _pxrNsToken = '\x01';
+
+    std::string _arena;
+    std::vector<Entry> _entries;
+    // Indices into _entries. The size is always a power of two
+    std::vector<uint32_t> _slots;
+
+    static uint64_t _hash(std::string_view compressed) {
+        return llvm::xxh3_64bits(llvm::StringRef(compressed.data(), compressed.size()));
+    }
+
+    std::string_view _compressedName(const Entry& entry) const {
+        return std::string_view(_arena).substr(entry.nameOffset, entry.nameLength);
+    }
+
+    // Linear probing. Returns either the slot holding the name or the empty slot it would go in
+    uint64_t _findSlot(std::string_view compressed, uint64_t hash) const {
+        uint64_t mask = _slots.size() - 1;
+        for (uint64_t slot = hash & mask; ; slot = (slot + 1) & mask) {
+            uint32_t entryIndex = _slots[slot];
+            if (entryIndex == _emptySlot) {
+                return slot;
+            }
+            const Entry& entry = _entries[entryIndex];
+            if (entry.hash == hash && _compressedName(entry) == compressed) {
+                return slot;
+            }
+        }
+    }
+
+    void _rehash(uint64_t slotCount) {
+        _slots.assign(slotCount, _emptySlot);
+        uint64_t mask = slotCount - 1;
+        for (uint32_t i = 0; i < _entries.size(); i++) {
+            uint64_t slot = _entries[i].hash & mask;
+            while (_slots[slot] != _emptySlot) {
+                slot = (slot + 1) & mask;
+            }
+            _slots[slot] = i;
+        }
+    }
+
+    // The returned view is only valid until the next call on the same thread
+    static std::string_view _compress(std::string_view name) {
+        static thread_local std::string buffer;
+        buffer.clear();
+
+        constexpr std::string_view pxrNs = PXR_NS;
+        uint64_t start = 0;
+        for (uint64_t i = name.find(pxrNs); i != std::string_view::npos; i = name.find(pxrNs, start)) {
+            buffer.append(name.substr(start, i - start));
+            buffer.push_back(_pxrNsToken);
+            start = i + pxrNs.size();
+        }
+        buffer.append(name.substr(start));
+        return buffer;
+    }
+
+    static std::string _decompress(std::string_view compressed) {
+        std::string result;
+        result.reserve(compressed.size());
+        for (char c : compressed) {
+            if (c == _pxrNsToken) {
+                result.append(PXR_NS);
+            } else {
+                result.push_back(c);
+            }
+        }
+        return result;
+    }
+};
+
+#endif /* NameIndex_h */
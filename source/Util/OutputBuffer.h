@@ -0,0 +1,130 @@
+//===----------------------------------------------------------------------===//
+// This source file is part of github.com/apple/SwiftUsd-ast-answerer
+//
+// Copyright © 2025 Apple Inc. and the SwiftUsd-ast-answerer project authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//===----------------------------------------------------------------------===//
+
+#ifndef OutputBuffer_h
+#define OutputBuffer_h
+
+#include <llvm/Support/xxhash.h>
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// An append-only text buffer for generated files. Text is stored in fixed-size chunks,
+// so growing a large file never reallocates and copies everything written so far,
+// and byte `i` is always in chunk `i / _chunkSize`
+class OutputBuffer {
+public:
+    // For std::back_inserter, so std::format_to can write straight into the buffer
+    using value_type = char;
+    
+    OutputBuffer() : _chunks(), _size(0) {}
+    
+    uint64_t size() const {
+        return _size;
+    }
+    
+    void append(std::string_view s) {
+        while (!s.empty()) {
+            if (_chunks.empty() || _chunks.back().size() == _chunkSize) {
+                // Allocations this large are mapped lazily, so the untouched
+                // tail of a small file's only chunk doesn't take up memory
+                _chunks.emplace_back();
+                _chunks.back().reserve(_chunkSize);
+            }
+            std::string& chunk = _chunks.back();
+            uint64_t n = std::min<uint64_t>(s.size(), _chunkSize - chunk.size());
+            chunk.append(s.substr(0, n));
+            s.remove_prefix(n);
+            _size += n;
+        }
+    }
+    void push_back(char c) {
+        append(std::string_view(&c, 1));
+    }
+    
+    char operator[](uint64_t i) const {
+        return _chunks[i / _chunkSize][i % _chunkSize];
+    }
+    
+    // Whether the `length` bytes at `lhs` and `rhs` are the same
+    bool equals(uint64_t lhs, uint64_t rhs, uint64_t length) const {
+        for (uint64_t i = 0; i < length; i++) {
+            if ((*this)[lhs + i] != (*this)[rhs + i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+    // Whether the bytes at `offset` are `s`
+    bool equals(uint64_t offset, std::string_view s) const {
+        for (uint64_t i = 0; i < s.size(); i++) {
+            if ((*this)[offset + i] != s[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    // Drops everything after the first `newSize` bytes
+    void truncate(uint64_t newSize) {
+        while (!_chunks.empty() && (_chunks.size() - 1) * _chunkSize >= newSize) {
+            _chunks.pop_back();
+        }
+        if (!_chunks.empty()) {
+            _chunks.back().resize(newSize - (_chunks.size() - 1) * _chunkSize);
+        }
+        _size = std::min(_size, newSize);
+    }
+    void clear() {
+        _chunks.clear();
+        _size = 0;
+    }
+    
+    // Calls f(std::string_view) for each chunk, in order
+    template <typename F>
+    void forEachChunk(F&& f) const {
+        for (const std::string& chunk : _chunks) {
+            f(std::string_view(chunk));
+        }
+    }
+    
+    // A hash of the contents. Chunks are hashed separately, so nothing is copied
+    uint64_t hash() const {
+        if (_chunks.size() == 1) {
+            return llvm::xxh3_64bits(llvm::StringRef(_chunks[0]));
+        }
+        std::vector<uint64_t> chunkHashes;
+        chunkHashes.reserve(_chunks.size());
+        for (const std::string& chunk : _chunks) {
+            chunkHashes.push_back(llvm::xxh3_64bits(llvm::StringRef(chunk)));
+        }
+        return llvm::xxh3_64bits(llvm::StringRef((const char*) chunkHashes.data(), chunkHashes.size() * sizeof(uint64_t)));
+    }
+    
+private:
+    static constexpr uint64_t _chunkSize = 1 << 20;
+    
+    std::vector<std::string> _chunks;
+    uint64_t _size;
+};
+
+#endif /* OutputBuffer_h */
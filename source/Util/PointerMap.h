@@ -0,0 +1,142 @@
+//===----------------------------------------------------------------------===//
+// This source file is part of github.com/apple/SwiftUsd-ast-answerer
+//
+// Copyright © 2025 Apple Inc. and the SwiftUsd-ast-answerer project authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//===----------------------------------------------------------------------===//
+
+#ifndef PointerMap_h
+#define PointerMap_h
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+// A map from pointers to values, for analysis results that are looked up far more often
+// than they're iterated. Entries are stored contiguously and found through an open-addressing
+// table of indices, so lookups don't compare keys with Compare, and don't chase tree nodes.
+// Iteration is in Compare order like a std::map, but the entries are only sorted the first time
+// someone iterates after an insertion. Inserting invalidates iterators, and iterating after
+// inserting mutates the map, so finish writing before sharing the map with other threads.
+template <typename K, typename V, typename Compare>
+class PointerMap {
+public:
+    typedef std::pair<const K*, V> value_type;
+    typedef typename std::vector<value_type>::iterator iterator;
+    typedef typename std::vector<value_type>::const_iterator const_iterator;
+    
+    PointerMap() : _entries(), _slots(_minimumSlotCount, _emptySlot), _isSorted(true) {}
+    
+    uint64_t size() const { return _entries.size(); }
+    bool empty() const { return _entries.empty(); }
+    
+    iterator find(const K* key) {
+        uint32_t entryIndex = _slots[_findSlot(key)];
+        return entryIndex == _emptySlot ? _entries.end() : _entries.begin() + entryIndex;
+    }
+    const_iterator find(const K* key) const {
+        return const_cast<PointerMap*>(this)->find(key);
+    }
+    bool contains(const K* key) const {
+        return find(key) != end();
+    }
+    
+    iterator begin() { sort(); return _entries.begin(); }
+    iterator end() { return _entries.end(); }
+    const_iterator begin() const { sort(); return _entries.begin(); }
+    const_iterator end() const { return _entries.end(); }
+    
+    void insert_or_assign(const K* key, const V& value) {
+        uint64_t slot = _findSlot(key);
+        if (_slots[slot] != _emptySlot) {
+            _entries[_slots[slot]].second = value;
+            return;
+        }
+        
+        if (_entries.size() >= UINT32_MAX) {
+            std::cerr << "Error! PointerMap is full" << std::endl;
+            __builtin_trap();
+        }
+        _slots[slot] = (uint32_t)_entries.size();
+        _entries.push_back({key, value});
+        _isSorted = _isSorted && (_entries.size() == 1 || Compare()(_entries[_entries.size() - 2].first, key));
+        
+        // Keep the load factor at most 1/2
+        if (_entries.size() * 2 > _slots.size()) {
+            _rehash(_slots.size() * 2);
+        }
+    }
+    
+    void clear() {
+        _entries.clear();
+        _slots.assign(_minimumSlotCount, _emptySlot);
+        _isSorted = true;
+    }
+    
+    // Puts the entries in Compare order, if they aren't already
+    void sort() const {
+        if (_isSorted) {
+            return;
+        }
+        std::sort(_entries.begin(), _entries.end(), [](const value_type& l, const value_type& r) {
+            return Compare()(l.first, r.first);
+        });
+        _rehash(_slots.size());
+        _isSorted = true;
+    }
+    
+private:
+    static constexpr uint32_t _emptySlot = UINT32_MAX;
+    static constexpr uint64_t _minimumSlotCount = 16;
+    
+    // Sorting reorders the entries, which is invisible to readers
+    mutable std::vector<value_type> _entries;
+    // Indices into _entries. The size is always a power of two
+    mutable std::vector<uint32_t> _slots;
+    mutable bool _isSorted;
+    
+    static uint64_t _hash(const K* key) {
+        // Fibonacci hashing, since the low bits of pointers are mostly alignment
+        return ((uint64_t)(uintptr_t)key * 0x9E3779B97F4A7C15ull) >> 20;
+    }
+    
+    // Linear probing. Returns either the slot holding the key or the empty slot it would go in
+    uint64_t _findSlot(const K* key) const {
+        uint64_t mask = _slots.size() - 1;
+        for (uint64_t slot = _hash(key) & mask; ; slot = (slot + 1) & mask) {
+            uint32_t entryIndex = _slots[slot];
+            if (entryIndex == _emptySlot || _entries[entryIndex].first == key) {
+                return slot;
+            }
+        }
+    }
+    
+    void _rehash(uint64_t slotCount) const {
+        _slots.assign(slotCount, _emptySlot);
+        uint64_t mask = slotCount - 1;
+        for (uint32_t i = 0; i < _entries.size(); i++) {
+            uint64_t slot = _hash(_entries[i].first) & mask;
+            while (_slots[slot] != _emptySlot) {
+                slot = (slot + 1) & mask;
+            }
+            _slots[slot] = i;
+        }
+    }
+};
+
+#endif /* PointerMap_h */
@@ -0,0 +1,128 @@
+//===----------------------------------------------------------------------===//
+// This source file is part of github.com/apple/SwiftUsd-ast-answerer
+//
+// Copyright © 2025 Apple Inc. and the SwiftUsd-ast-answerer project authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//===----------------------------------------------------------------------===//
+
+#include "Util/Telemetry.h"
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sys/resource.h>
+
+// MARK: Measurement
+Telemetry::Measurement::Measurement(const Telemetry* telemetry, std::string name, std::string phase,
+                                    std::function<Counters()> sampleCounters) :
+_telemetry(telemetry),
+_record({std::move(name), std::move(phase), 0, 0, 0, {}, std::nullopt}),
+_sampleCounters(std::move(sampleCounters)),
+_startCounters(_sampleCounters ? _sampleCounters() : Counters()),
+_startWallTime(std::chrono::steady_clock::now()),
+_startCPUSeconds(_currentThreadCPUSeconds()),
+_startPeakRSSBytes(_peakRSSBytes()) {}
+
+Telemetry::Measurement::~Measurement() {
+    const std::chrono::duration<double> wallSeconds = std::chrono::steady_clock::now() - _startWallTime;
+    _record.wallSeconds = wallSeconds.count();
+    _record.cpuSeconds = _currentThreadCPUSeconds() - _startCPUSeconds;
+    _record.peakRSSDeltaBytes = _peakRSSBytes() - _startPeakRSSBytes;
+    if (_sampleCounters) {
+        Counters endCounters = _sampleCounters();
+        _record.counters.declsVisited = endCounters.declsVisited - _startCounters.declsVisited;
+        _record.counters.resultsInserted = endCounters.resultsInserted - _startCounters.resultsInserted;
+    }
+    _telemetry->record(_record);
+}
+
+void Telemetry::Measurement::setCacheHit(bool cacheHit) {
+    _record.cacheHit = cacheHit;
+}
+
+void Telemetry::Measurement::setCounters(const Counters& counters) {
+    _record.counters = counters;
+}
+
+// MARK: Telemetry
+void Telemetry::record(const PhaseRecord& record) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _records.push_back(record);
+}
+
+double Telemetry::_currentThreadCPUSeconds() {
+    timespec t;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+int64_t Telemetry::_peakRSSBytes() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    // Linux reports kilobytes
+    return usage.ru_maxrss * 1024;
+#endif
+}
+
+void Telemetry::writeJSON(const std::filesystem::path& path) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream outfile(path);
+    
+    // Names are C++ identifiers and phase names, so they never need escaping
+    outfile << "[" << std::endl;
+    for (uint64_t i = 0; i < _records.size(); i++) {
+        const PhaseRecord& record = _records[i];
+        outfile << "  {";
+        outfile << "\"name\": \"" << record.name << "\", ";
+        outfile << "\"phase\": \"" << record.phase << "\", ";
+        outfile << "\"wallSeconds\": " << record.wallSeconds << ", ";
+        outfile << "\"cpuSeconds\": " << record.cpuSeconds << ", ";
+        outfile << "\"peakRSSDeltaBytes\": " << record.peakRSSDeltaBytes << ", ";
+        outfile << "\"declsVisited\": " << record.counters.declsVisited << ", ";
+        outfile << "\"resultsInserted\": " << record.counters.resultsInserted << ", ";
+        outfile << "\"cacheHit\": " << (record.cacheHit ? (*record.cacheHit ? "true" : "false") : "null");
+        outfile << "}" << (i + 1 < _records.size() ? "," : "") << std::endl;
+    }
+    outfile << "]" << std::endl;
+    std::cout << "Wrote telemetry to " << path.string() << std::endl;
+}
+
+void Telemetry::printSummary() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<PhaseRecord> records = _records;
+    std::stable_sort(records.begin(), records.end(), [](const PhaseRecord& l, const PhaseRecord& r) {
+        return l.wallSeconds > r.wallSeconds;
+    });
+    
+    std::cout << std::left << std::setw(48) << "Pass" << std::setw(12) << "Phase";
+    std::cout << std::right << std::setw(10) << "Wall (s)" << std::setw(10) << "CPU (s)" << std::setw(12) << "RSS (MB)";
+    std::cout << std::setw(12) << "Visited" << std::setw(12) << "Inserted" << std::setw(8) << "Cache" << std::endl;
+    
+    std::cout << std::fixed << std::setprecision(2);
+    for (const PhaseRecord& record : records) {
+        std::cout << std::left << std::setw(48) << record.name << std::setw(12) << record.phase;
+        std::cout << std::right << std::setw(10) << record.wallSeconds << std::setw(10) << record.cpuSeconds;
+        std::cout << std::setw(12) << record.peakRSSDeltaBytes / (1024.0 * 1024.0);
+        std::cout << std::setw(12) << record.counters.declsVisited << std::setw(12) << record.counters.resultsInserted;
+        std::cout << std::setw(8) << (record.cacheHit ? (*record.cacheHit ? "hit" : "miss") : "") << std::endl;
+    }
+    std::cout << std::defaultfloat << std::setprecision(6);
+}
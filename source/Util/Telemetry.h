@@ -0,0 +1,93 @@
+//===----------------------------------------------------------------------===//
+// This source file is part of github.com/apple/SwiftUsd-ast-answerer
+//
+// Copyright © 2025 Apple Inc. and the SwiftUsd-ast-answerer project authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//===----------------------------------------------------------------------===//
+
+#ifndef Telemetry_h
+#define Telemetry_h
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Records how long each phase of every analysis pass and code gen took, so a slow run
+// can be blamed on specific passes. Passes run in parallel, so recording is thread-safe.
+// CPU time is per thread, but peak RSS is per process, so its deltas include whatever
+// else was running at the same time
+class Telemetry {
+public:
+    struct Counters {
+        uint64_t declsVisited = 0;
+        uint64_t resultsInserted = 0;
+    };
+    
+    struct PhaseRecord {
+        std::string name;
+        std::string phase;
+        double wallSeconds;
+        double cpuSeconds;
+        int64_t peakRSSDeltaBytes;
+        Counters counters;
+        // Only set for phases that can be skipped by a cache
+        std::optional<bool> cacheHit;
+    };
+    
+    // Measures one phase from construction to destruction. `sampleCounters`
+    // is called at both ends, and the record holds the difference
+    class Measurement {
+    public:
+        Measurement(const Telemetry* telemetry, std::string name, std::string phase,
+                    std::function<Counters()> sampleCounters = nullptr);
+        ~Measurement();
+        
+        Measurement(const Measurement&) = delete;
+        Measurement& operator=(const Measurement&) = delete;
+        
+        void setCacheHit(bool cacheHit);
+        // For counts that aren't known until the phase is over
+        void setCounters(const Counters& counters);
+        
+    private:
+        const Telemetry* _telemetry;
+        PhaseRecord _record;
+        std::function<Counters()> _sampleCounters;
+        Counters _startCounters;
+        std::chrono::steady_clock::time_point _startWallTime;
+        double _startCPUSeconds;
+        int64_t _startPeakRSSBytes;
+    };
+    
+    void record(const PhaseRecord& record) const;
+    
+    void writeJSON(const std::filesystem::path& path) const;
+    void printSummary() const;
+    
+private:
+    static double _currentThreadCPUSeconds();
+    static int64_t _peakRSSBytes();
+    
+    mutable std::mutex _mutex;
+    mutable std::vector<PhaseRecord> _records;
+};
+
+#endif /* Telemetry_h */
@@ -20,7 +20,10 @@
 
 #include "Util/TestDataLoader.h"
 #include "Util/FileSystemInfo.h"
+#include <algorithm>
+#include <chrono>
 #include <fstream>
+#include <functional>
 #include <regex>
 
 void verifyFieldCount(const std::vector<std::vector<std::string>>& lines, int expected, const std::string& filename) {
@@ -134,6 +137,158 @@ std::vector<std::string> _splitLineBySemicolonNotSurroundedBySingleQuotes(const
 
 /* static */
 std::vector<std::vector<std::string>> TestDataLoader::load(const std::filesystem::path& f, PxrNsReplacement replacement) {
+    std::vector<std::vector<std::string>> result;
+    
+    TestDataReader reader(f, replacement);
+    while (reader.next()) {
+        result.emplace_back(reader.fields().begin(), reader.fields().end());
+    }
+    
+    return result;
+}
+
+/* static */
+void TestDataLoader::benchmarkReader(const std::filesystem::path& resourcesDirectory) {
+    std::vector<std::pair<uint64_t, std::filesystem::path>> testFiles;
+    for (const auto& entry : std::filesystem::directory_iterator(resourcesDirectory)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".txt") {
+            testFiles.push_back({entry.file_size(), entry.path()});
+        }
+    }
+    std::sort(testFiles.begin(), testFiles.end(), std::greater<>());
+    testFiles.resize(std::min<uint64_t>(testFiles.size(), 5));
+    
+    auto time = [](const std::string& label, uint64_t nIterations, auto&& f) {
+        const auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < nIterations; i++) {
+            f();
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "    " << label << ": " << (elapsed.count() / nIterations) * 1e6 << "us" << std::endl;
+    };
+    
+    const uint64_t nIterations = 100;
+    for (const auto& [size, path] : testFiles) {
+        std::cout << path.string() << " (" << size << " bytes)" << std::endl;
+        for (PxrNsReplacement replacement : {PxrNsReplacement::replace, PxrNsReplacement::dontReplace}) {
+            if (load(path, replacement) != referenceLoad(path, replacement)) {
+                std::cerr << "TestDataReader doesn't match the reference loader on " << path.string() << std::endl;
+                __builtin_trap();
+            }
+        }
+        time("referenceLoad", nIterations, [&]() {
+            std::vector<std::vector<std::string>> loaded = referenceLoad(path, PxrNsReplacement::replace);
+        });
+        time("load", nIterations, [&]() {
+            std::vector<std::vector<std::string>> loaded = load(path, PxrNsReplacement::replace);
+        });
+        time("TestDataReader", nIterations, [&]() {
+            TestDataReader reader(path, PxrNsReplacement::replace);
+            while (reader.next()) {}
+        });
+    }
+}
+
+// MARK: TestDataReader
+
+TestDataReader::TestDataReader(const std::filesystem::path& f, TestDataLoader::PxrNsReplacement replacement) :
+    _replacement(replacement)
+{
+    if (!std::filesystem::exists(f)) {
+        std::cerr << "Error! No test file " << f.string() << " to load" << std::endl;
+        __builtin_trap();
+    }
+    
+    // MemoryBuffer maps the file rather than reading it, when it's large enough to be worthwhile
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> buffer = llvm::MemoryBuffer::getFile(f.string(),
+                                                                                           /*IsText*/ false,
+                                                                                           /*RequiresNullTerminator*/ false);
+    if (!buffer) {
+        std::cerr << "Error! Couldn't read test file " << f.string() << std::endl;
+        __builtin_trap();
+    }
+    _buffer = std::move(*buffer);
+    _remaining = std::string_view(_buffer->getBufferStart(), _buffer->getBufferSize());
+}
+
+bool TestDataReader::next() {
+    // PXR_NS is a string literal, so search for the macro name without a regex,
+    // and only copy the lines that have it
+    static const std::string_view pxrNsName = "PXR_NS";
+    static const std::boyer_moore_horspool_searcher pxrNsSearcher(pxrNsName.begin(), pxrNsName.end());
+    
+    while (!_remaining.empty()) {
+        uint64_t newline = _remaining.find('\n');
+        std::string_view line = _remaining.substr(0, newline);
+        _remaining = newline == std::string_view::npos ? std::string_view() : _remaining.substr(newline + 1);
+        
+        if (_replacement == TestDataLoader::PxrNsReplacement::replace) {
+            auto it = std::search(line.begin(), line.end(), pxrNsSearcher);
+            if (it != line.end()) {
+                _replacedLine.clear();
+                auto copiedUpTo = line.begin();
+                while (it != line.end()) {
+                    _replacedLine.append(copiedUpTo, it);
+                    _replacedLine.append(PXR_NS);
+                    copiedUpTo = it + pxrNsName.size();
+                    it = std::search(copiedUpTo, line.end(), pxrNsSearcher);
+                }
+                _replacedLine.append(copiedUpTo, line.end());
+                line = _replacedLine;
+            }
+        }
+        
+        _splitFields(line.substr(0, line.find("//")));
+        if (!_fields.empty()) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+const std::vector<std::string_view>& TestDataReader::fields() const {
+    return _fields;
+}
+
+// Same as _splitLineBySemicolonNotSurroundedBySingleQuotes() and trimWhitespace(),
+// but on views into the line
+void TestDataReader::_splitFields(std::string_view s) {
+    _fields.clear();
+    auto pushTrimmed = [this](std::string_view field) {
+        while (!field.empty() && std::isspace((unsigned char)field.front())) {
+            field.remove_prefix(1);
+        }
+        while (!field.empty() && std::isspace((unsigned char)field.back())) {
+            field.remove_suffix(1);
+        }
+        if (!field.empty()) {
+            _fields.push_back(field);
+        }
+    };
+    
+    uint64_t startCopy = 0;
+    for (uint64_t endCopy = 0; endCopy < s.size(); endCopy++) {
+        if (s[endCopy] == ';') {
+            if (endCopy != 0 && s[endCopy - 1] == '\'' && endCopy + 1 < s.size() && s[endCopy + 1] == '\'') {
+                continue;
+            }
+            
+            pushTrimmed(s.substr(startCopy, endCopy - startCopy));
+            // Like the original, the character after a separator is never treated as one
+            endCopy += 1;
+            startCopy = endCopy;
+        }
+    }
+    if (startCopy < s.size()) {
+        pushTrimmed(s.substr(startCopy));
+    }
+}
+
+// MARK: Reference loader
+
+/* static */
+std::vector<std::vector<std::string>> TestDataLoader::referenceLoad(const std::filesystem::path& f, PxrNsReplacement replacement) {
     if (!std::filesystem::exists(f)) {
         std::cerr << "Error! No test file " << f.string() << " to load" << std::endl;
         __builtin_trap();
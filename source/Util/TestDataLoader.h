@@ -22,9 +22,12 @@
 #define TestDataLoader_h
 
 #include "Util/ClangToolHelper.h"
+#include <llvm/Support/MemoryBuffer.h>
 #include <filesystem>
+#include <memory>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <regex>
 
 std::vector<std::string> splitStringByRegex(const std::string& str, const std::regex& regex);
@@ -42,6 +45,32 @@ public:
     static std::vector<std::string> loadOneField(const FileSystemInfo& info, const std::string& name, PxrNsReplacement replacement);
     static std::vector<std::pair<std::string, std::string>> loadTwoFields(const FileSystemInfo& info, const std::string& name, PxrNsReplacement replacement);
     static std::vector<std::vector<std::string>> load(const std::filesystem::path& f, PxrNsReplacement replacement);
+    
+    // The original line-by-line loader, kept to check and benchmark TestDataReader against
+    static std::vector<std::vector<std::string>> referenceLoad(const std::filesystem::path& f, PxrNsReplacement replacement);
+    // Times both loaders on the largest files in `resourcesDirectory`, and checks they agree
+    static void benchmarkReader(const std::filesystem::path& resourcesDirectory);
+};
+
+// Reads test data one record at a time from a memory-mapped file, in a single pass.
+// Fields are views into the mapping, or into the reader's own copy of the line
+// if PXR_NS was replaced in it, so they're only valid until the next call to next()
+class TestDataReader {
+public:
+    TestDataReader(const std::filesystem::path& f, TestDataLoader::PxrNsReplacement replacement);
+    
+    // Advances to the next record with at least one field, or returns false at the end of the file
+    bool next();
+    const std::vector<std::string_view>& fields() const;
+    
+private:
+    std::unique_ptr<llvm::MemoryBuffer> _buffer;
+    std::string_view _remaining;
+    TestDataLoader::PxrNsReplacement _replacement;
+    std::string _replacedLine;
+    std::vector<std::string_view> _fields;
+    
+    void _splitFields(std::string_view line);
 };
 
 #endif /* TestDataLoader_h */
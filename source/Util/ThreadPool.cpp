@@ -0,0 +1,94 @@
+//===----------------------------------------------------------------------===//
+// This source file is part of github.com/apple/SwiftUsd-ast-answerer
+//
+// Copyright © 2025 Apple Inc. and the SwiftUsd-ast-answerer project authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//===----------------------------------------------------------------------===//
+
+#include "Util/ThreadPool.h"
+
+ThreadPool::ThreadPool(uint64_t nThreads) :
+    _nRunningJobs(0),
+    _isShuttingDown(false)
+{
+    if (nThreads == 0) {
+        nThreads = 1;
+    }
+    for (uint64_t i = 0; i < nThreads; i++) {
+        _threads.emplace_back([this]() { _workerMain(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _isShuttingDown = true;
+    }
+    _jobAvailable.notify_all();
+    for (std::thread& thread : _threads) {
+        thread.join();
+    }
+}
+
+/* static */
+uint64_t ThreadPool::defaultThreadCount() {
+    uint64_t result = std::thread::hardware_concurrency();
+    return result ? result : 1;
+}
+
+uint64_t ThreadPool::threadCount() const {
+    return _threads.size();
+}
+
+void ThreadPool::enqueue(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _jobs.push_back(std::move(job));
+    }
+    _jobAvailable.notify_one();
+}
+
+void ThreadPool::waitUntilIdle() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _becameIdle.wait(lock, [this]() { return _jobs.empty() && _nRunningJobs == 0; });
+}
+
+void ThreadPool::_workerMain() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _jobAvailable.wait(lock, [this]() { return _isShuttingDown || !_jobs.empty(); });
+            if (_jobs.empty()) {
+                // Shutting down, and there's nothing left to do
+                return;
+            }
+            job = std::move(_jobs.front());
+            _jobs.pop_front();
+            _nRunningJobs += 1;
+        }
+        
+        job();
+        
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _nRunningJobs -= 1;
+            if (_jobs.empty() && _nRunningJobs == 0) {
+                _becameIdle.notify_all();
+            }
+        }
+    }
+}
@@ -0,0 +1,62 @@
+//===----------------------------------------------------------------------===//
+// This source file is part of github.com/apple/SwiftUsd-ast-answerer
+//
+// Copyright © 2025 Apple Inc. and the SwiftUsd-ast-answerer project authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+//===----------------------------------------------------------------------===//
+
+#ifndef ThreadPool_h
+#define ThreadPool_h
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A minimal fixed-size pool of worker threads for running independent jobs in parallel.
+// Jobs are started in the order they're enqueued, but may finish in any order
+class ThreadPool {
+public:
+    ThreadPool(uint64_t nThreads);
+    ~ThreadPool();
+    
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    
+    // The number of threads to use when a caller doesn't have a better idea
+    static uint64_t defaultThreadCount();
+    
+    uint64_t threadCount() const;
+    void enqueue(std::function<void()> job);
+    // Blocks until every enqueued job has finished
+    void waitUntilIdle();
+    
+private:
+    void _workerMain();
+    
+    std::vector<std::thread> _threads;
+    std::deque<std::function<void()>> _jobs;
+    std::mutex _mutex;
+    std::condition_variable _jobAvailable;
+    std::condition_variable _becameIdle;
+    uint64_t _nRunningJobs;
+    bool _isShuttingDown;
+};
+
+#endif /* ThreadPool_h */